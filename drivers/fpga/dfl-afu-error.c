@@ -265,8 +265,15 @@ const struct dfl_feature_id port_err_id_table[] = {
 	{0,}
 };
 
+static const unsigned int port_err_ioctl_cmds[] = {
+	DFL_FPGA_PORT_ERR_GET_IRQ_NUM,
+	DFL_FPGA_PORT_ERR_SET_IRQ,
+	0
+};
+
 const struct dfl_feature_ops port_err_ops = {
 	.init = port_err_init,
 	.uinit = port_err_uinit,
 	.ioctl = port_err_ioctl,
+	.ioctl_cmds = port_err_ioctl_cmds,
 };
@@ -469,12 +469,18 @@ static const struct dfl_feature_id port_hdr_id_table[] = {
 	{0,}
 };
 
+static const unsigned int port_hdr_ioctl_cmds[] = {
+	DFL_FPGA_PORT_RESET,
+	0
+};
+
 static const struct dfl_feature_ops port_hdr_ops = {
 	.init = port_hdr_init,
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 4, 0) && RHEL_RELEASE_CODE < 0x803
 	.uinit = port_hdr_uinit,
 #endif
 	.ioctl = port_hdr_ioctl,
+	.ioctl_cmds = port_hdr_ioctl_cmds,
 };
 
 static ssize_t
@@ -611,6 +617,16 @@ port_uint_ioctl(struct platform_device *pdev, struct dfl_feature *feature,
 		return dfl_feature_ioctl_get_num_irqs(pdev, feature, arg);
 	case DFL_FPGA_PORT_UINT_SET_IRQ:
 		return dfl_feature_ioctl_set_irq(pdev, feature, arg);
+	case DFL_FPGA_PORT_UINT_SET_IRQ_AFFINITY:
+		return dfl_feature_ioctl_set_irq_affinity(pdev, feature, arg);
+	case DFL_FPGA_PORT_UINT_SET_IRQ_COALESCE:
+		return dfl_feature_ioctl_set_irq_coalesce(pdev, feature, arg);
+	case DFL_FPGA_PORT_UINT_SET_IRQ_RING:
+		return dfl_feature_ioctl_set_irq_ring(pdev, feature, arg,
+						      DFL_AFU_IRQ_RING_OFFSET);
+	case DFL_FPGA_PORT_UINT_GET_POLL_INFO:
+		return dfl_feature_ioctl_get_poll_info(pdev, feature, arg,
+						       DFL_AFU_IRQ_STATUS_OFFSET);
 	default:
 		dev_dbg(&pdev->dev, "%x cmd not handled", cmd);
 		return -ENODEV;
@@ -622,8 +638,109 @@ static const struct dfl_feature_id port_uint_id_table[] = {
 	{0,}
 };
 
+static const unsigned int port_uint_ioctl_cmds[] = {
+	DFL_FPGA_PORT_UINT_GET_IRQ_NUM,
+	DFL_FPGA_PORT_UINT_SET_IRQ,
+	DFL_FPGA_PORT_UINT_SET_IRQ_AFFINITY,
+	DFL_FPGA_PORT_UINT_SET_IRQ_COALESCE,
+	DFL_FPGA_PORT_UINT_SET_IRQ_RING,
+	DFL_FPGA_PORT_UINT_GET_POLL_INFO,
+	0
+};
+
+static ssize_t port_uint_counter_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct dev_ext_attribute *eattr;
+
+	eattr = container_of(attr, struct dev_ext_attribute, attr);
+
+	return sprintf(buf, "%lld\n", (s64)atomic64_read(eattr->var));
+}
+
+/*
+ * The number of UINT vectors is only known once the feature has been
+ * enumerated, so the per-vector counters (uint/irq<n>_events and
+ * uint/irq<n>_signals) are built here instead of being a static group.
+ */
+static int port_uint_sysfs_add(struct platform_device *pdev,
+			       struct dfl_feature *feature)
+{
+	struct device *dev = &pdev->dev;
+	struct dev_ext_attribute *eattrs;
+	struct attribute_group *group;
+	struct attribute **attrs;
+	unsigned int i, n;
+
+	if (!feature->nr_irqs)
+		return 0;
+
+	n = feature->nr_irqs * 2;
+
+	group = devm_kzalloc(dev, sizeof(*group), GFP_KERNEL);
+	eattrs = devm_kcalloc(dev, n, sizeof(*eattrs), GFP_KERNEL);
+	attrs = devm_kcalloc(dev, n + 1, sizeof(*attrs), GFP_KERNEL);
+	if (!group || !eattrs || !attrs)
+		return -ENOMEM;
+
+	for (i = 0; i < n; i++) {
+		struct dfl_feature_irq_ctx *ctx = &feature->irq_ctx[i / 2];
+		struct dev_ext_attribute *eattr = &eattrs[i];
+		bool signals = i & 1;
+
+		sysfs_attr_init(&eattr->attr.attr);
+		eattr->attr.attr.name = devm_kasprintf(dev, GFP_KERNEL,
+						       "irq%u_%s", i / 2,
+						       signals ? "signals" :
+								 "events");
+		if (!eattr->attr.attr.name)
+			return -ENOMEM;
+
+		eattr->attr.attr.mode = 0444;
+		eattr->attr.show = port_uint_counter_show;
+		eattr->var = signals ? &ctx->nr_signals : &ctx->nr_events;
+		attrs[i] = &eattr->attr.attr;
+	}
+
+	group->name = "uint";
+	group->attrs = attrs;
+	feature->priv = group;
+
+	return sysfs_create_group(&dev->kobj, group);
+}
+
+static int port_uint_init(struct platform_device *pdev,
+			  struct dfl_feature *feature)
+{
+	int ret;
+
+	ret = dfl_feature_irq_status_init(feature);
+	if (ret)
+		return ret;
+
+	ret = port_uint_sysfs_add(pdev, feature);
+	if (ret) {
+		feature->priv = NULL;
+		dfl_feature_irq_status_uinit(feature);
+	}
+
+	return ret;
+}
+
+static void port_uint_uinit(struct platform_device *pdev,
+			    struct dfl_feature *feature)
+{
+	if (feature->priv)
+		sysfs_remove_group(&pdev->dev.kobj, feature->priv);
+	feature->priv = NULL;
+	dfl_feature_irq_status_uinit(feature);
+}
+
 static const struct dfl_feature_ops port_uint_ops = {
+	.init = port_uint_init,
+	.uinit = port_uint_uinit,
 	.ioctl = port_uint_ioctl,
+	.ioctl_cmds = port_uint_ioctl_cmds,
 };
 
 static struct dfl_feature_driver port_feature_drvs[] = {
@@ -686,9 +803,11 @@ static int afu_release(struct inode *inode, struct file *filp)
 	dfl_feature_dev_use_end(fdata);
 
 	if (!dfl_feature_dev_use_count(fdata)) {
-		dfl_fpga_dev_for_each_feature(fdata, feature)
+		dfl_fpga_dev_for_each_feature(fdata, feature) {
 			dfl_fpga_set_irq_triggers(feature, 0,
 						  feature->nr_irqs, NULL);
+			dfl_feature_irq_ring_remove(feature);
+		}
 		__port_reset(fdata);
 		afu_dma_region_destroy(fdata);
 	}
@@ -819,8 +938,6 @@ static long afu_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	struct platform_device *pdev = filp->private_data;
 	struct dfl_feature_platform_data *pdata;
-	struct dfl_feature *f;
-	long ret;
 
 	dev_dbg(&pdev->dev, "%s cmd 0x%x\n", __func__, cmd);
 
@@ -840,21 +957,9 @@ static long afu_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	case DFL_FPGA_PORT_DMA_UNMAP:
 		return afu_ioctl_dma_unmap(pdata, (void __user *)arg);
 	default:
-		/*
-		 * Let sub-feature's ioctl function to handle the cmd
-		 * Sub-feature's ioctl returns -ENODEV when cmd is not
-		 * handled in this sub feature, and returns 0 and other
-		 * error code if cmd is handled.
-		 */
-		dfl_fpga_dev_for_each_feature(pdata->fdata, f)
-			if (f->ops && f->ops->ioctl) {
-				ret = f->ops->ioctl(pdev, f, cmd, arg);
-				if (ret != -ENODEV)
-					return ret;
-			}
+		/* Let the sub-feature which handles the cmd process it */
+		return dfl_feature_dev_ioctl(pdata->fdata, cmd, arg);
 	}
-
-	return -EINVAL;
 }
 
 static const struct vm_operations_struct afu_vma_ops = {
@@ -863,6 +968,35 @@ static const struct vm_operations_struct afu_vma_ops = {
 #endif
 };
 
+static int afu_mmap_irq_ring(struct dfl_feature_dev_data *fdata,
+			     struct vm_area_struct *vma)
+{
+	struct dfl_feature *feature;
+	int ret;
+
+	feature = dfl_get_feature_by_id(fdata, PORT_FEATURE_ID_UINT);
+	if (!feature)
+		return -EINVAL;
+
+	mutex_lock(&fdata->lock);
+	ret = dfl_feature_irq_ring_mmap(feature, vma);
+	mutex_unlock(&fdata->lock);
+
+	return ret;
+}
+
+static int afu_mmap_irq_status(struct dfl_feature_dev_data *fdata,
+			       struct vm_area_struct *vma)
+{
+	struct dfl_feature *feature;
+
+	feature = dfl_get_feature_by_id(fdata, PORT_FEATURE_ID_UINT);
+	if (!feature)
+		return -EINVAL;
+
+	return dfl_feature_irq_status_mmap(feature, vma);
+}
+
 static int afu_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	struct platform_device *pdev = filp->private_data;
@@ -878,6 +1012,11 @@ static int afu_mmap(struct file *filp, struct vm_area_struct *vma)
 	pdata = dev_get_platdata(&pdev->dev);
 
 	offset = vma->vm_pgoff << PAGE_SHIFT;
+	if (offset == DFL_AFU_IRQ_RING_OFFSET)
+		return afu_mmap_irq_ring(pdata->fdata, vma);
+	if (offset == DFL_AFU_IRQ_STATUS_OFFSET)
+		return afu_mmap_irq_status(pdata->fdata, vma);
+
 	ret = afu_mmio_region_get_by_offset(pdata->fdata, offset, size,
 					    &region);
 	if (ret)
@@ -22,6 +22,10 @@
 
 #include "dfl.h"
 
+/* mmap offsets of the UINT completion ring and busy-poll page */
+#define DFL_AFU_IRQ_RING_OFFSET		(1ULL << 40)
+#define DFL_AFU_IRQ_STATUS_OFFSET	(2ULL << 40)
+
 /**
  * struct dfl_afu_mmio_region - afu mmio region data structure
  *
@@ -402,8 +402,15 @@ const struct dfl_feature_id fme_global_err_id_table[] = {
 	{0,}
 };
 
+static const unsigned int fme_global_err_ioctl_cmds[] = {
+	DFL_FPGA_FME_ERR_GET_IRQ_NUM,
+	DFL_FPGA_FME_ERR_SET_IRQ,
+	0
+};
+
 const struct dfl_feature_ops fme_global_err_ops = {
 	.init = fme_global_err_init,
 	.uinit = fme_global_err_uinit,
 	.ioctl = fme_global_error_ioctl,
+	.ioctl_cmds = fme_global_err_ioctl_cmds,
 };
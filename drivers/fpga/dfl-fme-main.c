@@ -201,12 +201,19 @@ static const struct dfl_feature_id fme_hdr_id_table[] = {
 	{0,}
 };
 
+static const unsigned int fme_hdr_ioctl_cmds[] = {
+	DFL_FPGA_FME_PORT_RELEASE,
+	DFL_FPGA_FME_PORT_ASSIGN,
+	0
+};
+
 static const struct dfl_feature_ops fme_hdr_ops = {
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 4, 0) && RHEL_RELEASE_CODE < 0x803
 	.init = fme_hdr_init,
 	.uinit = fme_hdr_uinit,
 #endif
 	.ioctl = fme_hdr_ioctl,
+	.ioctl_cmds = fme_hdr_ioctl_cmds,
 };
 
 #define FME_THERM_THRESHOLD	0x8
@@ -670,8 +677,6 @@ static long fme_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	struct dfl_feature_platform_data *pdata = filp->private_data;
 	struct dfl_feature_dev_data *fdata = pdata->fdata;
 	struct platform_device *pdev = fdata->dev;
-	struct dfl_feature *f;
-	long ret;
 
 	dev_dbg(&pdev->dev, "%s cmd 0x%x\n", __func__, cmd);
 
@@ -681,22 +686,9 @@ static long fme_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	case DFL_FPGA_CHECK_EXTENSION:
 		return fme_ioctl_check_extension(pdata, arg);
 	default:
-		/*
-		 * Let sub-feature's ioctl function to handle the cmd.
-		 * Sub-feature's ioctl returns -ENODEV when cmd is not
-		 * handled in this sub feature, and returns 0 or other
-		 * error code if cmd is handled.
-		 */
-		dfl_fpga_dev_for_each_feature(fdata, f) {
-			if (f->ops && f->ops->ioctl) {
-				ret = f->ops->ioctl(pdev, f, cmd, arg);
-				if (ret != -ENODEV)
-					return ret;
-			}
-		}
+		/* Let the sub-feature which handles the cmd process it */
+		return dfl_feature_dev_ioctl(fdata, cmd, arg);
 	}
-
-	return -EINVAL;
 }
 
 static int fme_dev_init(struct platform_device *pdev)
@@ -16,6 +16,8 @@
  *   Mitchel, Henry <henry.mitchel@intel.com>
  */
 
+#include <linux/hrtimer.h>
+#include <linux/module.h>
 #include <linux/perf_event.h>
 #include "dfl.h"
 #include "dfl-fme.h"
@@ -128,8 +130,29 @@
 
 #define PERF_TIMEOUT			30
 
+/* hw_perf_event flag: prev_count is invalid, resync it on the next read */
+#define FME_PERF_HWC_RESYNC		BIT(0)
+
 #define PERF_MAX_PORT_NUM		1U
 
+#define FME_EVENT_MASK		GENMASK_ULL(11, 0)
+#define FME_EVENT_SHIFT		0
+#define FME_EVTYPE_MASK		GENMASK_ULL(15, 12)
+#define FME_EVTYPE_SHIFT	12
+#define FME_EVTYPE_BASIC	0
+#define FME_EVTYPE_CACHE	1
+#define FME_EVTYPE_FABRIC	2
+#define FME_EVTYPE_VTD		3
+#define FME_EVTYPE_VTD_SIP	4
+#define FME_EVTYPE_MAX		FME_EVTYPE_VTD_SIP
+#define FME_PORTID_MASK		GENMASK_ULL(23, 16)
+#define FME_PORTID_SHIFT	16
+#define FME_PORTID_ROOT		(0xffU)
+
+#define get_event(_config)	FIELD_GET(FME_EVENT_MASK, _config)
+#define get_evtype(_config)	FIELD_GET(FME_EVTYPE_MASK, _config)
+#define get_portid(_config)	FIELD_GET(FME_PORTID_MASK, _config)
+
 /**
  * struct fme_perf_priv - priv data structure for fme perf driver
  *
@@ -143,6 +166,11 @@
  * @cpu: active CPU to which the PMU is bound for accesses.
  * @cpuhp_node: node for CPU hotplug notifier link.
  * @cpuhp_state: state for CPU hotplug notification;
+ * @hrtimer: timer accumulating hardware counters of active events.
+ * @active_list: list of events currently added to the pmu.
+ * @nr_active: number of active events per event type.
+ * @txn_flags: flags of the pending pmu transaction.
+ * @frozen: counters of all active event types are frozen.
  */
 struct fme_perf_priv {
 	struct device *dev;
@@ -157,20 +185,47 @@ struct fme_perf_priv {
 	unsigned int cpu;
 	struct hlist_node node;
 	enum cpuhp_state cpuhp_state;
+
+	struct hrtimer hrtimer;
+	struct list_head active_list;
+	u32 nr_active[FME_EVTYPE_MAX + 1];
+
+	unsigned int txn_flags;
+	bool frozen;
 };
 
+/*
+ * Hardware counters are 48 or 60 bits wide and have no overflow interrupt,
+ * so active events are accumulated into their 64-bit software counts from a
+ * per-PMU hrtimer. The same timer delivers samples for sampling events, which
+ * bounds the sampling rate to one sample per event per interval.
+ */
+static unsigned int timer_interval_ms = 10;
+module_param(timer_interval_ms, uint, 0644);
+MODULE_PARM_DESC(timer_interval_ms,
+		 "FME perf counter accumulation and sampling interval in ms (default 10)");
+
 /**
  * struct fme_perf_event_ops - callbacks for fme perf events
  *
  * @event_init: callback invoked during event init.
  * @event_destroy: callback invoked during event destroy.
- * @read_counter: callback to read hardware counters.
+ * @read_counter: callback to read hardware counters, returns 0 and the
+ *		  counter value in @val, or -ETIMEDOUT if the counter did not
+ *		  switch to the selected event.
+ * @cntr_mask: valid bits of the value read by @read_counter.
+ * @ctrl: offset of the control register holding @freeze, 0 if none.
+ * @freeze: freeze bit which stops all counters of this event type.
  */
 struct fme_perf_event_ops {
 	int (*event_init)(struct fme_perf_priv *priv, u32 event, u32 portid);
 	void (*event_destroy)(struct fme_perf_priv *priv, u32 event,
 			      u32 portid);
-	u64 (*read_counter)(struct fme_perf_priv *priv, u32 event, u32 portid);
+	int (*read_counter)(struct fme_perf_priv *priv, u32 event, u32 portid,
+			    u64 *val);
+	u64 cntr_mask;
+	u32 ctrl;
+	u64 freeze;
 };
 
 #define to_fme_perf_priv(_pmu)	container_of(_pmu, struct fme_perf_priv, pmu)
@@ -196,24 +251,6 @@ static const struct attribute_group fme_perf_cpumask_group = {
 	.attrs = fme_perf_cpumask_attrs,
 };
 
-#define FME_EVENT_MASK		GENMASK_ULL(11, 0)
-#define FME_EVENT_SHIFT		0
-#define FME_EVTYPE_MASK		GENMASK_ULL(15, 12)
-#define FME_EVTYPE_SHIFT	12
-#define FME_EVTYPE_BASIC	0
-#define FME_EVTYPE_CACHE	1
-#define FME_EVTYPE_FABRIC	2
-#define FME_EVTYPE_VTD		3
-#define FME_EVTYPE_VTD_SIP	4
-#define FME_EVTYPE_MAX		FME_EVTYPE_VTD_SIP
-#define FME_PORTID_MASK		GENMASK_ULL(23, 16)
-#define FME_PORTID_SHIFT	16
-#define FME_PORTID_ROOT		(0xffU)
-
-#define get_event(_config)	FIELD_GET(FME_EVENT_MASK, _config)
-#define get_evtype(_config)	FIELD_GET(FME_EVTYPE_MASK, _config)
-#define get_portid(_config)	FIELD_GET(FME_PORTID_MASK, _config)
-
 PMU_FORMAT_ATTR(event,		"config:0-11");
 PMU_FORMAT_ATTR(evtype,		"config:12-15");
 PMU_FORMAT_ATTR(portid,		"config:16-23");
@@ -293,12 +330,14 @@ static int basic_event_init(struct fme_perf_priv *priv, u32 event, u32 portid)
 	return -EINVAL;
 }
 
-static u64 basic_read_event_counter(struct fme_perf_priv *priv,
-				    u32 event, u32 portid)
+static int basic_read_event_counter(struct fme_perf_priv *priv,
+				    u32 event, u32 portid, u64 *val)
 {
 	void __iomem *base = priv->ioaddr;
 
-	return fme_read_perf_cntr_reg(base + CLK_CNTR);
+	*val = fme_read_perf_cntr_reg(base + CLK_CNTR);
+
+	return 0;
 }
 
 static int cache_event_init(struct fme_perf_priv *priv, u32 event, u32 portid)
@@ -310,8 +349,8 @@ static int cache_event_init(struct fme_perf_priv *priv, u32 event, u32 portid)
 	return -EINVAL;
 }
 
-static u64 cache_read_event_counter(struct fme_perf_priv *priv,
-				    u32 event, u32 portid)
+static int cache_read_event_counter(struct fme_perf_priv *priv,
+				    u32 event, u32 portid, u64 *val)
 {
 	void __iomem *base = priv->ioaddr;
 	u64 v, count;
@@ -324,26 +363,30 @@ static u64 cache_read_event_counter(struct fme_perf_priv *priv,
 	else
 		channel = CACHE_CHANNEL_RD;
 
-	/* set channel access type and cache event code. */
+	/* set channel access type and cache event code if not selected yet. */
 	v = readq(base + CACHE_CTRL);
-	v &= ~(CACHE_CHANNEL_SEL | CACHE_CTRL_EVNT);
-	v |= FIELD_PREP(CACHE_CHANNEL_SEL, channel);
-	v |= FIELD_PREP(CACHE_CTRL_EVNT, event);
-	writeq(v, base + CACHE_CTRL);
+	if (FIELD_GET(CACHE_CHANNEL_SEL, v) != channel ||
+	    FIELD_GET(CACHE_CTRL_EVNT, v) != event) {
+		v &= ~(CACHE_CHANNEL_SEL | CACHE_CTRL_EVNT);
+		v |= FIELD_PREP(CACHE_CHANNEL_SEL, channel);
+		v |= FIELD_PREP(CACHE_CTRL_EVNT, event);
+		writeq(v, base + CACHE_CTRL);
+	}
 
 	if (readq_poll_timeout_atomic(base + CACHE_CNTR0, v,
 				      FIELD_GET(CACHE_CNTR_EVNT, v) == event,
 				      1, PERF_TIMEOUT)) {
-		dev_err(priv->dev, "timeout, unmatched cache event code in counter register.\n");
-		return 0;
+		dev_err_ratelimited(priv->dev, "timeout, unmatched cache event code in counter register.\n");
+		return -ETIMEDOUT;
 	}
 
 	v = fme_read_perf_cntr_reg(base + CACHE_CNTR0);
 	count = FIELD_GET(CACHE_CNTR_EVNT_CNTR, v);
 	v = fme_read_perf_cntr_reg(base + CACHE_CNTR1);
 	count += FIELD_GET(CACHE_CNTR_EVNT_CNTR, v);
+	*val = count;
 
-	return count;
+	return 0;
 }
 
 static bool is_fabric_event_supported(struct fme_perf_priv *priv, u32 event,
@@ -419,26 +462,30 @@ static void fabric_event_destroy(struct fme_perf_priv *priv, u32 event,
 	spin_unlock(&priv->fab_lock);
 }
 
-static u64 fabric_read_event_counter(struct fme_perf_priv *priv, u32 event,
-				     u32 portid)
+static int fabric_read_event_counter(struct fme_perf_priv *priv, u32 event,
+				     u32 portid, u64 *val)
 {
 	void __iomem *base = priv->ioaddr;
 	u64 v;
 
 	v = readq(base + FAB_CTRL);
-	v &= ~FAB_CTRL_EVNT;
-	v |= FIELD_PREP(FAB_CTRL_EVNT, event);
-	writeq(v, base + FAB_CTRL);
+	if (FIELD_GET(FAB_CTRL_EVNT, v) != event) {
+		v &= ~FAB_CTRL_EVNT;
+		v |= FIELD_PREP(FAB_CTRL_EVNT, event);
+		writeq(v, base + FAB_CTRL);
+	}
 
 	if (readq_poll_timeout_atomic(base + FAB_CNTR, v,
 				      FIELD_GET(FAB_CNTR_EVNT, v) == event,
 				      1, PERF_TIMEOUT)) {
-		dev_err(priv->dev, "timeout, unmatched fab event code in counter register.\n");
-		return 0;
+		dev_err_ratelimited(priv->dev, "timeout, unmatched fab event code in counter register.\n");
+		return -ETIMEDOUT;
 	}
 
 	v = fme_read_perf_cntr_reg(base + FAB_CNTR);
-	return FIELD_GET(FAB_CNTR_EVNT_CNTR, v);
+	*val = FIELD_GET(FAB_CNTR_EVNT_CNTR, v);
+
+	return 0;
 }
 
 static int vtd_event_init(struct fme_perf_priv *priv, u32 event, u32 portid)
@@ -450,8 +497,8 @@ static int vtd_event_init(struct fme_perf_priv *priv, u32 event, u32 portid)
 	return -EINVAL;
 }
 
-static u64 vtd_read_event_counter(struct fme_perf_priv *priv, u32 event,
-				  u32 portid)
+static int vtd_read_event_counter(struct fme_perf_priv *priv, u32 event,
+				  u32 portid, u64 *val)
 {
 	void __iomem *base = priv->ioaddr;
 	u64 v;
@@ -459,19 +506,23 @@ static u64 vtd_read_event_counter(struct fme_perf_priv *priv, u32 event,
 	event += (portid * (VTD_EVNT_MAX + 1));
 
 	v = readq(base + VTD_CTRL);
-	v &= ~VTD_CTRL_EVNT;
-	v |= FIELD_PREP(VTD_CTRL_EVNT, event);
-	writeq(v, base + VTD_CTRL);
+	if (FIELD_GET(VTD_CTRL_EVNT, v) != event) {
+		v &= ~VTD_CTRL_EVNT;
+		v |= FIELD_PREP(VTD_CTRL_EVNT, event);
+		writeq(v, base + VTD_CTRL);
+	}
 
 	if (readq_poll_timeout_atomic(base + VTD_CNTR, v,
 				      FIELD_GET(VTD_CNTR_EVNT, v) == event,
 				      1, PERF_TIMEOUT)) {
-		dev_err(priv->dev, "timeout, unmatched vtd event code in counter register.\n");
-		return 0;
+		dev_err_ratelimited(priv->dev, "timeout, unmatched vtd event code in counter register.\n");
+		return -ETIMEDOUT;
 	}
 
 	v = fme_read_perf_cntr_reg(base + VTD_CNTR);
-	return FIELD_GET(VTD_CNTR_EVNT_CNTR, v);
+	*val = FIELD_GET(VTD_CNTR_EVNT_CNTR, v);
+
+	return 0;
 }
 
 static int vtd_sip_event_init(struct fme_perf_priv *priv, u32 event, u32 portid)
@@ -483,40 +534,57 @@ static int vtd_sip_event_init(struct fme_perf_priv *priv, u32 event, u32 portid)
 	return -EINVAL;
 }
 
-static u64 vtd_sip_read_event_counter(struct fme_perf_priv *priv, u32 event,
-				      u32 portid)
+static int vtd_sip_read_event_counter(struct fme_perf_priv *priv, u32 event,
+				      u32 portid, u64 *val)
 {
 	void __iomem *base = priv->ioaddr;
 	u64 v;
 
 	v = readq(base + VTD_SIP_CTRL);
-	v &= ~VTD_SIP_CTRL_EVNT;
-	v |= FIELD_PREP(VTD_SIP_CTRL_EVNT, event);
-	writeq(v, base + VTD_SIP_CTRL);
+	if (FIELD_GET(VTD_SIP_CTRL_EVNT, v) != event) {
+		v &= ~VTD_SIP_CTRL_EVNT;
+		v |= FIELD_PREP(VTD_SIP_CTRL_EVNT, event);
+		writeq(v, base + VTD_SIP_CTRL);
+	}
 
 	if (readq_poll_timeout_atomic(base + VTD_SIP_CNTR, v,
 				      FIELD_GET(VTD_SIP_CNTR_EVNT, v) == event,
 				      1, PERF_TIMEOUT)) {
-		dev_err(priv->dev, "timeout, unmatched vtd sip event code in counter register\n");
-		return 0;
+		dev_err_ratelimited(priv->dev, "timeout, unmatched vtd sip event code in counter register\n");
+		return -ETIMEDOUT;
 	}
 
 	v = fme_read_perf_cntr_reg(base + VTD_SIP_CNTR);
-	return FIELD_GET(VTD_SIP_CNTR_EVNT_CNTR, v);
+	*val = FIELD_GET(VTD_SIP_CNTR_EVNT_CNTR, v);
+
+	return 0;
 }
 
 static struct fme_perf_event_ops fme_perf_event_ops[] = {
 	[FME_EVTYPE_BASIC]	= {.event_init = basic_event_init,
-				   .read_counter = basic_read_event_counter,},
+				   .read_counter = basic_read_event_counter,
+				   .cntr_mask = U64_MAX,},
 	[FME_EVTYPE_CACHE]	= {.event_init = cache_event_init,
-				   .read_counter = cache_read_event_counter,},
+				   .read_counter = cache_read_event_counter,
+				   .cntr_mask = CACHE_CNTR_EVNT_CNTR,
+				   .ctrl = CACHE_CTRL,
+				   .freeze = CACHE_FREEZE_CNTR,},
 	[FME_EVTYPE_FABRIC]	= {.event_init = fabric_event_init,
 				   .event_destroy = fabric_event_destroy,
-				   .read_counter = fabric_read_event_counter,},
+				   .read_counter = fabric_read_event_counter,
+				   .cntr_mask = FAB_CNTR_EVNT_CNTR,
+				   .ctrl = FAB_CTRL,
+				   .freeze = FAB_FREEZE_CNTR,},
 	[FME_EVTYPE_VTD]	= {.event_init = vtd_event_init,
-				   .read_counter = vtd_read_event_counter,},
+				   .read_counter = vtd_read_event_counter,
+				   .cntr_mask = VTD_CNTR_EVNT_CNTR,
+				   .ctrl = VTD_CTRL,
+				   .freeze = VTD_FREEZE_CNTR,},
 	[FME_EVTYPE_VTD_SIP]	= {.event_init = vtd_sip_event_init,
-				   .read_counter = vtd_sip_read_event_counter,},
+				   .read_counter = vtd_sip_read_event_counter,
+				   .cntr_mask = VTD_SIP_CNTR_EVNT_CNTR,
+				   .ctrl = VTD_SIP_CTRL,
+				   .freeze = VTD_SIP_FREEZE_CNTR,},
 };
 
 static ssize_t fme_perf_event_show(struct device *dev,
@@ -792,6 +860,43 @@ static void fme_perf_event_destroy(struct perf_event *event)
 		ops->event_destroy(priv, event->hw.idx, event->hw.config_base);
 }
 
+static bool fme_perf_event_compatible(struct perf_event *event,
+				      struct perf_event *other)
+{
+	if (other->pmu != event->pmu)
+		return is_software_event(other);
+
+	/* fabric counters can only work in one mode at a time */
+	if (get_evtype(event->attr.config) == FME_EVTYPE_FABRIC &&
+	    get_evtype(other->attr.config) == FME_EVTYPE_FABRIC &&
+	    get_portid(event->attr.config) != get_portid(other->attr.config))
+		return false;
+
+	return true;
+}
+
+/*
+ * All members of a group are read back in one frozen snapshot, so reject
+ * groups mixing in other hardware pmus or fabric events in different modes.
+ */
+static int fme_perf_validate_group(struct perf_event *event)
+{
+	struct perf_event *sibling, *leader = event->group_leader;
+
+	if (leader == event)
+		return 0;
+
+	if (!fme_perf_event_compatible(event, leader))
+		return -EINVAL;
+
+	for_each_sibling_event(sibling, leader) {
+		if (!fme_perf_event_compatible(event, sibling))
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
 static int fme_perf_event_init(struct perf_event *event)
 {
 	struct fme_perf_priv *priv = to_fme_perf_priv(event->pmu);
@@ -806,9 +911,8 @@ static int fme_perf_event_init(struct perf_event *event)
 	/*
 	 * fme counters are shared across all cores.
 	 * Therefore, it does not support per-process mode.
-	 * Also, it does not support event sampling mode.
 	 */
-	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+	if (event->attach_state & PERF_ATTACH_TASK)
 		return -EINVAL;
 
 	if (event->cpu < 0)
@@ -823,6 +927,9 @@ static int fme_perf_event_init(struct perf_event *event)
 	if (evtype > FME_EVTYPE_MAX)
 		return -EINVAL;
 
+	if (fme_perf_validate_group(event))
+		return -EINVAL;
+
 	hwc->event_base = evtype;
 	hwc->idx = (int)eventid;
 	hwc->config_base = portid;
@@ -839,18 +946,143 @@ static int fme_perf_event_init(struct perf_event *event)
 	return 0;
 }
 
-static void fme_perf_event_update(struct perf_event *event)
+static ktime_t fme_perf_timer_interval(void)
+{
+	return ms_to_ktime(max_t(unsigned int, READ_ONCE(timer_interval_ms), 1));
+}
+
+/*
+ * Accumulate the counter change since the last update. If the counter can
+ * not be read, prev_count is left alone so that the next successful update
+ * accounts for the whole interval. If the read in start failed, there is no
+ * valid prev_count yet and the first successful read only resyncs it.
+ */
+static int fme_perf_event_update(struct perf_event *event, u64 *delta)
 {
 	struct fme_perf_event_ops *ops = get_event_ops(event->hw.event_base);
 	struct fme_perf_priv *priv = to_fme_perf_priv(event->pmu);
 	struct hw_perf_event *hwc = &event->hw;
-	u64 now, prev, delta;
+	u64 now, prev;
+	int ret;
+
+	ret = ops->read_counter(priv, (u32)hwc->idx, hwc->config_base, &now);
+	if (ret)
+		return ret;
+
+	prev = local64_xchg(&hwc->prev_count, now);
+	if (hwc->flags & FME_PERF_HWC_RESYNC) {
+		hwc->flags &= ~FME_PERF_HWC_RESYNC;
+		*delta = 0;
+		return 0;
+	}
+
+	*delta = (now - prev) & ops->cntr_mask;
+	local64_add(*delta, &event->count);
+
+	return 0;
+}
+
+static void fme_perf_event_set_period(struct perf_event *event)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	s64 left = local64_read(&hwc->period_left);
+
+	if (left <= 0 || left > hwc->sample_period)
+		left = hwc->sample_period;
+
+	local64_set(&hwc->period_left, left);
+	hwc->last_period = hwc->sample_period;
+}
+
+static void fme_perf_event_sample(struct perf_event *event, u64 delta,
+				  struct pt_regs *regs)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	struct perf_sample_data data;
+	s64 left;
+
+	left = local64_sub_return(delta, &hwc->period_left);
+	if (left > 0)
+		return;
+
+	/*
+	 * The period may have elapsed more than once since the last tick,
+	 * only one sample is reported in that case.
+	 */
+	left += hwc->sample_period;
+	if (left <= 0)
+		left = hwc->sample_period;
+	local64_set(&hwc->period_left, left);
+	hwc->last_period = hwc->sample_period;
+
+	if (!regs)
+		return;
+
+	perf_sample_data_init(&data, 0, hwc->last_period);
+	if (perf_event_overflow(event, &data, regs))
+		event->pmu->stop(event, 0);
+}
+
+/*
+ * Freeze or unfreeze the counter sets of all active event types, so that
+ * the events selected one by one afterwards are read from one snapshot.
+ */
+static void fme_perf_freeze(struct fme_perf_priv *priv, bool freeze)
+{
+	struct fme_perf_event_ops *ops;
+	u32 evtype;
+	u64 v;
+
+	if (priv->frozen == freeze)
+		return;
+
+	for (evtype = 0; evtype <= FME_EVTYPE_MAX; evtype++) {
+		ops = get_event_ops(evtype);
+		if (!ops->freeze || !priv->nr_active[evtype])
+			continue;
+
+		v = readq(priv->ioaddr + ops->ctrl);
+		if (freeze)
+			v |= ops->freeze;
+		else
+			v &= ~ops->freeze;
+		writeq(v, priv->ioaddr + ops->ctrl);
+	}
+
+	priv->frozen = freeze;
+}
+
+static enum hrtimer_restart fme_perf_hrtimer(struct hrtimer *hrtimer)
+{
+	struct fme_perf_priv *priv;
+	struct perf_event *event;
+	struct pt_regs *regs;
+	u64 delta;
+
+	priv = container_of(hrtimer, struct fme_perf_priv, hrtimer);
+	if (list_empty(&priv->active_list))
+		return HRTIMER_NORESTART;
 
-	now = ops->read_counter(priv, (u32)hwc->idx, hwc->config_base);
-	prev = local64_read(&hwc->prev_count);
-	delta = now - prev;
+	regs = get_irq_regs();
 
-	local64_add(delta, &event->count);
+	fme_perf_freeze(priv, true);
+
+	list_for_each_entry(event, &priv->active_list, active_entry) {
+		if (event->hw.state & PERF_HES_STOPPED)
+			continue;
+
+		if (fme_perf_event_update(event, &delta))
+			continue;
+
+		if (is_sampling_event(event))
+			fme_perf_event_sample(event, delta, regs);
+	}
+
+	fme_perf_freeze(priv, false);
+
+	hrtimer_forward_now(hrtimer, fme_perf_timer_interval());
+
+	return HRTIMER_RESTART;
 }
 
 static void fme_perf_event_start(struct perf_event *event, int flags)
@@ -858,33 +1090,106 @@ static void fme_perf_event_start(struct perf_event *event, int flags)
 	struct fme_perf_event_ops *ops = get_event_ops(event->hw.event_base);
 	struct fme_perf_priv *priv = to_fme_perf_priv(event->pmu);
 	struct hw_perf_event *hwc = &event->hw;
-	u64 count;
+	u64 count = 0;
 
-	count = ops->read_counter(priv, (u32)hwc->idx, hwc->config_base);
+	if (ops->read_counter(priv, (u32)hwc->idx, hwc->config_base, &count))
+		hwc->flags |= FME_PERF_HWC_RESYNC;
+	else
+		hwc->flags &= ~FME_PERF_HWC_RESYNC;
 	local64_set(&hwc->prev_count, count);
+
+	if (is_sampling_event(event))
+		fme_perf_event_set_period(event);
+
+	hwc->state = 0;
 }
 
 static void fme_perf_event_stop(struct perf_event *event, int flags)
 {
-	fme_perf_event_update(event);
+	struct hw_perf_event *hwc = &event->hw;
+	u64 delta;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	fme_perf_event_update(event, &delta);
+	hwc->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
 }
 
+/*
+ * add/del and the accumulation timer all run on priv->cpu with interrupts
+ * disabled, which serializes the active list and the shared counter select
+ * registers without extra locking.
+ */
 static int fme_perf_event_add(struct perf_event *event, int flags)
 {
+	struct fme_perf_priv *priv = to_fme_perf_priv(event->pmu);
+	bool first = list_empty(&priv->active_list);
+
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+	list_add_tail(&event->active_entry, &priv->active_list);
+	priv->nr_active[event->hw.event_base]++;
+
 	if (flags & PERF_EF_START)
 		fme_perf_event_start(event, flags);
 
+	if (first)
+		hrtimer_start(&priv->hrtimer, fme_perf_timer_interval(),
+			      HRTIMER_MODE_REL_PINNED);
+
 	return 0;
 }
 
 static void fme_perf_event_del(struct perf_event *event, int flags)
 {
+	struct fme_perf_priv *priv = to_fme_perf_priv(event->pmu);
+
 	fme_perf_event_stop(event, PERF_EF_UPDATE);
+
+	list_del(&event->active_entry);
+	priv->nr_active[event->hw.event_base]--;
+	if (list_empty(&priv->active_list))
+		hrtimer_cancel(&priv->hrtimer);
 }
 
 static void fme_perf_event_read(struct perf_event *event)
 {
-	fme_perf_event_update(event);
+	struct fme_perf_priv *priv = to_fme_perf_priv(event->pmu);
+	u64 delta;
+
+	if (event->hw.state & PERF_HES_STOPPED)
+		return;
+
+	/*
+	 * Group reads (PERF_FORMAT_GROUP) come in a read transaction, freeze
+	 * once on the first member and unfreeze at commit.
+	 */
+	if (priv->txn_flags & PERF_PMU_TXN_READ)
+		fme_perf_freeze(priv, true);
+
+	fme_perf_event_update(event, &delta);
+}
+
+static void fme_perf_start_txn(struct pmu *pmu, unsigned int txn_flags)
+{
+	struct fme_perf_priv *priv = to_fme_perf_priv(pmu);
+
+	priv->txn_flags = txn_flags;
+}
+
+static int fme_perf_commit_txn(struct pmu *pmu)
+{
+	struct fme_perf_priv *priv = to_fme_perf_priv(pmu);
+
+	fme_perf_freeze(priv, false);
+	priv->txn_flags = 0;
+
+	return 0;
+}
+
+static void fme_perf_cancel_txn(struct pmu *pmu)
+{
+	fme_perf_commit_txn(pmu);
 }
 
 static void fme_perf_setup_hardware(struct fme_perf_priv *priv)
@@ -909,6 +1214,9 @@ static int fme_perf_pmu_register(struct platform_device *pdev,
 	int ret;
 
 	spin_lock_init(&priv->fab_lock);
+	INIT_LIST_HEAD(&priv->active_list);
+	hrtimer_init(&priv->hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	priv->hrtimer.function = fme_perf_hrtimer;
 
 	fme_perf_setup_hardware(priv);
 
@@ -921,8 +1229,10 @@ static int fme_perf_pmu_register(struct platform_device *pdev,
 	pmu->start =		fme_perf_event_start;
 	pmu->stop =		fme_perf_event_stop;
 	pmu->read =		fme_perf_event_read;
-	pmu->capabilities =	PERF_PMU_CAP_NO_INTERRUPT |
-				PERF_PMU_CAP_NO_EXCLUDE;
+	pmu->start_txn =	fme_perf_start_txn;
+	pmu->commit_txn =	fme_perf_commit_txn;
+	pmu->cancel_txn =	fme_perf_cancel_txn;
+	pmu->capabilities =	PERF_PMU_CAP_NO_EXCLUDE;
 
 	name = devm_kasprintf(priv->dev, GFP_KERNEL, "dfl_fme%d", pdev->id);
 
@@ -468,8 +468,14 @@ const struct dfl_feature_id fme_pr_mgmt_id_table[] = {
 	{0}
 };
 
+static const unsigned int fme_pr_mgmt_ioctl_cmds[] = {
+	DFL_FPGA_FME_PORT_PR,
+	0
+};
+
 const struct dfl_feature_ops fme_pr_mgmt_ops = {
 	.init = pr_mgmt_init,
 	.uinit = pr_mgmt_uinit,
 	.ioctl = fme_pr_ioctl,
+	.ioctl_cmds = fme_pr_mgmt_ioctl_cmds,
 };
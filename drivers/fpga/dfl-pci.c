@@ -484,9 +484,25 @@ static struct pci_driver cci_pci_driver = {
 	.probe = cci_pci_probe,
 	.remove = cci_pci_remove,
 	.sriov_configure = cci_pci_sriov_configure,
+	.driver = {
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
+	},
 };
 
-module_pci_driver(cci_pci_driver);
+static int __init cci_pci_init(void)
+{
+	if (!dfl_fpga_async_probe())
+		cci_pci_driver.driver.probe_type = PROBE_DEFAULT_STRATEGY;
+
+	return pci_register_driver(&cci_pci_driver);
+}
+module_init(cci_pci_init);
+
+static void __exit cci_pci_exit(void)
+{
+	pci_unregister_driver(&cci_pci_driver);
+}
+module_exit(cci_pci_exit);
 
 MODULE_DESCRIPTION("FPGA DFL PCIe Device Driver");
 MODULE_AUTHOR("Intel Corporation");
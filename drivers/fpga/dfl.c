@@ -10,15 +10,32 @@
  *   Wu Hao <hao.wu@intel.com>
  *   Xiao Guangrong <guangrong.xiao@linux.intel.com>
  */
+#include <linux/bitmap.h>
 #include <linux/dfl.h>
 #include <linux/fpga-dfl.h>
+#include <linux/jhash.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/overflow.h>
+#include <linux/sort.h>
 #include <linux/uaccess.h>
 #include <linux/version.h>
+#include <linux/vmalloc.h>
 
 #include "dfl.h"
 
+static bool snapshot;
+module_param(snapshot, bool, 0444);
+MODULE_PARM_DESC(snapshot, "Record DFL enumeration for the dfl_snapshot region attribute");
+
+static bool async_probe = true;
+module_param(async_probe, bool, 0444);
+MODULE_PARM_DESC(async_probe, "Probe DFL bus drivers asynchronously unless they force synchronous probing");
+
+static bool probe_timing;
+module_param(probe_timing, bool, 0644);
+MODULE_PARM_DESC(probe_timing, "Log the time spent in enumeration and in each DFL device probe");
+
 static DEFINE_MUTEX(dfl_id_mutex);
 
 /*
@@ -272,8 +289,19 @@ static int dfl_bus_probe(struct device *dev)
 {
 	struct dfl_driver *ddrv = to_dfl_drv(dev->driver);
 	struct dfl_device *ddev = to_dfl_dev(dev);
+	ktime_t start;
+	int ret;
 
-	return ddrv->probe(ddev);
+	if (!probe_timing)
+		return ddrv->probe(ddev);
+
+	start = ktime_get();
+	ret = ddrv->probe(ddev);
+	dev_info(dev, "probe of feature 0x%x by %s returned %d after %lld usecs\n",
+		 ddev->feature_id, dev->driver->name, ret,
+		 ktime_us_delta(ktime_get(), start));
+
+	return ret;
 }
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(5, 15, 0) && RHEL_RELEASE_CODE < 0x902
@@ -508,6 +536,14 @@ int __dfl_driver_register(struct dfl_driver *dfl_drv, struct module *owner)
 	dfl_drv->drv.owner = owner;
 	dfl_drv->drv.bus = &dfl_bus_type;
 
+	/*
+	 * DFL devices on one card, and on different cards, are independent
+	 * of each other. Let them probe in parallel so that slow drivers,
+	 * e.g. ones polling for firmware to come up, don't serialize boot.
+	 */
+	if (async_probe && dfl_drv->drv.probe_type == PROBE_DEFAULT_STRATEGY)
+		dfl_drv->drv.probe_type = PROBE_PREFER_ASYNCHRONOUS;
+
 	return driver_register(&dfl_drv->drv);
 }
 EXPORT_SYMBOL(__dfl_driver_register);
@@ -541,6 +577,8 @@ void dfl_fpga_dev_feature_uinit(struct platform_device *pdev)
 
 	dfl_devs_remove(fdata);
 
+	memset(fdata->ioctl_map, 0, DFL_IOCTL_NR_MAX * sizeof(*fdata->ioctl_map));
+
 	dfl_fpga_dev_for_each_feature(fdata, feature) {
 		if (feature->ops) {
 			if (feature->ops->uinit)
@@ -583,21 +621,80 @@ static int dfl_feature_instance_init(struct platform_device *pdev,
 	return ret;
 }
 
-static bool dfl_feature_drv_match(struct dfl_feature *feature,
-				  struct dfl_feature_driver *driver)
+static u32 dfl_guid_hash(const guid_t *guid, unsigned int bits)
+{
+	return hash_32(jhash(guid, sizeof(*guid), 0), bits);
+}
+
+/*
+ * Initialize the sub features matching one driver. Each entry of its
+ * id_table is looked up in the id and guid indexes of the feature dev, and
+ * the matches are then initialized in enumeration order, as they were
+ * before the indexes existed.
+ */
+static int dfl_feature_drv_bind(struct platform_device *pdev,
+				struct dfl_feature_platform_data *pdata,
+				struct dfl_feature_driver *drv)
 {
-	const struct dfl_feature_id *ids = driver->id_table;
+	struct dfl_feature_dev_data *fdata = pdata->fdata;
+	const struct dfl_feature_id *ids = drv->id_table;
+	struct dfl_feature *feature;
+	struct hlist_head *head;
+	unsigned long *match;
+	unsigned int i;
+	int ret = 0;
+
+	if (!ids || !fdata->num)
+		return 0;
+
+	match = bitmap_zalloc(fdata->num, GFP_KERNEL);
+	if (!match)
+		return -ENOMEM;
 
-	if (ids) {
-		while (ids->id || dfl_guid_is_valid(&ids->guid)) {
-			if ((dfl_guid_is_valid(&feature->guid) &&
-			     guid_equal(&ids->guid, &feature->guid)) ||
-					ids->id == feature->id)
-				return true;
-			ids++;
+	for (; ids->id || dfl_guid_is_valid(&ids->guid); ids++) {
+		if (dfl_guid_is_valid(&ids->guid)) {
+			head = &fdata->guid_hash[dfl_guid_hash(&ids->guid,
+							       fdata->hash_bits)];
+			hlist_for_each_entry(feature, head, guid_node)
+				if (guid_equal(&ids->guid, &feature->guid))
+					__set_bit(feature - fdata->features,
+						  match);
 		}
+
+		head = dfl_feature_id_bucket(fdata, ids->id);
+		hlist_for_each_entry(feature, head, id_node)
+			if (feature->id == ids->id)
+				__set_bit(feature - fdata->features, match);
+	}
+
+	for_each_set_bit(i, match, fdata->num) {
+		ret = dfl_feature_instance_init(pdev, pdata,
+						&fdata->features[i], drv);
+		if (ret)
+			break;
+	}
+
+	bitmap_free(match);
+
+	return ret;
+}
+
+static void dfl_feature_ioctl_map_add(struct dfl_feature_dev_data *fdata,
+				      struct dfl_feature *feature)
+{
+	const unsigned int *cmd;
+
+	if (!feature->ops->ioctl || !feature->ops->ioctl_cmds)
+		return;
+
+	for (cmd = feature->ops->ioctl_cmds; *cmd; cmd++) {
+		if (WARN_ON(_IOC_TYPE(*cmd) != DFL_FPGA_MAGIC))
+			continue;
+
+		/* the first sub feature claiming a command handles it */
+		if (!fdata->ioctl_map[_IOC_NR(*cmd)])
+			fdata->ioctl_map[_IOC_NR(*cmd)] = feature;
 	}
-	return false;
 }
 
 /**
@@ -620,17 +717,16 @@ int dfl_fpga_dev_feature_init(struct platform_device *pdev,
 	int ret;
 
 	while (drv->ops) {
-		dfl_fpga_dev_for_each_feature(fdata, feature) {
-			if (dfl_feature_drv_match(feature, drv)) {
-				ret = dfl_feature_instance_init(pdev, pdata,
-								feature, drv);
-				if (ret)
-					goto exit;
-			}
-		}
+		ret = dfl_feature_drv_bind(pdev, pdata, drv);
+		if (ret)
+			goto exit;
 		drv++;
 	}
 
+	dfl_fpga_dev_for_each_feature(fdata, feature)
+		if (feature->ops)
+			dfl_feature_ioctl_map_add(fdata, feature);
+
 	ret = dfl_devs_add(fdata);
 	if (ret)
 		goto exit;
@@ -642,6 +738,48 @@ exit:
 }
 EXPORT_SYMBOL_GPL(dfl_fpga_dev_feature_init);
 
+/**
+ * dfl_feature_dev_ioctl - dispatch an ioctl to the sub features
+ * @fdata: dfl feature dev data.
+ * @cmd: ioctl command.
+ * @arg: ioctl argument.
+ *
+ * Commands declared in the ioctl_cmds of a sub feature driver go straight
+ * to that sub feature. Any other command is offered to the sub features
+ * whose driver doesn't declare its commands, in order.
+ *
+ * Return: the sub feature ioctl result, -EINVAL if no sub feature handles it.
+ */
+long dfl_feature_dev_ioctl(struct dfl_feature_dev_data *fdata,
+			   unsigned int cmd, unsigned long arg)
+{
+	const struct dfl_feature_ops *ops;
+	struct dfl_feature *f;
+	long ret;
+
+	if (_IOC_TYPE(cmd) == DFL_FPGA_MAGIC) {
+		f = READ_ONCE(fdata->ioctl_map[_IOC_NR(cmd)]);
+		ops = f ? READ_ONCE(f->ops) : NULL;
+		if (ops && ops->ioctl) {
+			ret = ops->ioctl(fdata->dev, f, cmd, arg);
+			if (ret != -ENODEV)
+				return ret;
+		}
+	}
+
+	dfl_fpga_dev_for_each_feature(fdata, f) {
+		ops = READ_ONCE(f->ops);
+		if (ops && ops->ioctl && !ops->ioctl_cmds) {
+			ret = ops->ioctl(fdata->dev, f, cmd, arg);
+			if (ret != -ENODEV)
+				return ret;
+		}
+	}
+
+	return -EINVAL;
+}
+EXPORT_SYMBOL_GPL(dfl_feature_dev_ioctl);
+
 static void dfl_chardev_uinit(void)
 {
 	int i;
@@ -736,6 +874,12 @@ EXPORT_SYMBOL_GPL(dfl_fpga_dev_ops_unregister);
  * @len: max register resource length of current FIU.
  * @sub_features: a sub features linked list for feature device in enumeration.
  * @feature_num: number of sub features for feature device in enumeration.
+ * @dfh_windows: header words bulk copied from the DFHs of the current DFL
+ *		 not walked past yet.
+ * @snap_words: DFL words read during enumeration, if snapshot is enabled.
+ * @snap_nr_words: number of entries used in @snap_words.
+ * @snap_max_words: number of entries allocated in @snap_words.
+ * @snap_failed: a word could not be recorded, the snapshot is incomplete.
  */
 struct build_feature_devs_info {
 	struct device *dev;
@@ -749,6 +893,12 @@ struct build_feature_devs_info {
 	resource_size_t len;
 	struct list_head sub_features;
 	int feature_num;
+	struct list_head dfh_windows;
+
+	struct dfl_snapshot_word *snap_words;
+	unsigned int snap_nr_words;
+	unsigned int snap_max_words;
+	bool snap_failed;
 };
 
 /**
@@ -788,6 +938,42 @@ static void dfl_fpga_cdev_add_port_data(struct dfl_fpga_cdev *cdev,
 	mutex_unlock(&cdev->lock);
 }
 
+/*
+ * Index the sub features by id and guid, so that lookups and sub feature
+ * driver matching don't depend on how many features the device has.
+ */
+static int dfl_feature_index_init(struct device *dev,
+				  struct dfl_feature_dev_data *fdata)
+{
+	unsigned int bits = order_base_2(fdata->num) + 1;
+	struct dfl_feature *feature;
+	int i;
+
+	fdata->id_hash = devm_kcalloc(dev, BIT(bits), sizeof(*fdata->id_hash),
+				      GFP_KERNEL);
+	fdata->guid_hash = devm_kcalloc(dev, BIT(bits),
+					sizeof(*fdata->guid_hash), GFP_KERNEL);
+	fdata->ioctl_map = devm_kcalloc(dev, DFL_IOCTL_NR_MAX,
+					sizeof(*fdata->ioctl_map), GFP_KERNEL);
+	if (!fdata->id_hash || !fdata->guid_hash || !fdata->ioctl_map)
+		return -ENOMEM;
+
+	fdata->hash_bits = bits;
+
+	/* add in reverse, so that buckets keep the enumeration order */
+	for (i = fdata->num - 1; i >= 0; i--) {
+		feature = &fdata->features[i];
+
+		hlist_add_head(&feature->id_node,
+			       dfl_feature_id_bucket(fdata, feature->id));
+		if (dfl_guid_is_valid(&feature->guid))
+			hlist_add_head(&feature->guid_node,
+				       &fdata->guid_hash[dfl_guid_hash(&feature->guid, bits)]);
+	}
+
+	return 0;
+}
+
 static struct dfl_feature_dev_data *
 binfo_create_feature_dev_data(struct build_feature_devs_info *binfo)
 {
@@ -885,9 +1071,12 @@ binfo_create_feature_dev_data(struct build_feature_devs_info *binfo)
 				ret = -ENOMEM;
 				goto err_free_id;
 			}
-			for (i = 0; i < finfo->nr_irqs; i++)
+			for (i = 0; i < finfo->nr_irqs; i++) {
 				ctx[i].irq =
 					binfo->irq_table[finfo->irq_base + i];
+				ctx[i].cpu = -1;
+				ctx[i].index = i;
+			}
 
 			feature->irq_ctx = ctx;
 			feature->nr_irqs = finfo->nr_irqs;
@@ -899,6 +1088,10 @@ binfo_create_feature_dev_data(struct build_feature_devs_info *binfo)
 
 	fdata->resource_num = res_idx;
 
+	ret = dfl_feature_index_init(binfo->dev, fdata);
+	if (ret)
+		goto err_free_id;
+
 	return fdata;
 
 err_free_id:
@@ -985,6 +1178,49 @@ static int build_info_commit_dev(struct build_feature_devs_info *binfo)
 	return 0;
 }
 
+/**
+ * struct dfl_dfh_window - header words of one DFH copied in a single pass
+ *
+ * @node: node in dfh_windows list of build_feature_devs_info.
+ * @addr: bus address of the DFH.
+ * @nr_words: number of valid entries in @words.
+ * @words: copy of the header words, starting with the DFH itself.
+ */
+struct dfl_dfh_window {
+	struct list_head node;
+	resource_size_t addr;
+	unsigned int nr_words;
+	u64 words[];
+};
+
+static void dfl_dfh_cache_free(struct build_feature_devs_info *binfo)
+{
+	struct dfl_dfh_window *win, *tmp;
+
+	list_for_each_entry_safe(win, tmp, &binfo->dfh_windows, node) {
+		list_del(&win->node);
+		kfree(win);
+	}
+}
+
+/*
+ * The walk of a DFL only moves forward, so the windows of the DFHs it has
+ * gone past are never looked up again. Drop them, so that the lookups of
+ * long lists do not have to go through every DFH seen so far.
+ */
+static void dfl_dfh_cache_trim(struct build_feature_devs_info *binfo,
+			       resource_size_t addr)
+{
+	struct dfl_dfh_window *win, *tmp;
+
+	list_for_each_entry_safe(win, tmp, &binfo->dfh_windows, node) {
+		if (win->addr + win->nr_words * sizeof(u64) <= addr) {
+			list_del(&win->node);
+			kfree(win);
+		}
+	}
+}
+
 static void build_info_free(struct build_feature_devs_info *binfo)
 {
 	struct dfl_feature_info *finfo, *p;
@@ -996,10 +1232,149 @@ static void build_info_free(struct build_feature_devs_info *binfo)
 		}
 	}
 
+	dfl_dfh_cache_free(binfo);
+	kfree(binfo->snap_words);
 	devm_kfree(binfo->dev, binfo);
 }
 
-static inline u32 feature_size(void __iomem *dfh_ioaddr, void __iomem *end, u64 value)
+static void dfl_snapshot_add(struct build_feature_devs_info *binfo,
+			     resource_size_t ofst, u64 v)
+{
+	struct dfl_snapshot_word *words;
+	unsigned int max;
+
+	if (binfo->snap_nr_words == binfo->snap_max_words) {
+		max = max(binfo->snap_max_words * 2, 256U);
+		words = krealloc(binfo->snap_words, max * sizeof(*words), GFP_KERNEL);
+		if (!words) {
+			binfo->snap_failed = true;
+			return;
+		}
+
+		binfo->snap_words = words;
+		binfo->snap_max_words = max;
+	}
+
+	words = &binfo->snap_words[binfo->snap_nr_words++];
+	words->addr = binfo->start + ofst;
+	words->val = v;
+}
+
+static bool dfl_dfh_cache_read(struct build_feature_devs_info *binfo,
+			       resource_size_t ofst, u64 *v)
+{
+	resource_size_t addr = binfo->start + ofst;
+	struct dfl_dfh_window *win;
+
+	/* lookups are almost always for the most recently copied DFH */
+	list_for_each_entry_reverse(win, &binfo->dfh_windows, node) {
+		if (addr >= win->addr &&
+		    addr < win->addr + win->nr_words * sizeof(u64)) {
+			*v = win->words[(addr - win->addr) / sizeof(u64)];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * All reads of the device feature list during enumeration go through
+ * dfl_readq() and dfl_read_words(), so that they can be recorded into a
+ * snapshot which replays the enumeration without hardware.
+ *
+ * dfl_read_words() copies @nr words starting at @ofst with one readq() per
+ * word. memcpy_fromio() is not used, as on x86 it splits the copy into
+ * 32-bit reads, which doubles the MMIO reads.
+ */
+static void dfl_read_words(struct build_feature_devs_info *binfo,
+			   resource_size_t ofst, u64 *words, unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		words[i] = readq(binfo->ioaddr + ofst + i * sizeof(u64));
+
+	if (snapshot)
+		for (i = 0; i < nr; i++)
+			dfl_snapshot_add(binfo, ofst + i * sizeof(u64), words[i]);
+}
+
+static u64 dfl_readq(struct build_feature_devs_info *binfo, resource_size_t ofst)
+{
+	u64 v;
+
+	if (dfl_dfh_cache_read(binfo, ofst, &v))
+		return v;
+
+	v = readq(binfo->ioaddr + ofst);
+
+	if (snapshot)
+		dfl_snapshot_add(binfo, ofst, v);
+
+	return v;
+}
+
+/*
+ * Number of words at the start of a feature which are defined by the DFH
+ * specification and so are safe to read ahead. DFHv0 private features put
+ * their own registers right after the DFH, those must not be touched.
+ */
+static unsigned int dfh_header_words(u64 dfh)
+{
+	if (FIELD_GET(DFH_VERSION, dfh) == 1)
+		return DFHv1_PARAM_HDR / sizeof(u64);
+
+	switch (FIELD_GET(DFH_TYPE, dfh)) {
+	case DFH_TYPE_FIU:
+		return NEXT_AFU / sizeof(u64) + 1;
+	case DFH_TYPE_AFU:
+		return GUID_H / sizeof(u64) + 1;
+	default:
+		return 1;
+	}
+}
+
+/*
+ * Read the DFH at @ofst. The first time a DFH is seen all of its header
+ * words are copied in one go, so that later reads of the DFH, GUID and CSR
+ * location words done while parsing the feature are served from memory
+ * instead of issuing a new MMIO read each time.
+ */
+static u64 dfl_read_dfh(struct build_feature_devs_info *binfo,
+			resource_size_t ofst)
+{
+	struct dfl_dfh_window *win;
+	unsigned int nr;
+	u64 v;
+
+	if (dfl_dfh_cache_read(binfo, ofst, &v))
+		return v;
+
+	v = dfl_readq(binfo, ofst);
+
+	nr = min_t(resource_size_t, dfh_header_words(v),
+		   (binfo->len - ofst) / sizeof(u64));
+	if (!nr)
+		return v;
+
+	/* on allocation failure fall back to reading the words one by one */
+	win = kmalloc(struct_size(win, words, nr), GFP_KERNEL);
+	if (!win)
+		return v;
+
+	win->addr = binfo->start + ofst;
+	win->nr_words = nr;
+	win->words[0] = v;
+	dfl_read_words(binfo, ofst + sizeof(u64), &win->words[1], nr - 1);
+
+	list_add_tail(&win->node, &binfo->dfh_windows);
+
+	return v;
+}
+
+static u32 feature_size(struct build_feature_devs_info *binfo,
+			resource_size_t dfh_ofst, u64 value)
 {
 	u32 ofst = FIELD_GET(DFH_NEXT_HDR_OFST, value);
 	/* workaround for private features with invalid size, use 4K instead */
@@ -1010,7 +1385,7 @@ static inline u32 feature_size(void __iomem *dfh_ioaddr, void __iomem *end, u64
 		return ofst;
 
 	do {
-		value = readq(dfh_ioaddr + ofst);
+		value = dfl_read_dfh(binfo, dfh_ofst + ofst);
 
 		if (FIELD_GET(DFH_TYPE, value) != DFH_TYPE_INTERFACE)
 			return ofst;
@@ -1020,7 +1395,7 @@ static inline u32 feature_size(void __iomem *dfh_ioaddr, void __iomem *end, u64
 		if (value & DFH_EOL)
 			return ofst;
 
-	} while ((dfh_ioaddr + ofst) < end);
+	} while (dfh_ofst + ofst < binfo->len);
 
 	return 0;
 }
@@ -1083,10 +1458,36 @@ void *dfh_find_param(struct dfl_device *dfl_dev, int param_id, size_t *psize)
 }
 EXPORT_SYMBOL_GPL(dfh_find_param);
 
+/**
+ * dfh_get_u64_param_val() - get the value of a single u64 parameter
+ * @dfl_dev: dfl device
+ * @param_id: id of dfl parameter
+ * @pval: destination to store the parameter value
+ *
+ * Return: 0 on success, -ENOENT if the parameter is not present, -EINVAL if
+ * its data is not a single u64.
+ */
+int dfh_get_u64_param_val(struct dfl_device *dfl_dev, int param_id, u64 *pval)
+{
+	size_t psize;
+	u64 *p;
+
+	p = dfh_find_param(dfl_dev, param_id, &psize);
+	if (IS_ERR(p))
+		return PTR_ERR(p);
+
+	if (psize != sizeof(*pval))
+		return -EINVAL;
+
+	*pval = *p;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dfh_get_u64_param_val);
+
 static int parse_feature_irqs(struct build_feature_devs_info *binfo,
 			      resource_size_t ofst, struct dfl_feature_info *finfo)
 {
-	void __iomem *base = binfo->ioaddr + ofst;
 	unsigned int i, ibase, inr = 0;
 	void *params = finfo->params;
 	enum dfl_id_type type;
@@ -1107,12 +1508,12 @@ static int parse_feature_irqs(struct build_feature_devs_info *binfo,
 		if (type == PORT_ID) {
 			switch (fid) {
 			case PORT_FEATURE_ID_UINT:
-				v = readq(base + PORT_UINT_CAP);
+				v = dfl_readq(binfo, ofst + PORT_UINT_CAP);
 				ibase = FIELD_GET(PORT_UINT_CAP_FST_VECT, v);
 				inr = FIELD_GET(PORT_UINT_CAP_INT_NUM, v);
 				break;
 			case PORT_FEATURE_ID_ERROR:
-				v = readq(base + PORT_ERROR_CAP);
+				v = dfl_readq(binfo, ofst + PORT_ERROR_CAP);
 				ibase = FIELD_GET(PORT_ERROR_CAP_INT_VECT, v);
 				inr = FIELD_GET(PORT_ERROR_CAP_SUPP_INT, v);
 				break;
@@ -1120,7 +1521,7 @@ static int parse_feature_irqs(struct build_feature_devs_info *binfo,
 		} else if (type == FME_ID) {
 			switch (fid) {
 			case FME_FEATURE_ID_GLOBAL_ERR:
-				v = readq(base + FME_ERROR_CAP);
+				v = dfl_readq(binfo, ofst + FME_ERROR_CAP);
 				ibase = FIELD_GET(FME_ERROR_CAP_INT_VECT, v);
 				inr = FIELD_GET(FME_ERROR_CAP_SUPP_INT, v);
 				break;
@@ -1178,29 +1579,82 @@ static int parse_feature_irqs(struct build_feature_devs_info *binfo,
 	return 0;
 }
 
-static int dfh_get_param_size(void __iomem *dfh_base, resource_size_t max)
+static int dfh_params_reserve(u64 **params, unsigned int *max_nr,
+			      unsigned int nr)
 {
-	int size = 0;
-	u64 v, next;
+	u64 *p;
+
+	if (nr <= *max_nr)
+		return 0;
+
+	nr = max3(nr, *max_nr * 2, 16U);
+	p = krealloc(*params, nr * sizeof(u64), GFP_KERNEL);
+	if (!p)
+		return -ENOMEM;
+
+	*params = p;
+	*max_nr = nr;
+
+	return 0;
+}
+
+/*
+ * Copy the DFHv1 parameter block of the feature at @dfh_ofst into a newly
+ * allocated buffer returned in @pparams, and return its size in bytes. Each
+ * word is read from the device exactly once: the parameter headers are
+ * parsed from the copy, one parameter at a time, which also gives the size
+ * of the next chunk to copy.
+ */
+static int dfh_read_params(struct build_feature_devs_info *binfo,
+			   resource_size_t dfh_ofst, resource_size_t max,
+			   u64 **pparams)
+{
+	unsigned int nr = 0, max_nr = 0, next;
+	resource_size_t ofst = dfh_ofst + DFHv1_PARAM_HDR;
+	u64 *params = NULL;
+	int ret = -ENOENT;
+
+	*pparams = NULL;
 
 	if (!FIELD_GET(DFHv1_CSR_SIZE_GRP_HAS_PARAMS,
-		       readq(dfh_base + DFHv1_CSR_SIZE_GRP)))
+		       dfl_readq(binfo, dfh_ofst + DFHv1_CSR_SIZE_GRP)))
 		return 0;
 
-	while (size + DFHv1_PARAM_HDR < max) {
-		v = readq(dfh_base + DFHv1_PARAM_HDR + size);
+	max = min(max, binfo->len - dfh_ofst);
 
-		next = FIELD_GET(DFHv1_PARAM_HDR_NEXT_OFFSET, v);
-		if (!next)
-			return -EINVAL;
+	while (DFHv1_PARAM_HDR + (nr + 1) * sizeof(u64) <= max) {
+		ret = dfh_params_reserve(&params, &max_nr, nr + 1);
+		if (ret)
+			break;
 
-		size += next * sizeof(u64);
+		dfl_read_words(binfo, ofst + nr * sizeof(u64), &params[nr], 1);
 
-		if (FIELD_GET(DFHv1_PARAM_HDR_NEXT_EOP, v))
-			return size;
+		/* the parameter must not run past the end of the feature */
+		next = FIELD_GET(DFHv1_PARAM_HDR_NEXT_OFFSET, params[nr]);
+		if (!next || DFHv1_PARAM_HDR + (nr + next) * sizeof(u64) > max) {
+			ret = -EINVAL;
+			break;
+		}
+
+		ret = dfh_params_reserve(&params, &max_nr, nr + next);
+		if (ret)
+			break;
+
+		dfl_read_words(binfo, ofst + (nr + 1) * sizeof(u64),
+			       &params[nr + 1], next - 1);
+
+		if (FIELD_GET(DFHv1_PARAM_HDR_NEXT_EOP, params[nr])) {
+			*pparams = params;
+			return (nr + next) * sizeof(u64);
+		}
+
+		nr += next;
+		ret = -ENOENT;
 	}
 
-	return -ENOENT;
+	kfree(params);
+
+	return ret;
 }
 
 /*
@@ -1216,6 +1670,7 @@ create_feature_instance(struct build_feature_devs_info *binfo,
 {
 	struct dfl_feature_info *finfo;
 	resource_size_t start, end;
+	u64 *dfh_params = NULL;
 	int dfh_psize = 0;
 	u64 guid_l, guid_h;
 	u8 revision = 0;
@@ -1225,20 +1680,20 @@ create_feature_instance(struct build_feature_devs_info *binfo,
 	int ret;
 
 	if (fid != FEATURE_ID_AFU) {
-		v = readq(binfo->ioaddr + ofst);
+		v = dfl_read_dfh(binfo, ofst);
 		revision = FIELD_GET(DFH_REVISION, v);
 		dfh_ver = FIELD_GET(DFH_VERSION, v);
 
 		/* read feature size and id if inputs are invalid */
-		size = size ? size : feature_size(binfo->ioaddr + ofst,
-						  binfo->ioaddr + binfo->len, v);
+		size = size ? size : feature_size(binfo, ofst, v);
 		if (!size) {
 			dev_err(binfo->dev, "illegal feature with size of 0\n");
 			return -EINVAL;
 		}
 		fid = fid ? fid : feature_id(v);
 		if (dfh_ver == 1) {
-			dfh_psize = dfh_get_param_size(binfo->ioaddr + ofst, size);
+			dfh_psize = dfh_read_params(binfo, ofst, size,
+						    &dfh_params);
 			if (dfh_psize < 0) {
 				dev_err(binfo->dev,
 					"failed to read size of DFHv1 parameters %d\n",
@@ -1249,21 +1704,27 @@ create_feature_instance(struct build_feature_devs_info *binfo,
 		}
 	}
 
-	if (binfo->len - ofst < size)
+	if (binfo->len - ofst < size) {
+		kfree(dfh_params);
 		return -EINVAL;
+	}
 
 	finfo = kzalloc(struct_size(finfo, params, dfh_psize / sizeof(u64)), GFP_KERNEL);
-	if (!finfo)
+	if (!finfo) {
+		kfree(dfh_params);
 		return -ENOMEM;
+	}
 
-	memcpy_fromio(finfo->params, binfo->ioaddr + ofst + DFHv1_PARAM_HDR, dfh_psize);
+	if (dfh_psize)
+		memcpy(finfo->params, dfh_params, dfh_psize);
+	kfree(dfh_params);
 	finfo->param_size = dfh_psize;
 
 	finfo->fid = fid;
 	finfo->revision = revision;
 	finfo->dfh_version = dfh_ver;
 	if (dfh_ver == 1) {
-		v = readq(binfo->ioaddr + ofst + DFHv1_CSR_ADDR);
+		v = dfl_readq(binfo, ofst + DFHv1_CSR_ADDR);
 		addr_off = FIELD_GET(DFHv1_CSR_ADDR_MASK, v);
 		if (FIELD_GET(DFHv1_CSR_ADDR_REL, v)) {
 			start = addr_off << 1;
@@ -1273,7 +1734,7 @@ create_feature_instance(struct build_feature_devs_info *binfo,
 			rel_addr = true;
 		}
 
-		v = readq(binfo->ioaddr + ofst + DFHv1_CSR_SIZE_GRP);
+		v = dfl_readq(binfo, ofst + DFHv1_CSR_SIZE_GRP);
 		end = start + FIELD_GET(DFHv1_CSR_SIZE_GRP_SIZE, v) - 1;
 		if (rel_addr && (end > (binfo->start + ofst) + size)) {
 			kfree(finfo);
@@ -1281,8 +1742,8 @@ create_feature_instance(struct build_feature_devs_info *binfo,
 			return 0;
 		}
 
-		guid_l = readq(binfo->ioaddr + ofst + GUID_L);
-		guid_h = readq(binfo->ioaddr + ofst + GUID_H);
+		guid_l = dfl_readq(binfo, ofst + GUID_L);
+		guid_h = dfl_readq(binfo, ofst + GUID_H);
 
 		if (guid_l || guid_h) {
 			dev_dbg(binfo->dev, "dfl: GUID_H = 0x%llx , GUID_L = 0x%llx\n",
@@ -1323,7 +1784,7 @@ create_feature_instance(struct build_feature_devs_info *binfo,
 static int parse_feature_port_afu(struct build_feature_devs_info *binfo,
 				  resource_size_t ofst)
 {
-	u64 v = readq(binfo->ioaddr + PORT_HDR_CAP);
+	u64 v = dfl_readq(binfo, PORT_HDR_CAP);
 	u32 size = FIELD_GET(PORT_CAP_MMIO_SIZE, v) << 10;
 
 	WARN_ON(!size);
@@ -1405,7 +1866,7 @@ static int parse_feature_fiu(struct build_feature_devs_info *binfo,
 			return ret;
 	}
 
-	v = readq(binfo->ioaddr + DFH);
+	v = dfl_read_dfh(binfo, DFH);
 	id = FIELD_GET(DFH_ID, v);
 
 	type = dfh_id_to_type(id);
@@ -1423,7 +1884,7 @@ static int parse_feature_fiu(struct build_feature_devs_info *binfo,
 	 * find and parse FIU's child AFU via its NEXT_AFU register.
 	 * please note that only Port has valid NEXT_AFU pointer per spec.
 	 */
-	v = readq(binfo->ioaddr + NEXT_AFU);
+	v = dfl_readq(binfo, NEXT_AFU);
 
 	offset = FIELD_GET(NEXT_AFU_NEXT_DFH_OFST, v);
 	if (offset)
@@ -1439,7 +1900,7 @@ static int parse_feature_private(struct build_feature_devs_info *binfo,
 {
 	if (!is_feature_dev_detected(binfo)) {
 		dev_err(binfo->dev, "the private feature 0x%x does not belong to any AFU.\n",
-			feature_id(readq(binfo->ioaddr + ofst)));
+			feature_id(dfl_read_dfh(binfo, ofst)));
 		return -EINVAL;
 	}
 
@@ -1458,7 +1919,7 @@ static int parse_feature(struct build_feature_devs_info *binfo,
 	u64 v;
 	u32 type;
 
-	v = readq(binfo->ioaddr + ofst + DFH);
+	v = dfl_read_dfh(binfo, ofst + DFH);
 	type = FIELD_GET(DFH_TYPE, v);
 
 	switch (type) {
@@ -1497,11 +1958,13 @@ static int parse_feature_list(struct build_feature_devs_info *binfo,
 			return -EINVAL;
 		}
 
+		dfl_dfh_cache_trim(binfo, start);
+
 		ret = parse_feature(binfo, start - binfo->start);
 		if (ret)
 			return ret;
 
-		v = readq(binfo->ioaddr + start - binfo->start + DFH);
+		v = dfl_read_dfh(binfo, start - binfo->start + DFH);
 		ofst = FIELD_GET(DFH_NEXT_HDR_OFST, v);
 
 		/* stop parsing if EOL(End of List) is set or offset is 0 */
@@ -1511,6 +1974,7 @@ static int parse_feature_list(struct build_feature_devs_info *binfo,
 
 	/* commit current feature device when reach the end of list */
 	build_info_complete(binfo);
+	dfl_dfh_cache_free(binfo);
 
 	if (is_feature_dev_detected(binfo))
 		ret = build_info_commit_dev(binfo);
@@ -1518,6 +1982,20 @@ static int parse_feature_list(struct build_feature_devs_info *binfo,
 	return ret;
 }
 
+/**
+ * dfl_fpga_async_probe - check if DFL cards should be probed asynchronously
+ *
+ * Lets the drivers of the devices carrying DFLs follow the async_probe
+ * parameter of the dfl module, so a single knob controls the probe type.
+ *
+ * Return: true if asynchronous probing is enabled.
+ */
+bool dfl_fpga_async_probe(void)
+{
+	return async_probe;
+}
+EXPORT_SYMBOL_GPL(dfl_fpga_async_probe);
+
 struct dfl_fpga_enum_info *dfl_fpga_enum_info_alloc(struct device *dev)
 {
 	struct dfl_fpga_enum_info *info;
@@ -1632,6 +2110,102 @@ int dfl_fpga_enum_info_add_irq(struct dfl_fpga_enum_info *info,
 }
 EXPORT_SYMBOL_GPL(dfl_fpga_enum_info_add_irq);
 
+static int dfl_snapshot_cmp_word(const void *a, const void *b)
+{
+	const struct dfl_snapshot_word *wa = a, *wb = b;
+
+	return wa->addr < wb->addr ? -1 : wa->addr > wb->addr;
+}
+
+static ssize_t dfl_snapshot_read(struct file *filp, struct kobject *kobj,
+				 struct bin_attribute *attr, char *buf,
+				 loff_t off, size_t count)
+{
+	struct dfl_fpga_cdev *cdev = attr->private;
+
+	return memory_read_from_buffer(buf, count, &off, cdev->snapshot,
+				       cdev->snapshot_size);
+}
+
+/*
+ * Build the snapshot image from the words recorded during enumeration and
+ * expose it as the dfl_snapshot attribute of the container region.
+ */
+static int dfl_snapshot_commit(struct dfl_fpga_cdev *cdev,
+			       struct dfl_fpga_enum_info *info,
+			       struct build_feature_devs_info *binfo)
+{
+	struct dfl_snapshot_header *hdr;
+	struct dfl_snapshot_word *words;
+	struct dfl_snapshot_dfl *dfls;
+	unsigned int nr_dfls = 0, nr_words = 0, i;
+	struct dfl_fpga_enum_dfl *dfl;
+	int ret;
+
+	if (binfo->snap_failed)
+		return -ENOMEM;
+
+	list_for_each_entry(dfl, &info->dfls, node)
+		nr_dfls++;
+
+	sort(binfo->snap_words, binfo->snap_nr_words, sizeof(*binfo->snap_words),
+	     dfl_snapshot_cmp_word, NULL);
+
+	cdev->snapshot_size = sizeof(*hdr) + nr_dfls * sizeof(*dfls) +
+			      binfo->snap_nr_words * sizeof(*words);
+	cdev->snapshot = kvzalloc(cdev->snapshot_size, GFP_KERNEL);
+	if (!cdev->snapshot)
+		return -ENOMEM;
+
+	hdr = cdev->snapshot;
+	dfls = (struct dfl_snapshot_dfl *)(hdr + 1);
+	words = (struct dfl_snapshot_word *)(dfls + nr_dfls);
+
+	list_for_each_entry(dfl, &info->dfls, node) {
+		dfls->start = dfl->start;
+		dfls->len = dfl->len;
+		dfls++;
+	}
+
+	/* words may have been read more than once, keep one copy of each */
+	for (i = 0; i < binfo->snap_nr_words; i++) {
+		if (nr_words && words[nr_words - 1].addr == binfo->snap_words[i].addr)
+			continue;
+		words[nr_words++] = binfo->snap_words[i];
+	}
+
+	hdr->magic = DFL_SNAPSHOT_MAGIC;
+	hdr->version = DFL_SNAPSHOT_VERSION;
+	hdr->nr_dfls = nr_dfls;
+	hdr->nr_words = nr_words;
+	cdev->snapshot_size -= (binfo->snap_nr_words - nr_words) * sizeof(*words);
+
+	sysfs_bin_attr_init(&cdev->snapshot_attr);
+	cdev->snapshot_attr.attr.name = "dfl_snapshot";
+	cdev->snapshot_attr.attr.mode = 0400;
+	cdev->snapshot_attr.size = cdev->snapshot_size;
+	cdev->snapshot_attr.read = dfl_snapshot_read;
+	cdev->snapshot_attr.private = cdev;
+
+	ret = sysfs_create_bin_file(&cdev->region->dev.kobj, &cdev->snapshot_attr);
+	if (ret) {
+		kvfree(cdev->snapshot);
+		cdev->snapshot = NULL;
+	}
+
+	return ret;
+}
+
+static void dfl_snapshot_remove(struct dfl_fpga_cdev *cdev)
+{
+	if (!cdev->snapshot)
+		return;
+
+	sysfs_remove_bin_file(&cdev->region->dev.kobj, &cdev->snapshot_attr);
+	kvfree(cdev->snapshot);
+	cdev->snapshot = NULL;
+}
+
 static int remove_feature_dev(struct device *dev, void *data)
 {
 	struct dfl_feature_dev_data *fdata = to_dfl_feature_dev_data(dev);
@@ -1663,6 +2237,7 @@ dfl_fpga_feature_devs_enumerate(struct dfl_fpga_enum_info *info)
 	struct build_feature_devs_info *binfo;
 	struct dfl_fpga_enum_dfl *dfl;
 	struct dfl_fpga_cdev *cdev;
+	ktime_t start = ktime_get();
 	int ret = 0;
 
 	if (!info->dev)
@@ -1693,6 +2268,7 @@ dfl_fpga_feature_devs_enumerate(struct dfl_fpga_enum_info *info)
 	binfo->dev = info->dev;
 	binfo->cdev = cdev;
 	INIT_LIST_HEAD(&binfo->sub_features);
+	INIT_LIST_HEAD(&binfo->dfh_windows);
 
 	binfo->nr_irqs = info->nr_irqs;
 	if (info->nr_irqs)
@@ -1713,8 +2289,15 @@ dfl_fpga_feature_devs_enumerate(struct dfl_fpga_enum_info *info)
 		}
 	}
 
+	if (snapshot && dfl_snapshot_commit(cdev, info, binfo))
+		dev_warn(info->dev, "failed to create DFL snapshot\n");
+
 	build_info_free(binfo);
 
+	if (probe_timing)
+		dev_info(info->dev, "DFL enumeration took %lld usecs\n",
+			 ktime_us_delta(ktime_get(), start));
+
 	return cdev;
 
 unregister_region_exit:
@@ -1742,6 +2325,7 @@ void dfl_fpga_feature_devs_remove(struct dfl_fpga_cdev *cdev)
 
 	remove_feature_devs(cdev);
 
+	dfl_snapshot_remove(cdev);
 	fpga_region_unregister(cdev->region);
 	devm_kfree(cdev->parent, cdev);
 }
@@ -1973,17 +2557,156 @@ done:
 }
 EXPORT_SYMBOL_GPL(dfl_fpga_cdev_config_ports_vf);
 
-static irqreturn_t dfl_irq_handler(int irq, void *arg)
-{
-	struct eventfd_ctx *trigger = arg;
+/* max time a coalesced interrupt may be held back */
+#define DFL_IRQ_COALESCE_MAX_USECS	USEC_PER_SEC
 
-	eventfd_signal(trigger, 1);
-	return IRQ_HANDLED;
+/* max number of records in an irq completion ring */
+#define DFL_IRQ_RING_MAX_ENTRIES	(1U << 16)
+
+/**
+ * struct dfl_irq_ring - completion ring shared by the irqs of a sub feature
+ *
+ * @kref: held by the sub feature and by each userspace mapping.
+ * @lock: serializes producers, the irqs of the sub feature may fire on
+ *	  different cpus.
+ * @head: kernel copy of the head index, userspace may scribble on the
+ *	  shared one.
+ * @mask: number of records minus one.
+ * @size: size of the shared memory.
+ * @hdr: shared memory, the header followed by the records.
+ * @recs: records in the shared memory.
+ */
+struct dfl_irq_ring {
+	struct kref kref;
+	spinlock_t lock;
+	u32 head;
+	u32 mask;
+	size_t size;
+	struct dfl_fpga_irq_ring_hdr *hdr;
+	struct dfl_fpga_irq_ring_rec *recs;
+};
+
+static void dfl_irq_ring_push(struct dfl_irq_ring *ring, unsigned int index,
+			      unsigned int count)
+{
+	struct dfl_fpga_irq_ring_rec *rec;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	if (ring->head - READ_ONCE(ring->hdr->tail) > ring->mask) {
+		WRITE_ONCE(ring->hdr->overflow, ring->hdr->overflow + 1);
+	} else {
+		rec = &ring->recs[ring->head & ring->mask];
+		rec->index = index;
+		rec->count = count;
+		rec->timestamp = ktime_get_ns();
+		/* publish the record before the new head */
+		smp_store_release(&ring->hdr->head, ++ring->head);
+	}
+	spin_unlock_irqrestore(&ring->lock, flags);
+}
+
+static void dfl_irq_signal(struct dfl_feature_irq_ctx *ctx, unsigned int n)
+{
+	if (ctx->ring)
+		dfl_irq_ring_push(ctx->ring, ctx->index, n);
+
+	eventfd_signal(ctx->trigger, n);
+	atomic64_inc(&ctx->nr_signals);
+}
+
+static void dfl_irq_flush(struct dfl_feature_irq_ctx *ctx)
+{
+	int n = atomic_xchg(&ctx->pending, 0);
+
+	if (n)
+		dfl_irq_signal(ctx, n);
+}
+
+static irqreturn_t dfl_irq_handler(int irq, void *arg)
+{
+	struct dfl_feature_irq_ctx *ctx = arg;
+	unsigned int max_events = READ_ONCE(ctx->max_events);
+	struct dfl_fpga_irq_status *status = READ_ONCE(ctx->status);
+	int pending;
+
+	atomic64_inc(&ctx->nr_events);
+
+	/* busy pollers see the interrupt before any wakeup happens */
+	if (status) {
+		WRITE_ONCE(status->timestamp, ktime_get_ns());
+		smp_store_release(&status->count, status->count + 1);
+	}
+
+	if (max_events <= 1) {
+		dfl_irq_signal(ctx, 1);
+		return IRQ_HANDLED;
+	}
+
+	/*
+	 * Signal a full batch from the irq thread, otherwise make sure the
+	 * batch is signalled once max_usecs expires. IRQF_ONESHOT only masks
+	 * the vector until the thread has signalled the eventfd, there is no
+	 * masking until userspace has drained the batch: interrupts raised
+	 * after that are counted into the next batch.
+	 */
+	pending = atomic_inc_return(&ctx->pending);
+	if (pending >= max_events)
+		return IRQ_WAKE_THREAD;
+
+	if (pending == 1)
+		hrtimer_start(&ctx->timer,
+			      ns_to_ktime((u64)READ_ONCE(ctx->max_usecs) *
+					  NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+
+	return IRQ_HANDLED;
+}
+
+static irqreturn_t dfl_irq_thread(int irq, void *arg)
+{
+	struct dfl_feature_irq_ctx *ctx = arg;
+
+	hrtimer_try_to_cancel(&ctx->timer);
+	dfl_irq_flush(ctx);
+
+	return IRQ_HANDLED;
+}
+
+static enum hrtimer_restart dfl_irq_timer_fn(struct hrtimer *timer)
+{
+	struct dfl_feature_irq_ctx *ctx =
+		container_of(timer, struct dfl_feature_irq_ctx, timer);
+
+	dfl_irq_flush(ctx);
+
+	return HRTIMER_NORESTART;
+}
+
+/*
+ * Route an irq to the cpu requested by userspace, or by default to the cpus
+ * on the NUMA node of the device, so that completions are handled close to
+ * the memory and threads of the accelerator.
+ */
+static int dfl_irq_set_affinity(struct dfl_feature *feature, unsigned int idx)
+{
+	struct dfl_feature_irq_ctx *ctx = &feature->irq_ctx[idx];
+	int node;
+
+	if (ctx->cpu >= 0)
+		return irq_set_affinity_hint(ctx->irq, cpumask_of(ctx->cpu));
+
+	node = dev_to_node(feature->dev->dev.parent->parent);
+	if (node == NUMA_NO_NODE)
+		return irq_set_affinity_hint(ctx->irq, NULL);
+
+	return irq_set_affinity_hint(ctx->irq, cpumask_of_node(node));
 }
 
 static int do_set_irq_trigger(struct dfl_feature *feature, unsigned int idx,
 			      int fd)
 {
+	struct dfl_feature_irq_ctx *ctx = &feature->irq_ctx[idx];
 	struct platform_device *pdev = feature->dev;
 	struct eventfd_ctx *trigger;
 	int irq, ret;
@@ -1991,7 +2714,10 @@ static int do_set_irq_trigger(struct dfl_feature *feature, unsigned int idx,
 	irq = feature->irq_ctx[idx].irq;
 
 	if (feature->irq_ctx[idx].trigger) {
-		free_irq(irq, feature->irq_ctx[idx].trigger);
+		irq_set_affinity_hint(irq, NULL);
+		free_irq(irq, ctx);
+		hrtimer_cancel(&ctx->timer);
+		dfl_irq_flush(ctx);
 		kfree(feature->irq_ctx[idx].name);
 		eventfd_ctx_put(feature->irq_ctx[idx].trigger);
 		feature->irq_ctx[idx].trigger = NULL;
@@ -2012,13 +2738,21 @@ static int do_set_irq_trigger(struct dfl_feature *feature, unsigned int idx,
 		goto free_name;
 	}
 
-	ret = request_irq(irq, dfl_irq_handler, 0,
-			  feature->irq_ctx[idx].name, trigger);
+	hrtimer_init(&ctx->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	ctx->timer.function = dfl_irq_timer_fn;
+	atomic_set(&ctx->pending, 0);
+	ctx->trigger = trigger;
+
+	ret = request_threaded_irq(irq, dfl_irq_handler, dfl_irq_thread,
+				   IRQF_ONESHOT, feature->irq_ctx[idx].name, ctx);
 	if (!ret) {
-		feature->irq_ctx[idx].trigger = trigger;
+		if (dfl_irq_set_affinity(feature, idx))
+			dev_dbg(&pdev->dev, "failed to set affinity of irq %d\n",
+				irq);
 		return ret;
 	}
 
+	ctx->trigger = NULL;
 	eventfd_ctx_put(trigger);
 free_name:
 	kfree(feature->irq_ctx[idx].name);
@@ -2128,6 +2862,408 @@ long dfl_feature_ioctl_set_irq(struct platform_device *pdev,
 }
 EXPORT_SYMBOL_GPL(dfl_feature_ioctl_set_irq);
 
+/**
+ * dfl_feature_ioctl_set_irq_affinity - dfl feature _SET_IRQ_AFFINITY ioctl
+ *					interface.
+ * @pdev: the feature device which has the sub feature
+ * @feature: the dfl sub feature
+ * @arg: ioctl argument
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+long dfl_feature_ioctl_set_irq_affinity(struct platform_device *pdev,
+					struct dfl_feature *feature,
+					unsigned long arg)
+{
+	struct dfl_feature_platform_data *pdata = dev_get_platdata(&pdev->dev);
+	struct dfl_feature_dev_data *fdata = pdata->fdata;
+	struct dfl_fpga_irq_affinity aff;
+	long ret = 0;
+
+	if (!feature->nr_irqs)
+		return -ENOENT;
+
+	if (copy_from_user(&aff, (void __user *)arg, sizeof(aff)))
+		return -EFAULT;
+
+	if (aff.index >= feature->nr_irqs)
+		return -EINVAL;
+
+	if (aff.cpu >= 0 && (aff.cpu >= nr_cpu_ids || !cpu_online(aff.cpu)))
+		return -EINVAL;
+
+	mutex_lock(&fdata->lock);
+	feature->irq_ctx[aff.index].cpu = aff.cpu < 0 ? -1 : aff.cpu;
+	if (feature->irq_ctx[aff.index].trigger)
+		ret = dfl_irq_set_affinity(feature, aff.index);
+	mutex_unlock(&fdata->lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dfl_feature_ioctl_set_irq_affinity);
+
+/**
+ * dfl_feature_ioctl_set_irq_coalesce - dfl feature _SET_IRQ_COALESCE ioctl
+ *					interface.
+ * @pdev: the feature device which has the sub feature
+ * @feature: the dfl sub feature
+ * @arg: ioctl argument
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+long dfl_feature_ioctl_set_irq_coalesce(struct platform_device *pdev,
+					struct dfl_feature *feature,
+					unsigned long arg)
+{
+	struct dfl_feature_platform_data *pdata = dev_get_platdata(&pdev->dev);
+	struct dfl_feature_dev_data *fdata = pdata->fdata;
+	struct dfl_fpga_irq_coalesce co;
+	struct dfl_feature_irq_ctx *ctx;
+
+	if (!feature->nr_irqs)
+		return -ENOENT;
+
+	if (copy_from_user(&co, (void __user *)arg, sizeof(co)))
+		return -EFAULT;
+
+	if (co.index >= feature->nr_irqs)
+		return -EINVAL;
+
+	/* a partial batch must always be flushed by the timer */
+	if (co.max_events > 1 &&
+	    (!co.max_usecs || co.max_usecs > DFL_IRQ_COALESCE_MAX_USECS))
+		return -EINVAL;
+
+	ctx = &feature->irq_ctx[co.index];
+
+	mutex_lock(&fdata->lock);
+	WRITE_ONCE(ctx->max_usecs, co.max_usecs);
+	WRITE_ONCE(ctx->max_events, co.max_events);
+	if (ctx->trigger) {
+		/* don't leave events from the old setting behind */
+		hrtimer_cancel(&ctx->timer);
+		dfl_irq_flush(ctx);
+	}
+	mutex_unlock(&fdata->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dfl_feature_ioctl_set_irq_coalesce);
+
+static void dfl_irq_ring_release(struct kref *kref)
+{
+	struct dfl_irq_ring *ring = container_of(kref, struct dfl_irq_ring, kref);
+
+	vfree(ring->hdr);
+	kfree(ring);
+}
+
+static bool dfl_feature_irq_bound(struct dfl_feature *feature)
+{
+	unsigned int i;
+
+	for (i = 0; i < feature->nr_irqs; i++)
+		if (feature->irq_ctx[i].trigger)
+			return true;
+
+	return false;
+}
+
+static void dfl_feature_irq_ring_set(struct dfl_feature *feature,
+				     struct dfl_irq_ring *ring)
+{
+	unsigned int i;
+
+	if (feature->irq_ring)
+		kref_put(&feature->irq_ring->kref, dfl_irq_ring_release);
+
+	feature->irq_ring = ring;
+	for (i = 0; i < feature->nr_irqs; i++)
+		feature->irq_ctx[i].ring = ring;
+}
+
+/**
+ * dfl_feature_irq_ring_remove - remove the irq completion ring of a feature
+ * @feature: the dfl sub feature
+ *
+ * The memory stays around until userspace unmaps it. Must be called with
+ * the feature dev lock held and no irq trigger set.
+ */
+void dfl_feature_irq_ring_remove(struct dfl_feature *feature)
+{
+	if (WARN_ON(dfl_feature_irq_bound(feature)))
+		return;
+
+	dfl_feature_irq_ring_set(feature, NULL);
+}
+EXPORT_SYMBOL_GPL(dfl_feature_irq_ring_remove);
+
+/**
+ * dfl_feature_ioctl_set_irq_ring - dfl feature _SET_IRQ_RING ioctl interface.
+ * @pdev: the feature device which has the sub feature
+ * @feature: the dfl sub feature
+ * @arg: ioctl argument
+ * @offset: offset on the device fd at which the ring can be mapped
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+long dfl_feature_ioctl_set_irq_ring(struct platform_device *pdev,
+				    struct dfl_feature *feature,
+				    unsigned long arg, u64 offset)
+{
+	struct dfl_feature_platform_data *pdata = dev_get_platdata(&pdev->dev);
+	struct dfl_feature_dev_data *fdata = pdata->fdata;
+	struct dfl_fpga_irq_ring ring_info;
+	struct dfl_irq_ring *ring = NULL;
+	unsigned long minsz;
+	long ret = 0;
+
+	minsz = offsetofend(struct dfl_fpga_irq_ring, size);
+
+	if (!feature->nr_irqs)
+		return -ENOENT;
+
+	if (copy_from_user(&ring_info, (void __user *)arg, minsz))
+		return -EFAULT;
+
+	if (ring_info.argsz < minsz || ring_info.flags || ring_info.padding)
+		return -EINVAL;
+
+	if (ring_info.entries) {
+		if (!is_power_of_2(ring_info.entries) ||
+		    ring_info.entries > DFL_IRQ_RING_MAX_ENTRIES)
+			return -EINVAL;
+
+		ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+		if (!ring)
+			return -ENOMEM;
+
+		ring->size = PAGE_ALIGN(sizeof(*ring->hdr) +
+					ring_info.entries * sizeof(*ring->recs));
+		ring->hdr = vmalloc_user(ring->size);
+		if (!ring->hdr) {
+			kfree(ring);
+			return -ENOMEM;
+		}
+
+		kref_init(&ring->kref);
+		spin_lock_init(&ring->lock);
+		ring->mask = ring_info.entries - 1;
+		ring->hdr->mask = ring->mask;
+		ring->recs = (void *)(ring->hdr + 1);
+	}
+
+	ring_info.offset = ring ? offset : 0;
+	ring_info.size = ring ? ring->size : 0;
+
+	mutex_lock(&fdata->lock);
+	if (dfl_feature_irq_bound(feature)) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	dfl_feature_irq_ring_set(feature, ring);
+	ring = NULL;
+unlock:
+	mutex_unlock(&fdata->lock);
+
+	if (ret) {
+		if (ring)
+			dfl_irq_ring_release(&ring->kref);
+		return ret;
+	}
+
+	if (copy_to_user((void __user *)arg, &ring_info, sizeof(ring_info)))
+		return -EFAULT;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dfl_feature_ioctl_set_irq_ring);
+
+static void dfl_irq_ring_vm_open(struct vm_area_struct *vma)
+{
+	struct dfl_irq_ring *ring = vma->vm_private_data;
+
+	kref_get(&ring->kref);
+}
+
+static void dfl_irq_ring_vm_close(struct vm_area_struct *vma)
+{
+	struct dfl_irq_ring *ring = vma->vm_private_data;
+
+	kref_put(&ring->kref, dfl_irq_ring_release);
+}
+
+static const struct vm_operations_struct dfl_irq_ring_vm_ops = {
+	.open = dfl_irq_ring_vm_open,
+	.close = dfl_irq_ring_vm_close,
+};
+
+/**
+ * dfl_feature_irq_ring_mmap - map the irq completion ring of a feature
+ * @feature: the dfl sub feature
+ * @vma: the vma covering the whole ring
+ *
+ * Must be called with the feature dev lock held.
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+int dfl_feature_irq_ring_mmap(struct dfl_feature *feature,
+			      struct vm_area_struct *vma)
+{
+	struct dfl_irq_ring *ring = feature->irq_ring;
+	int ret;
+
+	if (!ring)
+		return -ENODEV;
+
+	if (vma->vm_end - vma->vm_start != ring->size)
+		return -EINVAL;
+
+	ret = remap_vmalloc_range(vma, ring->hdr, 0);
+	if (ret)
+		return ret;
+
+	vma->vm_private_data = ring;
+	vma->vm_ops = &dfl_irq_ring_vm_ops;
+	kref_get(&ring->kref);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dfl_feature_irq_ring_mmap);
+
+/* number of irqs which get an entry in the busy-poll page */
+static unsigned int dfl_feature_irq_status_num(struct dfl_feature *feature)
+{
+	return min_t(unsigned int, feature->nr_irqs,
+		     PAGE_SIZE / sizeof(struct dfl_fpga_irq_status));
+}
+
+/**
+ * dfl_feature_irq_status_init - create the busy-poll page of a feature
+ * @feature: the dfl sub feature
+ *
+ * Must be called before any irq trigger of @feature is set.
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+int dfl_feature_irq_status_init(struct dfl_feature *feature)
+{
+	struct dfl_fpga_irq_status *status;
+	unsigned int i;
+
+	if (!feature->nr_irqs)
+		return 0;
+
+	feature->irq_status = alloc_page(GFP_KERNEL | __GFP_ZERO);
+	if (!feature->irq_status)
+		return -ENOMEM;
+
+	status = page_address(feature->irq_status);
+	for (i = 0; i < dfl_feature_irq_status_num(feature); i++)
+		feature->irq_ctx[i].status = &status[i];
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dfl_feature_irq_status_init);
+
+/**
+ * dfl_feature_irq_status_uinit - drop the busy-poll page of a feature
+ * @feature: the dfl sub feature
+ *
+ * Existing mappings hold their own reference on the page. Triggers may
+ * still be set by an open port fd, so wait for running handlers to drop
+ * the page before it is freed.
+ */
+void dfl_feature_irq_status_uinit(struct dfl_feature *feature)
+{
+	unsigned int i;
+
+	if (!feature->irq_status)
+		return;
+
+	for (i = 0; i < feature->nr_irqs; i++)
+		WRITE_ONCE(feature->irq_ctx[i].status, NULL);
+
+	for (i = 0; i < feature->nr_irqs; i++)
+		if (feature->irq_ctx[i].trigger)
+			synchronize_irq(feature->irq_ctx[i].irq);
+
+	__free_page(feature->irq_status);
+	feature->irq_status = NULL;
+}
+EXPORT_SYMBOL_GPL(dfl_feature_irq_status_uinit);
+
+/**
+ * dfl_feature_ioctl_get_poll_info - dfl feature _GET_POLL_INFO ioctl
+ *				     interface.
+ * @pdev: the feature device which has the sub feature
+ * @feature: the dfl sub feature
+ * @arg: ioctl argument
+ * @offset: offset on the device fd at which the page can be mapped
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+long dfl_feature_ioctl_get_poll_info(struct platform_device *pdev,
+				     struct dfl_feature *feature,
+				     unsigned long arg, u64 offset)
+{
+	struct dfl_fpga_irq_poll_info info;
+	unsigned long minsz;
+
+	minsz = offsetofend(struct dfl_fpga_irq_poll_info, size);
+
+	if (!feature->irq_status)
+		return -ENOENT;
+
+	if (copy_from_user(&info, (void __user *)arg, minsz))
+		return -EFAULT;
+
+	if (info.argsz < minsz)
+		return -EINVAL;
+
+	info.flags = 0;
+	info.num = dfl_feature_irq_status_num(feature);
+	info.padding = 0;
+	info.offset = offset;
+	info.size = PAGE_SIZE;
+
+	if (copy_to_user((void __user *)arg, &info, sizeof(info)))
+		return -EFAULT;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dfl_feature_ioctl_get_poll_info);
+
+/**
+ * dfl_feature_irq_status_mmap - map the busy-poll page of a feature
+ * @feature: the dfl sub feature
+ * @vma: read-only vma of one page
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+int dfl_feature_irq_status_mmap(struct dfl_feature *feature,
+				struct vm_area_struct *vma)
+{
+	if (!feature->irq_status)
+		return -ENODEV;
+
+	if (vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+
+	return vm_insert_page(vma, vma->vm_start, feature->irq_status);
+}
+EXPORT_SYMBOL_GPL(dfl_feature_irq_status_mmap);
+
 static void __exit dfl_fpga_exit(void)
 {
 	dfl_chardev_uinit();
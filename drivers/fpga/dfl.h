@@ -20,12 +20,14 @@
 #include <linux/dfl.h>
 #include <linux/eventfd.h>
 #include <linux/fs.h>
+#include <linux/hashtable.h>
 #include <linux/interrupt.h>
 #include <linux/iopoll.h>
 #include <linux/io-64-nonatomic-lo-hi.h>
 #include <linux/mod_devicetable.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
+#include <linux/sysfs.h>
 #include <linux/uuid.h>
 #include <linux/fpga/fpga-region.h>
 
@@ -262,11 +264,33 @@ struct dfl_feature_driver {
  * @irq: Linux IRQ number of this interrupt.
  * @trigger: eventfd context to signal when interrupt happens.
  * @name: irq name needed when requesting irq.
+ * @cpu: cpu the interrupt is routed to, negative for the cpus local to the
+ *	 device.
+ * @max_events: interrupts coalesced into one eventfd signal, 0 or 1 to
+ *		signal each interrupt.
+ * @max_usecs: max time a coalesced interrupt is held back before signalling.
+ * @pending: interrupts not signalled yet.
+ * @timer: signals pending interrupts once @max_usecs expires.
+ * @nr_events: number of interrupts raised.
+ * @nr_signals: number of eventfd signals delivered.
+ * @index: index of this interrupt in its sub feature.
+ * @ring: completion ring the signals are recorded into, if any.
+ * @status: entry of this interrupt in the busy-poll page, if any.
  */
 struct dfl_feature_irq_ctx {
 	int irq;
 	struct eventfd_ctx *trigger;
 	char *name;
+	int cpu;
+	unsigned int max_events;
+	unsigned int max_usecs;
+	atomic_t pending;
+	struct hrtimer timer;
+	atomic64_t nr_events;
+	atomic64_t nr_signals;
+	unsigned int index;
+	struct dfl_irq_ring *ring;
+	struct dfl_fpga_irq_status *status;
 };
 
 /**
@@ -288,6 +312,10 @@ struct dfl_feature_irq_ctx {
  * @param_size: size of dfh parameters
  * @params: point to memory copy of dfh parameters
  * @guid: unique dfl private guid.
+ * @irq_ring: completion ring shared by the interrupts of this sub feature.
+ * @irq_status: busy-poll page of the interrupts of this sub feature.
+ * @id_node: node in the feature id index of the feature dev.
+ * @guid_node: node in the guid index of the feature dev.
  */
 struct dfl_feature {
 	struct platform_device *dev;
@@ -304,8 +332,15 @@ struct dfl_feature {
 	unsigned int param_size;
 	void *params;
 	guid_t guid;
+	struct dfl_irq_ring *irq_ring;
+	struct page *irq_status;
+	struct hlist_node id_node;
+	struct hlist_node guid_node;
 };
 
+/* number of distinct ioctl numbers which may be routed to sub features */
+#define DFL_IOCTL_NR_MAX	(1 << _IOC_NRBITS)
+
 #define FEATURE_DEV_ID_UNUSED	(-1)
 
 /**
@@ -327,6 +362,11 @@ struct dfl_feature {
  * @features: sub features for the feature dev.
  * @resource_num: number of resources for the feature dev.
  * @resources: resources for the feature dev.
+ * @hash_bits: log2 of the number of buckets in @id_hash and @guid_hash.
+ * @id_hash: sub features indexed by feature id.
+ * @guid_hash: sub features with a valid guid indexed by guid.
+ * @ioctl_map: sub feature handling each ioctl number, built from the
+ *	       ioctl_cmds of the bound sub feature drivers.
  */
 struct dfl_feature_dev_data {
 	struct list_head node;
@@ -345,6 +385,10 @@ struct dfl_feature_dev_data {
 	struct dfl_feature *features;
 	int resource_num;
 	struct resource *resources;
+	unsigned int hash_bits;
+	struct hlist_head *id_hash;
+	struct hlist_head *guid_hash;
+	struct dfl_feature **ioctl_map;
 };
 
 /**
@@ -406,12 +450,24 @@ void *dfl_fpga_fdata_get_private(struct dfl_feature_dev_data *fdata)
 	return fdata->private;
 }
 
+/**
+ * struct dfl_feature_ops - ops of a dfl private feature driver
+ *
+ * @init: init the sub feature.
+ * @uinit: uinit the sub feature.
+ * @ioctl: handle an ioctl on the feature dev, return -ENODEV if @cmd is not
+ *	   handled by this sub feature.
+ * @ioctl_cmds: zero terminated list of the ioctl commands handled by @ioctl.
+ *		These are dispatched directly to this sub feature, @ioctl of
+ *		drivers without the list is tried for every other command.
+ */
 struct dfl_feature_ops {
 	int (*init)(struct platform_device *pdev, struct dfl_feature *feature);
 	void (*uinit)(struct platform_device *pdev,
 		      struct dfl_feature *feature);
 	long (*ioctl)(struct platform_device *pdev, struct dfl_feature *feature,
 		      unsigned int cmd, unsigned long arg);
+	const unsigned int *ioctl_cmds;
 };
 
 #define DFL_FPGA_FEATURE_DEV_FME		"dfl-fme"
@@ -425,6 +481,8 @@ int dfl_fpga_dev_ops_register(struct platform_device *pdev,
 			      const struct file_operations *fops,
 			      struct module *owner);
 void dfl_fpga_dev_ops_unregister(struct platform_device *pdev);
+long dfl_feature_dev_ioctl(struct dfl_feature_dev_data *fdata,
+			   unsigned int cmd, unsigned long arg);
 
 static inline
 struct platform_device *dfl_fpga_inode_to_feature_dev(struct inode *inode)
@@ -440,12 +498,18 @@ struct platform_device *dfl_fpga_inode_to_feature_dev(struct inode *inode)
 	for ((feature) = (fdata)->features;				    \
 	   (feature) < (fdata)->features + (fdata)->num; (feature)++)
 
+static inline struct hlist_head *
+dfl_feature_id_bucket(struct dfl_feature_dev_data *fdata, u16 id)
+{
+	return &fdata->id_hash[hash_min(id, fdata->hash_bits)];
+}
+
 static inline struct dfl_feature *
 dfl_get_feature_by_id(struct dfl_feature_dev_data *fdata, u16 id)
 {
 	struct dfl_feature *feature;
 
-	dfl_fpga_dev_for_each_feature(fdata, feature)
+	hlist_for_each_entry(feature, dfl_feature_id_bucket(fdata, id), id_node)
 		if (feature->id == id)
 			return feature;
 
@@ -556,6 +620,7 @@ struct dfl_fpga_enum_dfl {
 	struct list_head node;
 };
 
+bool dfl_fpga_async_probe(void);
 struct dfl_fpga_enum_info *dfl_fpga_enum_info_alloc(struct device *dev);
 int dfl_fpga_enum_info_add_dfl(struct dfl_fpga_enum_info *info,
 			       resource_size_t start, resource_size_t len);
@@ -572,6 +637,9 @@ void dfl_fpga_enum_info_free(struct dfl_fpga_enum_info *info);
  * @lock: mutex lock to protect the port device list.
  * @port_dev_list: list of all port feature devices under this container device.
  * @released_port_num: released port number under this container device.
+ * @snapshot: recorded enumeration snapshot, see struct dfl_snapshot_header.
+ * @snapshot_size: size of @snapshot in bytes.
+ * @snapshot_attr: binary sysfs attribute exposing @snapshot.
  */
 struct dfl_fpga_cdev {
 	struct device *parent;
@@ -580,6 +648,9 @@ struct dfl_fpga_cdev {
 	struct mutex lock;
 	struct list_head port_dev_list;
 	int released_port_num;
+	void *snapshot;
+	size_t snapshot_size;
+	struct bin_attribute snapshot_attr;
 };
 
 struct dfl_fpga_cdev *
@@ -614,6 +685,25 @@ int dfl_fpga_set_irq_triggers(struct dfl_feature *feature, unsigned int start,
 long dfl_feature_ioctl_get_num_irqs(struct platform_device *pdev,
 				    struct dfl_feature *feature,
 				    unsigned long arg);
+long dfl_feature_ioctl_set_irq_ring(struct platform_device *pdev,
+				    struct dfl_feature *feature,
+				    unsigned long arg, u64 offset);
+int dfl_feature_irq_ring_mmap(struct dfl_feature *feature,
+			      struct vm_area_struct *vma);
+void dfl_feature_irq_ring_remove(struct dfl_feature *feature);
+int dfl_feature_irq_status_init(struct dfl_feature *feature);
+void dfl_feature_irq_status_uinit(struct dfl_feature *feature);
+long dfl_feature_ioctl_get_poll_info(struct platform_device *pdev,
+				     struct dfl_feature *feature,
+				     unsigned long arg, u64 offset);
+int dfl_feature_irq_status_mmap(struct dfl_feature *feature,
+				struct vm_area_struct *vma);
+long dfl_feature_ioctl_set_irq_coalesce(struct platform_device *pdev,
+					struct dfl_feature *feature,
+					unsigned long arg);
+long dfl_feature_ioctl_set_irq_affinity(struct platform_device *pdev,
+					struct dfl_feature *feature,
+					unsigned long arg);
 long dfl_feature_ioctl_set_irq(struct platform_device *pdev,
 			       struct dfl_feature *feature,
 			       unsigned long arg);
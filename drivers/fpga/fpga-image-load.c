@@ -5,16 +5,75 @@
  * Copyright (C) 2019-2021 Intel Corporation, Inc.
  */
 
+#include <linux/capability.h>
 #include <linux/cdev.h>
 #include <linux/delay.h>
 #include <linux/fpga/fpga-image-load.h>
 #include <linux/fs.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/sched/mm.h>
+#include <linux/sched/signal.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/version.h>
 #include <linux/vmalloc.h>
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 6, 0)
+
+#define pin_user_pages_fast get_user_pages_fast
+#define unpin_user_pages put_all_pages
+
+static void put_all_pages(struct page **pages, int npages)
+{
+	int i;
+
+	for (i = 0; i < npages; i++)
+		if (pages[i])
+			put_page(pages[i]);
+}
+
+#endif /* < KERNEL_VERSION(5, 6, 0) */
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 2, 0)
+#define FW_UPLOAD_PIN_FLAGS	0
+#else
+#define FW_UPLOAD_PIN_FLAGS	FOLL_LONGTERM
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 3, 0)
+static int account_locked_vm(struct mm_struct *mm, unsigned long pages,
+			     bool inc)
+{
+	unsigned long lock_limit;
+	int ret = 0;
+
+	if (!pages || !mm)
+		return 0;
+
+	down_write(&mm->mmap_sem);
+
+	if (inc) {
+		lock_limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+
+		if (mm->locked_vm + pages > lock_limit &&
+		    !capable(CAP_IPC_LOCK))
+			ret = -ENOMEM;
+		else
+			mm->locked_vm += pages;
+	} else {
+		if (WARN_ON_ONCE(pages > mm->locked_vm))
+			pages = mm->locked_vm;
+		mm->locked_vm -= pages;
+	}
+
+	up_write(&mm->mmap_sem);
+
+	return ret;
+}
+#endif /* < KERNEL_VERSION(5, 3, 0) */
+
 #define IMAGE_LOAD_XA_LIMIT	XA_LIMIT(0, INT_MAX)
 static DEFINE_XARRAY_ALLOC(fpga_image_load_xa);
 
@@ -49,6 +108,10 @@ struct fw_upload_priv {
 	struct mutex lock;		  /* protect data structure contents */
 	struct work_struct work;
 	const u8 *data;			  /* pointer to update data */
+	struct page **pages;		  /* pinned user pages backing data */
+	int npages;
+	struct mm_struct *mm;		  /* mm charged for the pinned pages */
+	void *vaddr;			  /* kernel mapping of pinned pages */
 	u32 remaining_size;		  /* size remaining to transfer */
 	enum fw_upload_prog progress;
 	enum fw_upload_prog err_progress; /* progress at time of failure */
@@ -88,6 +151,84 @@ static void fw_upload_prog_complete(struct fw_upload_priv *fwlp)
 	mutex_unlock(&fwlp->lock);
 }
 
+static void fw_upload_free_data(struct fw_upload_priv *fwlp)
+{
+	if (fwlp->pages) {
+		vunmap(fwlp->vaddr);
+		unpin_user_pages(fwlp->pages, fwlp->npages);
+		kvfree(fwlp->pages);
+		/* may run from the upload worker, which has no mm of its own */
+		account_locked_vm(fwlp->mm, fwlp->npages, false);
+		mmdrop(fwlp->mm);
+		fwlp->mm = NULL;
+		fwlp->pages = NULL;
+		fwlp->vaddr = NULL;
+	} else {
+		vfree(fwlp->data);
+	}
+	fwlp->data = NULL;
+}
+
+/*
+ * Pin the user image buffer and map it contiguously into the kernel, so the
+ * upload can start right away without a kernel copy of the whole image.
+ * The pages stay pinned for the whole upload, which may take minutes, so
+ * they are pinned long term and moved out of movable/CMA memory first, and
+ * charged to the locked_vm of the caller like the AFU DMA regions are.
+ */
+static int fw_upload_pin_user_buf(struct fw_upload_priv *fwlp, u64 uaddr, u32 size)
+{
+	unsigned long start = uaddr & PAGE_MASK;
+	struct page **pages;
+	int npages, pinned;
+	void *vaddr;
+	int ret;
+
+	npages = (PAGE_ALIGN(uaddr + size) - start) >> PAGE_SHIFT;
+
+	ret = account_locked_vm(current->mm, npages, true);
+	if (ret)
+		return ret;
+
+	pages = kvcalloc(npages, sizeof(*pages), GFP_KERNEL);
+	if (!pages) {
+		ret = -ENOMEM;
+		goto unlock_vm;
+	}
+
+	pinned = pin_user_pages_fast(start, npages, FW_UPLOAD_PIN_FLAGS, pages);
+	if (pinned < 0) {
+		ret = pinned;
+		goto free_pages;
+	} else if (pinned != npages) {
+		ret = -EFAULT;
+		goto unpin_pages;
+	}
+
+	vaddr = vmap(pages, npages, VM_MAP, PAGE_KERNEL_RO);
+	if (!vaddr) {
+		ret = -ENOMEM;
+		goto unpin_pages;
+	}
+
+	mmgrab(current->mm);
+	fwlp->mm = current->mm;
+	fwlp->pages = pages;
+	fwlp->npages = npages;
+	fwlp->vaddr = vaddr;
+	fwlp->data = vaddr + offset_in_page(uaddr);
+
+	return 0;
+
+unpin_pages:
+	unpin_user_pages(pages, pinned);
+free_pages:
+	kvfree(pages);
+unlock_vm:
+	account_locked_vm(current->mm, npages, false);
+	return ret;
+}
+
 static void fw_upload_main(struct work_struct *work)
 {
 	struct fpga_image_load *imgld;
@@ -143,8 +284,7 @@ putdev_exit:
 	 * additional information on errors. It will be reinitialized when
 	 * the next firmware upload begins.
 	 */
-	vfree(fwlp->data);
-	fwlp->data = NULL;
+	fw_upload_free_data(fwlp);
 	fw_upload_prog_complete(fwlp);
 	eventfd_ctx_put(fwlp->finished);
 	fwlp->finished = NULL;
@@ -169,22 +309,41 @@ static int fpga_image_load_ioctl_write(struct fw_upload_priv *fwlp,
 	if (copy_from_user(&wb, (void __user *)arg, minsz))
 		return -EFAULT;
 
-	if (wb.flags)
+	if (wb.flags & ~FPGA_IMAGE_WRITE_PIN_USER_BUF)
 		return -EINVAL;
 
+	if (fwlp->progress != FW_UPLOAD_PROG_IDLE)
+		return -EBUSY;
+
 	if (!wb.size)
 		return -EINVAL;
 
 	if (wb.evtfd < 0)
 		return -EINVAL;
 
-	buf = vzalloc(wb.size);
-	if (!buf)
-		return -ENOMEM;
+	/*
+	 * Long term pinning is refused for some mappings, e.g. fs-dax files,
+	 * and beyond RLIMIT_MEMLOCK; those are copied like a buffer passed
+	 * without the flag.
+	 */
+	if (wb.flags & FPGA_IMAGE_WRITE_PIN_USER_BUF) {
+		ret = fw_upload_pin_user_buf(fwlp, wb.buf, wb.size);
+		if (ret)
+			dev_dbg(dev, "cannot pin user buffer (%d), copying it\n",
+				ret);
+	}
+
+	if (!fwlp->data) {
+		buf = vzalloc(wb.size);
+		if (!buf)
+			return -ENOMEM;
 
-	if (copy_from_user(buf, u64_to_user_ptr(wb.buf), wb.size)) {
-		ret = -EFAULT;
-		goto exit_free;
+		fwlp->data = buf;
+
+		if (copy_from_user(buf, u64_to_user_ptr(wb.buf), wb.size)) {
+			ret = -EFAULT;
+			goto exit_free;
+		}
 	}
 
 	fwlp->finished = eventfd_ctx_fdget(wb.evtfd);
@@ -199,13 +358,12 @@ static int fpga_image_load_ioctl_write(struct fw_upload_priv *fwlp,
 	fwlp->progress = FW_UPLOAD_PROG_RECEIVING;
 	fwlp->err_code = 0;
 	fwlp->remaining_size = wb.size;
-	fwlp->data = buf;
 
 	queue_work(system_long_wq, &fwlp->work);
 	return 0;
 
 exit_free:
-	vfree(buf);
+	fw_upload_free_data(fwlp);
 	return ret;
 }
 
@@ -1155,6 +1155,8 @@ static ssize_t image_load_store(struct device *dev,
 
 	for (hndlr = sec->ops->image_load; hndlr->name; hndlr++) {
 		if (sysfs_streq(buf, hndlr->name)) {
+			/* A reloaded BMC or FPGA image may report new versions */
+			m10bmc_sys_cache_reload(sec->m10bmc);
 			ret = hndlr->load_image(sec);
 			break;
 		}
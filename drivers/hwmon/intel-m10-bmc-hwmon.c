@@ -7,10 +7,19 @@
  */
 #include <linux/device.h>
 #include <linux/hwmon.h>
+#include <linux/jiffies.h>
 #include <linux/mfd/intel-m10-bmc.h>
 #include <linux/module.h>
 #include <linux/mod_devicetable.h>
+#include <linux/mutex.h>
 #include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+
+#define M10BMC_HWMON_UPDATE_INTERVAL_MS	1000
+
+/* Largest register gap, in bytes, bridged when merging sensor blocks */
+#define M10BMC_HWMON_BLOCK_MAX_GAP	0x10
 
 struct m10bmc_sdata {
 	unsigned int reg_input;
@@ -27,12 +36,27 @@ struct m10bmc_hwmon_board_data {
 	const struct hwmon_channel_info **hinfo;
 };
 
+/* A run of sensor registers fetched with a single bulk read */
+struct m10bmc_hwmon_block {
+	unsigned int start;	/* offset of the first register */
+	unsigned int count;	/* number of registers */
+	unsigned int idx;	/* index of the first value in the snapshot */
+};
+
 struct m10bmc_hwmon {
 	struct device *dev;
 	struct hwmon_chip_info chip;
 	char *hw_name;
 	struct intel_m10bmc *m10bmc;
 	const struct m10bmc_hwmon_board_data *bdata;
+	unsigned int stride;
+	struct m10bmc_hwmon_block *blocks;
+	unsigned int n_blocks;
+	struct mutex snap_lock;		/* protects snap, snap_valid and snap_stamp */
+	unsigned int *snap;
+	bool snap_valid;
+	unsigned long snap_stamp;
+	unsigned int update_interval_ms;
 };
 
 static const struct m10bmc_sdata n3000bmc_temp_tbl[] = {
@@ -68,6 +92,7 @@ static const struct m10bmc_sdata n3000bmc_power_tbl[] = {
 };
 
 static const struct hwmon_channel_info *n3000bmc_hinfo[] = {
+	HWMON_CHANNEL_INFO(chip, HWMON_C_UPDATE_INTERVAL),
 	HWMON_CHANNEL_INFO(temp,
 			   HWMON_T_INPUT | HWMON_T_MAX | HWMON_T_MAX_HYST |
 			   HWMON_T_CRIT | HWMON_T_CRIT_HYST | HWMON_T_LABEL,
@@ -155,6 +180,7 @@ static const struct m10bmc_hwmon_board_data n3000bmc_hwmon_bdata = {
 };
 
 static const struct hwmon_channel_info *d5005bmc_hinfo[] = {
+	HWMON_CHANNEL_INFO(chip, HWMON_C_UPDATE_INTERVAL),
 	HWMON_CHANNEL_INFO(temp,
 			   HWMON_T_INPUT | HWMON_T_MAX | HWMON_T_MAX_HYST |
 			   HWMON_T_CRIT | HWMON_T_CRIT_HYST | HWMON_T_LABEL,
@@ -281,6 +307,7 @@ static const struct m10bmc_sdata n5010bmc_curr_tbl[] = {
 };
 
 static const struct hwmon_channel_info *n5010bmc_hinfo[] = {
+	HWMON_CHANNEL_INFO(chip, HWMON_C_UPDATE_INTERVAL),
 	HWMON_CHANNEL_INFO(temp,
 			   HWMON_T_INPUT | HWMON_T_CRIT | HWMON_T_LABEL,
 			   HWMON_T_INPUT | HWMON_T_CRIT | HWMON_T_LABEL,
@@ -393,6 +420,7 @@ static const struct m10bmc_sdata n5014bmc_curr_tbl[] = {
 };
 
 static const struct hwmon_channel_info *n5014bmc_hinfo[] = {
+	HWMON_CHANNEL_INFO(chip, HWMON_C_UPDATE_INTERVAL),
 	HWMON_CHANNEL_INFO(temp,
 			   HWMON_T_INPUT | HWMON_T_CRIT | HWMON_T_LABEL,
 			   HWMON_T_INPUT | HWMON_T_CRIT | HWMON_T_LABEL,
@@ -545,6 +573,7 @@ static const struct m10bmc_sdata n6000bmc_power_tbl[] = {
 };
 
 static const struct hwmon_channel_info *n6000bmc_hinfo[] = {
+	HWMON_CHANNEL_INFO(chip, HWMON_C_UPDATE_INTERVAL),
 	HWMON_CHANNEL_INFO(temp,
 			   HWMON_T_INPUT | HWMON_T_MAX | HWMON_T_CRIT |
 			   HWMON_T_LABEL,
@@ -732,6 +761,7 @@ static const struct m10bmc_sdata c6100bmc_power_tbl[] = {
 };
 
 static const struct hwmon_channel_info *c6100bmc_hinfo[] = {
+	HWMON_CHANNEL_INFO(chip, HWMON_C_UPDATE_INTERVAL),
 	HWMON_CHANNEL_INFO(temp,
 			   HWMON_T_INPUT | HWMON_T_LABEL,
 			   HWMON_T_INPUT | HWMON_T_MAX | HWMON_T_CRIT |
@@ -823,6 +853,9 @@ static umode_t
 m10bmc_hwmon_is_visible(const void *data, enum hwmon_sensor_types type,
 			u32 attr, int channel)
 {
+	if (type == hwmon_chip && attr == hwmon_chip_update_interval)
+		return 0644;
+
 	return 0444;
 }
 
@@ -839,14 +872,71 @@ find_sensor_data(struct m10bmc_hwmon *hw, enum hwmon_sensor_types type,
 	return &tbl[channel];
 }
 
+static int m10bmc_hwmon_refresh(struct m10bmc_hwmon *hw)
+{
+	const struct m10bmc_hwmon_block *blk;
+	int ret;
+
+	lockdep_assert_held(&hw->snap_lock);
+
+	for (blk = hw->blocks; blk < hw->blocks + hw->n_blocks; blk++) {
+		ret = m10bmc_sys_bulk_read(hw->m10bmc, blk->start, &hw->snap[blk->idx],
+					   blk->count);
+		if (ret) {
+			hw->snap_valid = false;
+			return ret;
+		}
+	}
+
+	hw->snap_stamp = jiffies;
+	hw->snap_valid = true;
+
+	return 0;
+}
+
+static int m10bmc_hwmon_snapshot_read(struct m10bmc_hwmon *hw, unsigned int regoff,
+				      unsigned int interval_ms, unsigned int *regval)
+{
+	const struct m10bmc_hwmon_block *blk;
+	int ret = 0;
+
+	for (blk = hw->blocks; blk < hw->blocks + hw->n_blocks; blk++)
+		if (regoff >= blk->start && regoff < blk->start + blk->count * hw->stride)
+			break;
+
+	if (blk == hw->blocks + hw->n_blocks)
+		return -EINVAL;
+
+	mutex_lock(&hw->snap_lock);
+
+	if (!hw->snap_valid ||
+	    time_after_eq(jiffies, hw->snap_stamp + msecs_to_jiffies(interval_ms)))
+		ret = m10bmc_hwmon_refresh(hw);
+
+	if (!ret)
+		*regval = hw->snap[blk->idx + (regoff - blk->start) / hw->stride];
+
+	mutex_unlock(&hw->snap_lock);
+
+	return ret;
+}
+
 static int do_sensor_read(struct m10bmc_hwmon *hw,
 			  const struct m10bmc_sdata *data,
 			  unsigned int regoff, long *val)
 {
-	unsigned int regval;
+	unsigned int regval, ttl, interval_ms;
 	int ret;
 
-	ret = m10bmc_sys_read(hw->m10bmc, regoff, &regval);
+	interval_ms = READ_ONCE(hw->update_interval_ms);
+	if (interval_ms) {
+		ret = m10bmc_hwmon_snapshot_read(hw, regoff, interval_ms, &regval);
+	} else {
+		/* Thresholds and hysteresis rarely change, only inputs are volatile */
+		ttl = regoff == data->reg_input ? M10BMC_SYS_TTL_VOLATILE : M10BMC_SYS_TTL_SLOW;
+
+		ret = m10bmc_sys_read_cached(hw->m10bmc, regoff, &regval, ttl);
+	}
 	if (ret)
 		return ret;
 
@@ -874,6 +964,14 @@ static int m10bmc_hwmon_read(struct device *dev, enum hwmon_sensor_types type,
 	long hyst, value;
 	int ret;
 
+	if (type == hwmon_chip) {
+		if (attr != hwmon_chip_update_interval)
+			return -EOPNOTSUPP;
+
+		*val = READ_ONCE(hw->update_interval_ms);
+		return 0;
+	}
+
 	data = find_sensor_data(hw, type, channel);
 	if (IS_ERR(data))
 		return PTR_ERR(data);
@@ -982,9 +1080,149 @@ static int m10bmc_hwmon_read_string(struct device *dev,
 	return 0;
 }
 
+/*
+ * update_interval (in ms) is how long all sensor attributes are served from
+ * one bulk snapshot, zero reads each sensor attribute from the BMC.
+ */
+static int m10bmc_hwmon_write(struct device *dev, enum hwmon_sensor_types type,
+			      u32 attr, int channel, long val)
+{
+	struct m10bmc_hwmon *hw = dev_get_drvdata(dev);
+
+	if (type != hwmon_chip || attr != hwmon_chip_update_interval)
+		return -EOPNOTSUPP;
+
+	if (val < 0)
+		return -EINVAL;
+
+	mutex_lock(&hw->snap_lock);
+	WRITE_ONCE(hw->update_interval_ms, min_t(unsigned long, val, UINT_MAX));
+	hw->snap_valid = false;
+	mutex_unlock(&hw->snap_lock);
+
+	return 0;
+}
+
+static ssize_t sample_age_ms_show(struct device *dev,
+				  struct device_attribute *attr, char *buf)
+{
+	struct m10bmc_hwmon *hw = dev_get_drvdata(dev);
+	unsigned long stamp;
+	bool valid;
+
+	mutex_lock(&hw->snap_lock);
+	valid = hw->snap_valid;
+	stamp = hw->snap_stamp;
+	mutex_unlock(&hw->snap_lock);
+
+	if (!valid)
+		return -ENODATA;
+
+	return sysfs_emit(buf, "%u\n", jiffies_to_msecs(jiffies - stamp));
+}
+static DEVICE_ATTR_RO(sample_age_ms);
+
+static struct attribute *m10bmc_hwmon_attrs[] = {
+	&dev_attr_sample_age_ms.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(m10bmc_hwmon);
+
+static int m10bmc_hwmon_cmp_reg(const void *a, const void *b)
+{
+	unsigned int ra = *(const unsigned int *)a;
+	unsigned int rb = *(const unsigned int *)b;
+
+	return ra < rb ? -1 : ra > rb;
+}
+
+/*
+ * Collect the registers of every sensor attribute and merge them into
+ * blocks of (nearly) contiguous registers, so that a snapshot of all
+ * sensors takes one bulk read per block instead of one read per attribute.
+ */
+static int m10bmc_hwmon_init_snapshot(struct m10bmc_hwmon *hw)
+{
+	const struct hwmon_channel_info **info;
+	struct m10bmc_hwmon_block *blk = NULL;
+	const struct m10bmc_sdata *tbl;
+	unsigned int *regs, n_regs = 0, n_vals = 0, end, i;
+	int ch, ret = 0;
+
+	for (info = hw->bdata->hinfo; *info; info++) {
+		if (!hw->bdata->tables[(*info)->type])
+			continue;
+
+		for (ch = 0; (*info)->config[ch]; ch++)
+			n_regs += 5;
+	}
+
+	regs = kcalloc(n_regs, sizeof(*regs), GFP_KERNEL);
+	if (!regs)
+		return -ENOMEM;
+
+	n_regs = 0;
+	for (info = hw->bdata->hinfo; *info; info++) {
+		tbl = hw->bdata->tables[(*info)->type];
+		if (!tbl)
+			continue;
+
+		for (ch = 0; (*info)->config[ch]; ch++) {
+			const unsigned int tbl_regs[] = {
+				tbl[ch].reg_input, tbl[ch].reg_max, tbl[ch].reg_crit,
+				tbl[ch].reg_hyst, tbl[ch].reg_min,
+			};
+
+			for (i = 0; i < ARRAY_SIZE(tbl_regs); i++)
+				if (tbl_regs[i])
+					regs[n_regs++] = tbl_regs[i];
+		}
+	}
+
+	sort(regs, n_regs, sizeof(*regs), m10bmc_hwmon_cmp_reg, NULL);
+
+	hw->blocks = devm_kcalloc(hw->dev, max(n_regs, 1U), sizeof(*hw->blocks), GFP_KERNEL);
+	if (!hw->blocks) {
+		ret = -ENOMEM;
+		goto exit_free;
+	}
+
+	for (i = 0; i < n_regs; i++) {
+		if (blk) {
+			end = blk->start + (blk->count - 1) * hw->stride;
+			if (regs[i] <= end)
+				continue;
+
+			if (regs[i] - end <= M10BMC_HWMON_BLOCK_MAX_GAP) {
+				blk->count = (regs[i] - blk->start) / hw->stride + 1;
+				continue;
+			}
+		}
+
+		blk = &hw->blocks[hw->n_blocks++];
+		blk->start = regs[i];
+		blk->count = 1;
+	}
+
+	for (blk = hw->blocks; blk < hw->blocks + hw->n_blocks; blk++) {
+		blk->idx = n_vals;
+		n_vals += blk->count;
+	}
+
+	hw->snap = devm_kcalloc(hw->dev, max(n_vals, 1U), sizeof(*hw->snap), GFP_KERNEL);
+	if (!hw->snap)
+		ret = -ENOMEM;
+
+exit_free:
+	kfree(regs);
+
+	return ret;
+}
+
 static const struct hwmon_ops m10bmc_hwmon_ops = {
 	.is_visible = m10bmc_hwmon_is_visible,
 	.read = m10bmc_hwmon_read,
+	.write = m10bmc_hwmon_write,
 	.read_string = m10bmc_hwmon_read_string,
 };
 
@@ -994,7 +1232,7 @@ static int m10bmc_hwmon_probe(struct platform_device *pdev)
 	struct intel_m10bmc *m10bmc = dev_get_drvdata(pdev->dev.parent);
 	struct device *hwmon_dev, *dev = &pdev->dev;
 	struct m10bmc_hwmon *hw;
-	int i;
+	int i, ret;
 
 	hw = devm_kzalloc(dev, sizeof(*hw), GFP_KERNEL);
 	if (!hw)
@@ -1003,6 +1241,13 @@ static int m10bmc_hwmon_probe(struct platform_device *pdev)
 	hw->dev = dev;
 	hw->m10bmc = m10bmc;
 	hw->bdata = (const struct m10bmc_hwmon_board_data *)id->driver_data;
+	hw->stride = regmap_get_reg_stride(m10bmc->regmap);
+	hw->update_interval_ms = M10BMC_HWMON_UPDATE_INTERVAL_MS;
+	mutex_init(&hw->snap_lock);
+
+	ret = m10bmc_hwmon_init_snapshot(hw);
+	if (ret)
+		return ret;
 
 	hw->chip.info = hw->bdata->hinfo;
 	hw->chip.ops = &m10bmc_hwmon_ops;
@@ -1016,7 +1261,8 @@ static int m10bmc_hwmon_probe(struct platform_device *pdev)
 			hw->hw_name[i] = '_';
 
 	hwmon_dev = devm_hwmon_device_register_with_info(dev, hw->hw_name,
-							 hw, &hw->chip, NULL);
+							 hw, &hw->chip,
+							 m10bmc_hwmon_groups);
 	return PTR_ERR_OR_ZERO(hwmon_dev);
 }
 
@@ -8,9 +8,16 @@
 #include <linux/bitfield.h>
 #include <linux/device.h>
 #include <linux/dev_printk.h>
+#include <linux/jiffies.h>
 #include <linux/mfd/core.h>
 #include <linux/mfd/intel-m10-bmc.h>
 #include <linux/module.h>
+#include <linux/slab.h>
+
+struct m10bmc_sys_cache_entry {
+	unsigned int val;
+	unsigned long stamp;	/* jiffies when val was read from the BMC */
+};
 
 int m10bmc_fw_state_enter(struct intel_m10bmc *m10bmc,
 			  enum m10bmc_fw_state new_state)
@@ -23,7 +30,7 @@ int m10bmc_fw_state_enter(struct intel_m10bmc *m10bmc,
 	down_write(&m10bmc->bmcfw_lock);
 
 	if (m10bmc->bmcfw_state == M10BMC_FW_STATE_NORMAL)
-		m10bmc->bmcfw_state = new_state;
+		WRITE_ONCE(m10bmc->bmcfw_state, new_state);
 	else if (m10bmc->bmcfw_state != new_state)
 		ret = -EBUSY;
 
@@ -37,9 +44,12 @@ void m10bmc_fw_state_exit(struct intel_m10bmc *m10bmc)
 {
 	down_write(&m10bmc->bmcfw_lock);
 
-	m10bmc->bmcfw_state = M10BMC_FW_STATE_NORMAL;
+	WRITE_ONCE(m10bmc->bmcfw_state, M10BMC_FW_STATE_NORMAL);
 
 	up_write(&m10bmc->bmcfw_lock);
+
+	/* The update may have changed anything the BMC reports */
+	m10bmc_sys_cache_invalidate(m10bmc);
 }
 EXPORT_SYMBOL_GPL(m10bmc_fw_state_exit);
 
@@ -49,7 +59,8 @@ static bool is_handshake_sys_reg(struct intel_m10bmc *m10bmc, unsigned int offse
 				    m10bmc->info->handshake_sys_reg_nranges);
 }
 
-int m10bmc_sys_read(struct intel_m10bmc *m10bmc, unsigned int offset, unsigned int *val)
+static int m10bmc_sys_read_uncached(struct intel_m10bmc *m10bmc, unsigned int offset,
+				    unsigned int *val)
 {
 	const struct m10bmc_csr_map *csr_map = m10bmc->info->csr_map;
 	int ret;
@@ -73,8 +84,189 @@ int m10bmc_sys_read(struct intel_m10bmc *m10bmc, unsigned int offset, unsigned i
 
 	return ret;
 }
+
+static bool m10bmc_sys_cache_lookup(struct intel_m10bmc *m10bmc, unsigned int offset,
+				    unsigned int *val, unsigned int ttl_ms)
+{
+	struct m10bmc_sys_cache_entry *entry;
+	bool hit = false;
+
+	xa_lock(&m10bmc->sys_cache);
+	entry = xa_load(&m10bmc->sys_cache, offset);
+	if (entry && (ttl_ms == M10BMC_SYS_TTL_IMMUTABLE ||
+		      time_before(jiffies, entry->stamp + msecs_to_jiffies(ttl_ms)))) {
+		*val = entry->val;
+		hit = true;
+	}
+	xa_unlock(&m10bmc->sys_cache);
+
+	return hit;
+}
+
+static unsigned int m10bmc_sys_cache_gen(struct intel_m10bmc *m10bmc)
+{
+	unsigned int gen;
+
+	xa_lock(&m10bmc->sys_cache);
+	gen = m10bmc->sys_cache_gen;
+	xa_unlock(&m10bmc->sys_cache);
+
+	return gen;
+}
+
+/*
+ * Store a value read from the BMC, unless the cache was invalidated since
+ * the read started (gen), or the firmware is being updated or reloaded, in
+ * which case the value may already be stale.
+ */
+static void m10bmc_sys_cache_store(struct intel_m10bmc *m10bmc, unsigned int offset,
+				   unsigned int val, unsigned int gen)
+{
+	struct m10bmc_sys_cache_entry *entry, *new;
+
+	if (READ_ONCE(m10bmc->bmcfw_state) != M10BMC_FW_STATE_NORMAL)
+		return;
+
+	new = kmalloc(sizeof(*new), GFP_KERNEL);
+	if (!new)
+		return;
+
+	new->val = val;
+	new->stamp = jiffies;
+
+	xa_lock(&m10bmc->sys_cache);
+	if (gen != m10bmc->sys_cache_gen)
+		goto unlock;
+
+	if (m10bmc->sys_cache_hold) {
+		if (time_before(jiffies, m10bmc->sys_cache_hold))
+			goto unlock;
+		m10bmc->sys_cache_hold = 0;
+	}
+
+	entry = xa_load(&m10bmc->sys_cache, offset);
+	if (entry)
+		*entry = *new;
+	else if (!xa_is_err(__xa_store(&m10bmc->sys_cache, offset, new, GFP_ATOMIC)))
+		new = NULL;
+unlock:
+	xa_unlock(&m10bmc->sys_cache);
+
+	kfree(new);
+}
+
+/* Drop one value, and any value of it still being read from the BMC */
+static void m10bmc_sys_cache_evict(struct intel_m10bmc *m10bmc, unsigned int offset)
+{
+	xa_lock(&m10bmc->sys_cache);
+	m10bmc->sys_cache_gen++;
+	kfree(__xa_erase(&m10bmc->sys_cache, offset));
+	xa_unlock(&m10bmc->sys_cache);
+}
+
+static void m10bmc_sys_cache_drop(struct intel_m10bmc *m10bmc)
+{
+	struct m10bmc_sys_cache_entry *entry;
+	unsigned long offset;
+
+	m10bmc->sys_cache_gen++;
+	xa_for_each(&m10bmc->sys_cache, offset, entry) {
+		__xa_erase(&m10bmc->sys_cache, offset);
+		kfree(entry);
+	}
+}
+
+void m10bmc_sys_cache_invalidate(struct intel_m10bmc *m10bmc)
+{
+	xa_lock(&m10bmc->sys_cache);
+	m10bmc_sys_cache_drop(m10bmc);
+	xa_unlock(&m10bmc->sys_cache);
+}
+EXPORT_SYMBOL_GPL(m10bmc_sys_cache_invalidate);
+
+/*
+ * An image reload completes asynchronously, without an indication to the
+ * host, and the BMC keeps reporting the old versions until it is done.
+ * Call this before requesting the reload.
+ */
+void m10bmc_sys_cache_reload(struct intel_m10bmc *m10bmc)
+{
+	xa_lock(&m10bmc->sys_cache);
+	m10bmc->sys_cache_hold = jiffies + msecs_to_jiffies(M10BMC_SYS_CACHE_RELOAD_MS);
+	m10bmc_sys_cache_drop(m10bmc);
+	xa_unlock(&m10bmc->sys_cache);
+}
+EXPORT_SYMBOL_GPL(m10bmc_sys_cache_reload);
+
+int m10bmc_sys_read_cached(struct intel_m10bmc *m10bmc, unsigned int offset,
+			   unsigned int *val, unsigned int ttl_ms)
+{
+	unsigned int gen;
+	int ret;
+
+	if (ttl_ms == M10BMC_SYS_TTL_VOLATILE)
+		return m10bmc_sys_read_uncached(m10bmc, offset, val);
+
+	if (m10bmc_sys_cache_lookup(m10bmc, offset, val, ttl_ms))
+		return 0;
+
+	gen = m10bmc_sys_cache_gen(m10bmc);
+	ret = m10bmc_sys_read_uncached(m10bmc, offset, val);
+	if (!ret)
+		m10bmc_sys_cache_store(m10bmc, offset, *val, gen);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(m10bmc_sys_read_cached);
+
+/* Default time-to-live of the cached value of a system register */
+static unsigned int m10bmc_sys_reg_ttl(struct intel_m10bmc *m10bmc, unsigned int offset)
+{
+	const struct m10bmc_csr_map *csr_map = m10bmc->info->csr_map;
+
+	if (offset == csr_map->build_version || offset == csr_map->fw_version ||
+	    offset == csr_map->mac_low || offset == csr_map->mac_high)
+		return M10BMC_SYS_TTL_IMMUTABLE;
+
+	return M10BMC_SYS_TTL_VOLATILE;
+}
+
+int m10bmc_sys_read(struct intel_m10bmc *m10bmc, unsigned int offset, unsigned int *val)
+{
+	return m10bmc_sys_read_cached(m10bmc, offset, val, m10bmc_sys_reg_ttl(m10bmc, offset));
+}
 EXPORT_SYMBOL_GPL(m10bmc_sys_read);
 
+int m10bmc_sys_bulk_read(struct intel_m10bmc *m10bmc, unsigned int offset,
+			 unsigned int *val, size_t count)
+{
+	const struct m10bmc_csr_map *csr_map = m10bmc->info->csr_map;
+	unsigned int stride = regmap_get_reg_stride(m10bmc->regmap);
+	bool handshake = false;
+	size_t i;
+	int ret;
+
+	if (m10bmc->info->handshake_sec_update_busy) {
+		for (i = 0; i < count && !handshake; i++)
+			handshake = is_handshake_sys_reg(m10bmc, offset + i * stride);
+	}
+
+	if (!handshake)
+		return regmap_bulk_read(m10bmc->regmap, csr_map->base + offset, val, count);
+
+	down_read(&m10bmc->bmcfw_lock);
+
+	if (m10bmc->bmcfw_state == M10BMC_FW_STATE_SEC_UPDATE)
+		ret = -EBUSY;
+	else
+		ret = regmap_bulk_read(m10bmc->regmap, csr_map->base + offset, val, count);
+
+	up_read(&m10bmc->bmcfw_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(m10bmc_sys_bulk_read);
+
 int m10bmc_sys_update_bits(struct intel_m10bmc *m10bmc, unsigned int offset,
 			   unsigned int msk, unsigned int val)
 {
@@ -86,17 +278,21 @@ int m10bmc_sys_update_bits(struct intel_m10bmc *m10bmc, unsigned int offset,
 	 * to service handshake registers during a secure update and -EBUSY
 	 * is returned for these cases.
 	 */
-	if (!m10bmc->info->handshake_sec_update_busy || !is_handshake_sys_reg(m10bmc, offset))
-		return regmap_update_bits(m10bmc->regmap, csr_map->base + offset, msk, val);
+	if (!m10bmc->info->handshake_sec_update_busy || !is_handshake_sys_reg(m10bmc, offset)) {
+		ret = regmap_update_bits(m10bmc->regmap, csr_map->base + offset, msk, val);
+	} else {
+		down_read(&m10bmc->bmcfw_lock);
 
-	down_read(&m10bmc->bmcfw_lock);
+		if (m10bmc->bmcfw_state == M10BMC_FW_STATE_SEC_UPDATE)
+			ret = -EBUSY;
+		else
+			ret = regmap_update_bits(m10bmc->regmap, csr_map->base + offset, msk, val);
 
-	if (m10bmc->bmcfw_state == M10BMC_FW_STATE_SEC_UPDATE)
-		ret = -EBUSY;
-	else
-		ret = regmap_update_bits(m10bmc->regmap, csr_map->base + offset, msk, val);
+		up_read(&m10bmc->bmcfw_lock);
+	}
 
-	up_read(&m10bmc->bmcfw_lock);
+	/* evict after the write, so that reads racing with it aren't cached */
+	m10bmc_sys_cache_evict(m10bmc, offset);
 
 	return ret;
 }
@@ -190,6 +386,14 @@ const struct attribute_group *m10bmc_dev_groups[] = {
 };
 EXPORT_SYMBOL_GPL(m10bmc_dev_groups);
 
+static void m10bmc_sys_cache_release(void *data)
+{
+	struct intel_m10bmc *m10bmc = data;
+
+	m10bmc_sys_cache_invalidate(m10bmc);
+	xa_destroy(&m10bmc->sys_cache);
+}
+
 int m10bmc_dev_init(struct intel_m10bmc *m10bmc, const struct intel_m10bmc_platform_info *info)
 {
 	int ret;
@@ -197,6 +401,11 @@ int m10bmc_dev_init(struct intel_m10bmc *m10bmc, const struct intel_m10bmc_platf
 	m10bmc->info = info;
 	dev_set_drvdata(m10bmc->dev, m10bmc);
 	init_rwsem(&m10bmc->bmcfw_lock);
+	xa_init(&m10bmc->sys_cache);
+
+	ret = devm_add_action_or_reset(m10bmc->dev, m10bmc_sys_cache_release, m10bmc);
+	if (ret)
+		return ret;
 
 	ret = devm_mfd_add_devices(m10bmc->dev, PLATFORM_DEVID_AUTO,
 				   info->cells, info->n_cells,
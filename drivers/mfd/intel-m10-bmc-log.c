@@ -9,14 +9,18 @@
 #include <linux/dev_printk.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/platform_device.h>
 #include <linux/nvmem-provider.h>
 #include <linux/mod_devicetable.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
 #include <linux/types.h>
 
 #include <linux/mfd/intel-m10-bmc.h>
 
 #define M10BMC_TIMESTAMP_FREQ			60	/* 60 secs between updates */
+#define M10BMC_LOG_CACHE_BLK_SIZE		SZ_4K
 
 struct m10bmc_log_cfg {
 	int el_size;
@@ -29,6 +33,21 @@ struct m10bmc_log_cfg {
 	unsigned long bi_off;
 };
 
+/*
+ * Read-through cache of a flash region. Every flash read on PMCI devices
+ * requests the flash host mux from the BMC, so repeated nvmem reads are
+ * served from RAM once a block has been fetched. Blocks are dropped on
+ * time sync (event log only) and once a flash update has completed.
+ */
+struct m10bmc_log_cache {
+	struct mutex lock;		/* protects buf, valid and gen */
+	unsigned long addr;
+	size_t size;
+	u8 *buf;
+	unsigned long *valid;		/* one bit per cache block */
+	unsigned int gen;
+};
+
 struct m10bmc_log {
 	struct device *dev;
 	struct intel_m10bmc *m10bmc;
@@ -39,10 +58,23 @@ struct m10bmc_log {
 	struct nvmem_device *bmc_event_log_nvmem;
 	struct nvmem_device *fpga_image_dir_nvmem;
 	struct nvmem_device *bom_info_nvmem;
+	struct m10bmc_log_cache el_cache;
+	struct m10bmc_log_cache id_cache;
+	struct m10bmc_log_cache bi_cache;
 };
 
 static DEFINE_IDA(m10bmc_log_ida);
 
+static void m10bmc_log_cache_invalidate(struct m10bmc_log_cache *cache)
+{
+	if (!cache->buf)
+		return;
+
+	mutex_lock(&cache->lock);
+	bitmap_zero(cache->valid, DIV_ROUND_UP(cache->size, M10BMC_LOG_CACHE_BLK_SIZE));
+	mutex_unlock(&cache->lock);
+}
+
 static void m10bmc_log_time_sync(struct work_struct *work)
 {
 	struct delayed_work *dwork = to_delayed_work(work);
@@ -64,6 +96,14 @@ static void m10bmc_log_time_sync(struct work_struct *work)
 	if (ret)
 		dev_err_once(log->dev, "Failed to update BMC timestamp: %d\n", ret);
 
+	/*
+	 * New events are logged against the updated time stamp. While a
+	 * flash update holds the flash the log can't be re-read, so keep
+	 * serving the cached blocks until the update is done.
+	 */
+	if (!m10bmc_flash_gen_busy(m10bmc_flash_gen(log->m10bmc)))
+		m10bmc_log_cache_invalidate(&log->el_cache);
+
 	schedule_delayed_work(&log->dwork, log->freq_s * HZ);
 }
 
@@ -102,43 +142,91 @@ static struct attribute *m10bmc_log_attrs[] = {
 };
 ATTRIBUTE_GROUPS(m10bmc_log);
 
-static int bmc_nvmem_read(struct m10bmc_log *ddata, unsigned int addr,
+static int bmc_nvmem_read(struct m10bmc_log *ddata, struct m10bmc_log_cache *cache,
 			  unsigned int off, void *val, size_t count)
 {
 	struct intel_m10bmc *m10bmc = ddata->m10bmc;
-	int ret;
+	unsigned int first, last, blk, end, gen;
+	u32 blk_off, blk_len;
+	int ret = 0;
 
 	if (!m10bmc->flash_bulk_ops)
 		return -ENODEV;
 
-	ret = m10bmc->flash_bulk_ops->read(m10bmc, val, addr + off, count);
-	if (ret) {
-		dev_err(ddata->dev, "failed to read flash %x (%d)\n", addr, ret);
-		return ret;
+	if (!count)
+		return 0;
+
+	if (off >= cache->size || count > cache->size - off)
+		return -EINVAL;
+
+	first = off / M10BMC_LOG_CACHE_BLK_SIZE;
+	last = (off + count - 1) / M10BMC_LOG_CACHE_BLK_SIZE;
+
+	mutex_lock(&cache->lock);
+
+	/* cached blocks stay valid until the update releases the flash */
+	gen = m10bmc_flash_gen(m10bmc);
+	if (cache->gen != gen && !m10bmc_flash_gen_busy(gen)) {
+		bitmap_zero(cache->valid, DIV_ROUND_UP(cache->size, M10BMC_LOG_CACHE_BLK_SIZE));
+		cache->gen = gen;
 	}
 
-	return 0;
+	/*
+	 * On a miss, fill the whole region while the flash is available, so
+	 * that all of it can still be served if an update takes the flash.
+	 */
+	if (!m10bmc_flash_gen_busy(gen) &&
+	    find_next_zero_bit(cache->valid, last + 1, first) <= last) {
+		first = 0;
+		last = DIV_ROUND_UP(cache->size, M10BMC_LOG_CACHE_BLK_SIZE) - 1;
+	}
+
+	/* Fetch each run of missing blocks with a single flash read */
+	for (blk = find_next_zero_bit(cache->valid, last + 1, first); blk <= last;
+	     blk = find_next_zero_bit(cache->valid, last + 1, end)) {
+		end = find_next_bit(cache->valid, last + 1, blk);
+		blk_off = blk * M10BMC_LOG_CACHE_BLK_SIZE;
+		blk_len = min_t(size_t, (end - blk) * M10BMC_LOG_CACHE_BLK_SIZE,
+				cache->size - blk_off);
+
+		ret = m10bmc->flash_bulk_ops->read(m10bmc, cache->buf + blk_off,
+						   cache->addr + blk_off, blk_len);
+		if (ret) {
+			dev_err(ddata->dev, "failed to read flash %lx (%d)\n",
+				cache->addr + blk_off, ret);
+			goto unlock;
+		}
+
+		bitmap_set(cache->valid, blk, end - blk);
+	}
+
+	memcpy(val, cache->buf + off, count);
+
+unlock:
+	mutex_unlock(&cache->lock);
+
+	return ret;
 }
 
 static int bmc_event_log_nvmem_read(void *priv, unsigned int off, void *val, size_t count)
 {
 	struct m10bmc_log *ddata = priv;
 
-	return bmc_nvmem_read(ddata, ddata->log_cfg->el_off, off, val, count);
+	return bmc_nvmem_read(ddata, &ddata->el_cache, off, val, count);
 }
 
 static int fpga_image_dir_nvmem_read(void *priv, unsigned int off, void *val, size_t count)
 {
 	struct m10bmc_log *ddata = priv;
 
-	return bmc_nvmem_read(ddata, ddata->log_cfg->id_off, off, val, count);
+	return bmc_nvmem_read(ddata, &ddata->id_cache, off, val, count);
 }
 
 static int bom_info_nvmem_read(void *priv, unsigned int off, void *val, size_t count)
 {
 	struct m10bmc_log *ddata = priv;
 
-	return bmc_nvmem_read(ddata, ddata->log_cfg->bi_off, off, val, count);
+	return bmc_nvmem_read(ddata, &ddata->bi_cache, off, val, count);
 }
 
 static struct nvmem_config bmc_event_log_nvmem_config = {
@@ -162,6 +250,37 @@ static struct nvmem_config bom_info_nvmem_config = {
 	.reg_read = bom_info_nvmem_read,
 };
 
+static void m10bmc_log_cache_release(void *data)
+{
+	struct m10bmc_log_cache *cache = data;
+
+	mutex_destroy(&cache->lock);
+	kvfree(cache->buf);
+}
+
+static int m10bmc_log_cache_init(struct m10bmc_log *ddata, struct m10bmc_log_cache *cache,
+				 unsigned long addr, size_t size)
+{
+	unsigned int nblks = DIV_ROUND_UP(size, M10BMC_LOG_CACHE_BLK_SIZE);
+
+	cache->valid = devm_kcalloc(ddata->dev, BITS_TO_LONGS(nblks),
+				    sizeof(unsigned long), GFP_KERNEL);
+	if (!cache->valid)
+		return -ENOMEM;
+
+	cache->buf = kvzalloc(size, GFP_KERNEL);
+	if (!cache->buf)
+		return -ENOMEM;
+
+	mutex_init(&cache->lock);
+	cache->addr = addr;
+	cache->size = size;
+	cache->gen = m10bmc_flash_gen(ddata->m10bmc);
+
+	/* Released after the nvmem devices that read through the cache */
+	return devm_add_action_or_reset(ddata->dev, m10bmc_log_cache_release, cache);
+}
+
 static int m10bmc_log_probe(struct platform_device *pdev)
 {
 	const struct platform_device_id *id = platform_get_device_id(pdev);
@@ -185,6 +304,11 @@ static int m10bmc_log_probe(struct platform_device *pdev)
 	dev_set_drvdata(&pdev->dev, ddata);
 
 	if (ddata->log_cfg->el_size > 0) {
+		ret = m10bmc_log_cache_init(ddata, &ddata->el_cache, ddata->log_cfg->el_off,
+					    ddata->log_cfg->el_size);
+		if (ret)
+			goto error_exit;
+
 		m10bmc_log_time_sync(&ddata->dwork.work);
 
 		memcpy(&nvconfig, &bmc_event_log_nvmem_config, sizeof(bmc_event_log_nvmem_config));
@@ -201,6 +325,11 @@ static int m10bmc_log_probe(struct platform_device *pdev)
 	}
 
 	if (ddata->log_cfg->id_size > 0) {
+		ret = m10bmc_log_cache_init(ddata, &ddata->id_cache, ddata->log_cfg->id_off,
+					    ddata->log_cfg->id_size);
+		if (ret)
+			goto error_exit;
+
 		memcpy(&nvconfig, &fpga_image_dir_nvmem_config, sizeof(fpga_image_dir_nvmem_config));
 		nvconfig.dev = ddata->dev;
                 nvconfig.id = ddata->id;
@@ -215,6 +344,11 @@ static int m10bmc_log_probe(struct platform_device *pdev)
 	}
 
 	if (ddata->log_cfg->bi_size > 0) {
+		ret = m10bmc_log_cache_init(ddata, &ddata->bi_cache, ddata->log_cfg->bi_off,
+					    ddata->log_cfg->bi_size);
+		if (ret)
+			goto error_exit;
+
 		memcpy(&nvconfig, &bom_info_nvmem_config, sizeof(bom_info_nvmem_config));
 		nvconfig.dev = ddata->dev;
                 nvconfig.id = ddata->id;
@@ -234,8 +368,10 @@ static int m10bmc_log_probe(struct platform_device *pdev)
 
 error_exit:
 
-	if (ret)
+	if (ret) {
+		cancel_delayed_work_sync(&ddata->dwork);
 		ida_simple_remove(&m10bmc_log_ida, ddata->id);
+	}
 
 	return ret;
 }
@@ -9,18 +9,49 @@
 #include <linux/bitfield.h>
 #include <linux/device.h>
 #include <linux/dfl.h>
+#include <linux/list.h>
 #include <linux/mfd/core.h>
 #include <linux/mfd/intel-m10-bmc.h>
 #include <linux/minmax.h>
 #include <linux/module.h>
 #include <linux/regmap.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
 #include <linux/version.h>
 
+/*
+ * While a secure update holds the flash, reads are served from snapshots
+ * of flash data taken before the update started. Snapshots are recorded
+ * from ordinary reads (up to M10BMC_PMCI_SNAPSHOT_MAX_SIZE bytes each) and
+ * the security data read by the sec-update driver is captured explicitly
+ * when the flash is locked. Those are pinned, so that other reads during
+ * the update can't evict them. All snapshots are dropped on unlock.
+ *
+ * The log regions are far larger than a snapshot; the log driver keeps its
+ * own cache of them, which it serves from while the flash is busy.
+ */
+#define M10BMC_PMCI_SNAPSHOT_MAX_SIZE	SZ_4K
+#define M10BMC_PMCI_SNAPSHOT_MAX_NUM	32
+
+/* Program magic word followed by a root entry hash of up to 384 bits */
+#define M10BMC_PMCI_REH_SNAPSHOT_SIZE	(4 + 48)
+#define M10BMC_PMCI_FLASH_COUNT_SIZE	SZ_4K
+
+struct m10bmc_pmci_snapshot {
+	struct list_head node;
+	u32 addr;
+	u32 size;
+	bool pinned;
+	u8 data[];
+};
+
 struct m10bmc_pmci_device {
 	void __iomem *base;
 	struct intel_m10bmc m10bmc;
 	struct mutex flash_mutex;	/* protects flash_busy and serializes flash read/read */
 	bool flash_busy;
+	struct list_head snapshots;	/* most recently used first, protected by flash_mutex */
+	unsigned int n_snapshots;
 };
 
 static void pmci_write_fifo(void __iomem *base, const u32 *buf, size_t count)
@@ -156,31 +187,170 @@ static int m10bmc_pmci_set_flash_host_mux(struct intel_m10bmc *m10bmc, bool requ
 					M10BMC_FLASH_INT_US, M10BMC_FLASH_TIMEOUT_US);
 }
 
-static int m10bmc_pmci_flash_read(struct intel_m10bmc *m10bmc, u8 *buf, u32 addr, u32 size)
+static struct m10bmc_pmci_snapshot *
+m10bmc_pmci_snapshot_find(struct m10bmc_pmci_device *pmci, u32 addr, u32 size)
 {
-	struct m10bmc_pmci_device *pmci = container_of(m10bmc, struct m10bmc_pmci_device, m10bmc);
-	int ret, ret2;
+	struct m10bmc_pmci_snapshot *snap;
 
-	mutex_lock(&pmci->flash_mutex);
-	if (pmci->flash_busy) {
-		ret = -EBUSY;
-		goto unlock;
+	list_for_each_entry(snap, &pmci->snapshots, node) {
+		if (addr < snap->addr || size > snap->size ||
+		    addr - snap->addr > snap->size - size)
+			continue;
+
+		list_move(&snap->node, &pmci->snapshots);
+		return snap;
+	}
+
+	return NULL;
+}
+
+static bool m10bmc_pmci_snapshot_read(struct m10bmc_pmci_device *pmci, u8 *buf,
+				      u32 addr, u32 size)
+{
+	struct m10bmc_pmci_snapshot *snap;
+
+	snap = m10bmc_pmci_snapshot_find(pmci, addr, size);
+	if (!snap)
+		return false;
+
+	memcpy(buf, snap->data + (addr - snap->addr), size);
+	return true;
+}
+
+/* Evict the least recently used snapshot which isn't pinned */
+static void m10bmc_pmci_snapshot_evict(struct m10bmc_pmci_device *pmci)
+{
+	struct m10bmc_pmci_snapshot *snap;
+
+	list_for_each_entry_reverse(snap, &pmci->snapshots, node) {
+		if (snap->pinned)
+			continue;
+
+		list_del(&snap->node);
+		pmci->n_snapshots--;
+		kfree(snap);
+		return;
 	}
+}
+
+static void m10bmc_pmci_snapshot_add(struct m10bmc_pmci_device *pmci, const u8 *buf,
+				     u32 addr, u32 size, bool pin)
+{
+	struct m10bmc_pmci_snapshot *snap;
+
+	if (!size || size > M10BMC_PMCI_SNAPSHOT_MAX_SIZE)
+		return;
+
+	list_for_each_entry(snap, &pmci->snapshots, node) {
+		if (snap->addr == addr && snap->size == size) {
+			memcpy(snap->data, buf, size);
+			snap->pinned |= pin;
+			list_move(&snap->node, &pmci->snapshots);
+			return;
+		}
+	}
+
+	if (pmci->n_snapshots >= M10BMC_PMCI_SNAPSHOT_MAX_NUM)
+		m10bmc_pmci_snapshot_evict(pmci);
+
+	snap = kmalloc(struct_size(snap, data, size), GFP_KERNEL);
+	if (!snap)
+		return;
+
+	snap->addr = addr;
+	snap->size = size;
+	snap->pinned = pin;
+	memcpy(snap->data, buf, size);
+	list_add(&snap->node, &pmci->snapshots);
+	pmci->n_snapshots++;
+}
+
+static void m10bmc_pmci_snapshot_flush(struct m10bmc_pmci_device *pmci)
+{
+	struct m10bmc_pmci_snapshot *snap, *tmp;
+
+	list_for_each_entry_safe(snap, tmp, &pmci->snapshots, node) {
+		list_del(&snap->node);
+		kfree(snap);
+	}
+	pmci->n_snapshots = 0;
+}
+
+static int m10bmc_pmci_flash_read_locked(struct m10bmc_pmci_device *pmci, u8 *buf,
+					 u32 addr, u32 size, bool pin)
+{
+	struct intel_m10bmc *m10bmc = &pmci->m10bmc;
+	int ret, ret2;
 
 	ret = m10bmc_pmci_set_flash_host_mux(m10bmc, true);
 	if (ret)
 		goto mux_fail;
 
 	ret = pmci_flash_bulk_read(m10bmc, buf, addr, size);
+	if (!ret)
+		m10bmc_pmci_snapshot_add(pmci, buf, addr, size, pin);
 
 mux_fail:
 	ret2 = m10bmc_pmci_set_flash_host_mux(m10bmc, false);
 
-unlock:
+	return ret ? ret : ret2;
+}
+
+static int m10bmc_pmci_flash_read(struct intel_m10bmc *m10bmc, u8 *buf, u32 addr, u32 size)
+{
+	struct m10bmc_pmci_device *pmci = container_of(m10bmc, struct m10bmc_pmci_device, m10bmc);
+	int ret;
+
+	mutex_lock(&pmci->flash_mutex);
+	if (!pmci->flash_busy)
+		ret = m10bmc_pmci_flash_read_locked(pmci, buf, addr, size, false);
+	else if (m10bmc_pmci_snapshot_read(pmci, buf, addr, size))
+		ret = 0;
+	else
+		ret = -EBUSY;
 	mutex_unlock(&pmci->flash_mutex);
-	if (ret)
-		return ret;
-	return ret2;
+
+	return ret;
+}
+
+/*
+ * Capture the flash data read by the sec-update driver before the update
+ * takes the flash, so that it stays readable for the duration of the update.
+ */
+static void m10bmc_pmci_snapshot_security_data(struct m10bmc_pmci_device *pmci)
+{
+	const struct m10bmc_csr_map *csr_map = pmci->m10bmc.info->csr_map;
+	const struct {
+		u32 addr;
+		u32 size;
+	} regions[] = {
+		{ csr_map->bmc_prog_addr, M10BMC_PMCI_REH_SNAPSHOT_SIZE },
+		{ csr_map->sr_prog_addr, M10BMC_PMCI_REH_SNAPSHOT_SIZE },
+		{ csr_map->pr_prog_addr, M10BMC_PMCI_REH_SNAPSHOT_SIZE },
+		{ csr_map->rsu_update_counter, M10BMC_PMCI_FLASH_COUNT_SIZE },
+	};
+	struct m10bmc_pmci_snapshot *snap;
+	u8 *buf;
+	int i;
+
+	buf = kmalloc(M10BMC_PMCI_SNAPSHOT_MAX_SIZE, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(regions); i++) {
+		snap = m10bmc_pmci_snapshot_find(pmci, regions[i].addr, regions[i].size);
+		if (snap) {
+			snap->pinned = true;
+			continue;
+		}
+
+		if (m10bmc_pmci_flash_read_locked(pmci, buf, regions[i].addr,
+						  regions[i].size, true))
+			dev_warn(pmci->m10bmc.dev, "failed to snapshot flash %x\n",
+				 regions[i].addr);
+	}
+
+	kfree(buf);
 }
 
 static int m10bmc_pmci_flash_write(struct intel_m10bmc *m10bmc, const u8 *buf, u32 offset, u32 size)
@@ -208,7 +378,9 @@ static int m10bmc_pmci_flash_lock(struct intel_m10bmc *m10bmc)
 		goto unlock;
 	}
 
+	m10bmc_pmci_snapshot_security_data(pmci);
 	pmci->flash_busy = true;
+	m10bmc_flash_gen_bump(m10bmc);
 
 unlock:
 	mutex_unlock(&pmci->flash_mutex);
@@ -222,6 +394,8 @@ static void m10bmc_pmci_flash_unlock(struct intel_m10bmc *m10bmc)
 	mutex_lock(&pmci->flash_mutex);
 	WARN_ON_ONCE(!pmci->flash_busy);
 	pmci->flash_busy = false;
+	m10bmc_pmci_snapshot_flush(pmci);
+	m10bmc_flash_gen_bump(m10bmc);
 	mutex_unlock(&pmci->flash_mutex);
 }
 
@@ -360,6 +534,7 @@ static int m10bmc_pmci_probe(struct dfl_device *ddev)
 		return PTR_ERR(pmci->base);
 
 	mutex_init(&pmci->flash_mutex);
+	INIT_LIST_HEAD(&pmci->snapshots);
 
 	pmci->m10bmc.regmap =
 		devm_regmap_init_indirect_register(dev,
@@ -382,6 +557,7 @@ static int m10bmc_pmci_probe(struct dfl_device *ddev)
 	return 0;
 
 destroy_mutex:
+	m10bmc_pmci_snapshot_flush(pmci);
 	mutex_destroy(&pmci->flash_mutex);
 	return ret;
 }
@@ -391,6 +567,7 @@ static void m10bmc_pmci_remove(struct dfl_device *ddev)
 	struct intel_m10bmc *m10bmc = dev_get_drvdata(&ddev->dev);
 	struct m10bmc_pmci_device *pmci = container_of(m10bmc, struct m10bmc_pmci_device, m10bmc);
 
+	m10bmc_pmci_snapshot_flush(pmci);
 	mutex_destroy(&pmci->flash_mutex);
 }
 
@@ -0,0 +1,494 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/* HSSI MAC statistics shared by the s10hssi and n5010-hssi drivers.
+ *
+ * Split out of s10hssi.c and n5010-hssi.c in 2026:
+ * Copyright (C) 2020 Intel Corporation. All rights reserved.
+ * Copyright (C) 2020 Silicom Denmark. All rights reserved.
+ *
+ * The 64-bit MAC counters are split in lo/hi register pairs behind the
+ * indirect regmap. A snapshot reads the whole stats block in a few
+ * regmap_bulk_read() runs, latched in the shadow registers of the MAC when
+ * available, and is cached for HSSI_STATS_CACHE_MS so that ethtool, rtnl and
+ * the standard stats groups do not each go to the hardware.
+ */
+
+#include <linux/device.h>
+#include <linux/hssi-stats.h>
+#include <linux/jiffies.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+#define HSSI_STATS_CACHE_MS	100
+#define HSSI_STATS_RUN_GAP	16
+#define HSSI_STATS_SHADOW_REQ	BIT(2)
+#define HSSI_STATS_SHADOW_ACK	BIT(1)
+#define HSSI_STATS_POLL_US	1
+#define HSSI_STATS_TIMEOUT_US	1000
+
+/*
+ * Without the shadow registers the low word is read just before the high
+ * word, so a carry between the two reads is only possible for a low word
+ * this close to wrapping; no counter advances by 2^24 in the few
+ * microseconds between them.
+ */
+#define HSSI_STATS_WRAP_LO	0xff000000
+
+struct hssi_stats_run {
+	u32 start;
+	u32 count;
+	u32 off;
+};
+
+struct hssi_stats {
+	struct regmap *regmap;
+	const struct hssi_stats_params *params;
+
+	/* serializes snapshots, protects raw and snap */
+	struct mutex lock;
+	/* protects cache, stamp and valid */
+	spinlock_t cache_lock;
+	struct work_struct work;
+	unsigned long stamp;
+	bool valid;
+	bool latch;
+
+	unsigned int nr_runs;
+	struct hssi_stats_run *runs;
+	u32 *map;
+	u32 *raw;
+	u64 *snap;
+	u64 *cache;
+	int std[HSSI_STD_MAX];
+};
+
+static int hssi_stats_cmp_addr(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int hssi_stats_latch(struct hssi_stats *st, bool on)
+{
+	const struct hssi_stats_params *params = st->params;
+	u32 val;
+	int ret;
+
+	ret = regmap_update_bits(st->regmap, params->tx_clr_off,
+				 HSSI_STATS_SHADOW_REQ,
+				 on ? HSSI_STATS_SHADOW_REQ : 0);
+	if (ret)
+		return ret;
+
+	ret = regmap_update_bits(st->regmap, params->rx_clr_off,
+				 HSSI_STATS_SHADOW_REQ,
+				 on ? HSSI_STATS_SHADOW_REQ : 0);
+	if (ret || !on)
+		return ret;
+
+	ret = regmap_read_poll_timeout(st->regmap, params->tx_clr_off + 1, val,
+				       val & HSSI_STATS_SHADOW_ACK,
+				       HSSI_STATS_POLL_US,
+				       HSSI_STATS_TIMEOUT_US);
+	if (ret)
+		return ret;
+
+	return regmap_read_poll_timeout(st->regmap, params->rx_clr_off + 1, val,
+					val & HSSI_STATS_SHADOW_ACK,
+					HSSI_STATS_POLL_US,
+					HSSI_STATS_TIMEOUT_US);
+}
+
+/*
+ * Finish a hi/lo/hi read of a counter whose low word was about to wrap in
+ * the bulk read: *hi was read after the old low word, read lo and hi again.
+ */
+static void hssi_stats_reread(struct hssi_stats *st, unsigned int addr,
+			      u32 *lo, u32 *hi)
+{
+	u32 lo2, hi2;
+
+	if (regmap_read(st->regmap, addr, &lo2) ||
+	    regmap_read(st->regmap, addr + 1, &hi2))
+		return;
+
+	/*
+	 * If the high word moved, lo2 was read either just before the carry,
+	 * and still belongs to *hi, or after it.
+	 */
+	*lo = lo2;
+	if (hi2 != *hi && !(lo2 & BIT(31)))
+		*hi = hi2;
+}
+
+static int hssi_stats_snapshot(struct hssi_stats *st)
+{
+	const struct hssi_stat_info *stat = st->params->info;
+	unsigned int i, num = st->params->num;
+	bool latched = false;
+	unsigned long flags;
+	u32 lo, hi;
+	int ret = 0;
+
+	mutex_lock(&st->lock);
+
+	if (st->latch) {
+		if (!hssi_stats_latch(st, true)) {
+			latched = true;
+		} else {
+			/* no shadow registers, fall back to hi/lo/hi reads */
+			hssi_stats_latch(st, false);
+			st->latch = false;
+		}
+	}
+
+	for (i = 0; i < st->nr_runs && !ret; i++)
+		ret = regmap_bulk_read(st->regmap, st->runs[i].start,
+				       st->raw + st->runs[i].off,
+				       st->runs[i].count);
+
+	if (latched)
+		hssi_stats_latch(st, false);
+
+	if (ret)
+		goto unlock;
+
+	for (i = 0; i < num; i++) {
+		lo = st->raw[st->map[i]];
+		hi = st->raw[st->map[i] + 1];
+
+		if (!latched && lo >= HSSI_STATS_WRAP_LO)
+			hssi_stats_reread(st, stat[i].addr, &lo, &hi);
+
+		st->snap[i] = lo | ((u64)hi << 32);
+	}
+
+	spin_lock_irqsave(&st->cache_lock, flags);
+	memcpy(st->cache, st->snap, num * sizeof(*st->cache));
+	st->stamp = jiffies;
+	st->valid = true;
+	spin_unlock_irqrestore(&st->cache_lock, flags);
+
+unlock:
+	mutex_unlock(&st->lock);
+
+	return ret;
+}
+
+static bool hssi_stats_stale(struct hssi_stats *st)
+{
+	return !st->valid ||
+	       time_after(jiffies,
+			  st->stamp + msecs_to_jiffies(HSSI_STATS_CACHE_MS));
+}
+
+/* Refresh the cached snapshot if it is too old, may sleep */
+static void hssi_stats_update(struct hssi_stats *st)
+{
+	if (hssi_stats_stale(st))
+		hssi_stats_snapshot(st);
+}
+
+static void hssi_stats_work(struct work_struct *work)
+{
+	hssi_stats_update(container_of(work, struct hssi_stats, work));
+}
+
+/* The caller must hold st->cache_lock */
+static u64 hssi_stats_std(struct hssi_stats *st, enum hssi_stats_std id)
+{
+	return st->std[id] < 0 ? 0 : st->cache[st->std[id]];
+}
+
+/**
+ * hssi_stats_lock - stop snapshots while the counters are cleared
+ * @st: statistics of the MAC.
+ */
+void hssi_stats_lock(struct hssi_stats *st)
+{
+	mutex_lock(&st->lock);
+}
+EXPORT_SYMBOL_GPL(hssi_stats_lock);
+
+/**
+ * hssi_stats_unlock - resume snapshots and drop the cached one
+ * @st: statistics of the MAC.
+ */
+void hssi_stats_unlock(struct hssi_stats *st)
+{
+	unsigned long flags;
+
+	mutex_unlock(&st->lock);
+
+	spin_lock_irqsave(&st->cache_lock, flags);
+	st->valid = false;
+	spin_unlock_irqrestore(&st->cache_lock, flags);
+}
+EXPORT_SYMBOL_GPL(hssi_stats_unlock);
+
+/**
+ * hssi_stats_read - read all counters, may sleep
+ * @st: statistics of the MAC.
+ * @data: buffer for the counters, in the order of the params info.
+ */
+void hssi_stats_read(struct hssi_stats *st, u64 *data)
+{
+	unsigned long flags;
+
+	hssi_stats_update(st);
+
+	spin_lock_irqsave(&st->cache_lock, flags);
+	memcpy(data, st->cache, st->params->num * sizeof(*data));
+	spin_unlock_irqrestore(&st->cache_lock, flags);
+}
+EXPORT_SYMBOL_GPL(hssi_stats_read);
+
+/**
+ * hssi_stats_get_stats64 - fill the rtnl counters from the cached snapshot
+ * @st: statistics of the MAC.
+ * @stats: rtnl counters.
+ *
+ * May be called in atomic context, a stale snapshot is only refreshed in
+ * the background.
+ */
+void hssi_stats_get_stats64(struct hssi_stats *st,
+			    struct rtnl_link_stats64 *stats)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&st->cache_lock, flags);
+	stats->tx_packets = hssi_stats_std(st, HSSI_STD_TX_UCAST) +
+			    hssi_stats_std(st, HSSI_STD_TX_MCAST) +
+			    hssi_stats_std(st, HSSI_STD_TX_BCAST);
+	stats->rx_packets = hssi_stats_std(st, HSSI_STD_RX_UCAST) +
+			    hssi_stats_std(st, HSSI_STD_RX_MCAST) +
+			    hssi_stats_std(st, HSSI_STD_RX_BCAST);
+	stats->tx_bytes = hssi_stats_std(st, HSSI_STD_TX_OCTETS);
+	stats->rx_bytes = hssi_stats_std(st, HSSI_STD_RX_OCTETS);
+	stats->multicast = hssi_stats_std(st, HSSI_STD_RX_MCAST);
+	stats->rx_crc_errors = hssi_stats_std(st, HSSI_STD_RX_CRC);
+	stats->rx_length_errors = hssi_stats_std(st, HSSI_STD_RX_UNDERSIZE) +
+				  hssi_stats_std(st, HSSI_STD_RX_OVERSIZE);
+	stats->rx_errors = stats->rx_crc_errors + stats->rx_length_errors +
+			   hssi_stats_std(st, HSSI_STD_RX_FRAGMENTS) +
+			   hssi_stats_std(st, HSSI_STD_RX_JABBERS);
+	if (hssi_stats_stale(st))
+		schedule_work(&st->work);
+	spin_unlock_irqrestore(&st->cache_lock, flags);
+}
+EXPORT_SYMBOL_GPL(hssi_stats_get_stats64);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+/**
+ * hssi_stats_get_pause_stats - fill the ethtool pause stats group
+ * @st: statistics of the MAC.
+ * @pause_stats: ethtool pause stats.
+ */
+void hssi_stats_get_pause_stats(struct hssi_stats *st,
+				struct ethtool_pause_stats *pause_stats)
+{
+	unsigned long flags;
+
+	hssi_stats_update(st);
+
+	spin_lock_irqsave(&st->cache_lock, flags);
+	pause_stats->tx_pause_frames = hssi_stats_std(st, HSSI_STD_TX_PAUSE);
+	pause_stats->rx_pause_frames = hssi_stats_std(st, HSSI_STD_RX_PAUSE);
+	spin_unlock_irqrestore(&st->cache_lock, flags);
+}
+EXPORT_SYMBOL_GPL(hssi_stats_get_pause_stats);
+
+/**
+ * hssi_stats_get_eth_mac_stats - fill the ethtool IEEE 802.3 MAC stats group
+ * @st: statistics of the MAC.
+ * @mac_stats: ethtool MAC stats.
+ */
+void hssi_stats_get_eth_mac_stats(struct hssi_stats *st,
+				  struct ethtool_eth_mac_stats *mac_stats)
+{
+	unsigned long flags;
+
+	hssi_stats_update(st);
+
+	spin_lock_irqsave(&st->cache_lock, flags);
+	mac_stats->FramesTransmittedOK =
+		hssi_stats_std(st, HSSI_STD_TX_UCAST) +
+		hssi_stats_std(st, HSSI_STD_TX_MCAST) +
+		hssi_stats_std(st, HSSI_STD_TX_BCAST);
+	mac_stats->FramesReceivedOK =
+		hssi_stats_std(st, HSSI_STD_RX_UCAST) +
+		hssi_stats_std(st, HSSI_STD_RX_MCAST) +
+		hssi_stats_std(st, HSSI_STD_RX_BCAST);
+	mac_stats->FrameCheckSequenceErrors =
+		hssi_stats_std(st, HSSI_STD_RX_CRC);
+	mac_stats->OctetsTransmittedOK =
+		hssi_stats_std(st, HSSI_STD_TX_OCTETS);
+	mac_stats->OctetsReceivedOK =
+		hssi_stats_std(st, HSSI_STD_RX_OCTETS);
+	mac_stats->MulticastFramesXmittedOK =
+		hssi_stats_std(st, HSSI_STD_TX_MCAST);
+	mac_stats->BroadcastFramesXmittedOK =
+		hssi_stats_std(st, HSSI_STD_TX_BCAST);
+	mac_stats->MulticastFramesReceivedOK =
+		hssi_stats_std(st, HSSI_STD_RX_MCAST);
+	mac_stats->BroadcastFramesReceivedOK =
+		hssi_stats_std(st, HSSI_STD_RX_BCAST);
+	mac_stats->FrameTooLongErrors =
+		hssi_stats_std(st, HSSI_STD_RX_OVERSIZE);
+	spin_unlock_irqrestore(&st->cache_lock, flags);
+}
+EXPORT_SYMBOL_GPL(hssi_stats_get_eth_mac_stats);
+
+static const struct ethtool_rmon_hist_range hssi_stats_rmon_ranges[] = {
+	{   64,   64 },
+	{   65,  127 },
+	{  128,  255 },
+	{  256,  511 },
+	{  512, 1023 },
+	{ 1024, 1518 },
+	{ 1519, HSSI_STATS_HIST_MAX_LEN },
+	{}
+};
+
+/**
+ * hssi_stats_get_rmon_stats - fill the ethtool RMON stats group
+ * @st: statistics of the MAC.
+ * @rmon_stats: ethtool RMON stats.
+ * @ranges: set to the frame length ranges of the histogram buckets.
+ */
+void hssi_stats_get_rmon_stats(struct hssi_stats *st,
+			       struct ethtool_rmon_stats *rmon_stats,
+			       const struct ethtool_rmon_hist_range **ranges)
+{
+	unsigned long flags;
+	int i;
+
+	hssi_stats_update(st);
+
+	spin_lock_irqsave(&st->cache_lock, flags);
+	rmon_stats->undersize_pkts = hssi_stats_std(st, HSSI_STD_RX_UNDERSIZE);
+	rmon_stats->oversize_pkts = hssi_stats_std(st, HSSI_STD_RX_OVERSIZE);
+	rmon_stats->fragments = hssi_stats_std(st, HSSI_STD_RX_FRAGMENTS);
+	rmon_stats->jabbers = hssi_stats_std(st, HSSI_STD_RX_JABBERS);
+	for (i = 0; i < HSSI_STATS_HIST_BUCKETS; i++) {
+		rmon_stats->hist[i] =
+			hssi_stats_std(st, HSSI_STD_RX_HIST + i);
+		rmon_stats->hist_tx[i] =
+			hssi_stats_std(st, HSSI_STD_TX_HIST + i);
+	}
+	spin_unlock_irqrestore(&st->cache_lock, flags);
+
+	*ranges = hssi_stats_rmon_ranges;
+}
+EXPORT_SYMBOL_GPL(hssi_stats_get_rmon_stats);
+#endif
+
+static void hssi_stats_cancel(void *data)
+{
+	struct hssi_stats *st = data;
+
+	cancel_work_sync(&st->work);
+}
+
+/**
+ * devm_hssi_stats_init - set up the statistics snapshots of a MAC
+ * @dev: device the allocations are managed by.
+ * @regmap: regmap of the MAC.
+ * @params: statistics block of the MAC, must outlive @dev's driver binding.
+ *
+ * Return: the statistics on success, NULL on allocation failure.
+ */
+struct hssi_stats *devm_hssi_stats_init(struct device *dev,
+					struct regmap *regmap,
+					const struct hssi_stats_params *params)
+{
+	const struct hssi_stat_info *stat = params->info;
+	unsigned int i, j, num = params->num;
+	struct hssi_stats_run *run;
+	struct hssi_stats *st;
+	u32 *addr, total = 0;
+
+	st = devm_kzalloc(dev, sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return NULL;
+
+	st->regmap = regmap;
+	st->params = params;
+	st->latch = params->latch;
+	mutex_init(&st->lock);
+	spin_lock_init(&st->cache_lock);
+	INIT_WORK(&st->work, hssi_stats_work);
+	if (devm_add_action_or_reset(dev, hssi_stats_cancel, st))
+		return NULL;
+
+	st->runs = devm_kcalloc(dev, num, sizeof(*st->runs), GFP_KERNEL);
+	st->map = devm_kcalloc(dev, num, sizeof(*st->map), GFP_KERNEL);
+	st->snap = devm_kcalloc(dev, num, sizeof(*st->snap), GFP_KERNEL);
+	st->cache = devm_kcalloc(dev, num, sizeof(*st->cache), GFP_KERNEL);
+	addr = kcalloc(num, sizeof(*addr), GFP_KERNEL);
+	if (!st->runs || !st->map || !st->snap || !st->cache || !addr) {
+		kfree(addr);
+		return NULL;
+	}
+
+	/* merge the lo/hi pairs into runs of nearby registers */
+	for (i = 0; i < num; i++)
+		addr[i] = stat[i].addr;
+	sort(addr, num, sizeof(*addr), hssi_stats_cmp_addr, NULL);
+
+	for (i = 0; i < num; i++) {
+		run = st->nr_runs ? &st->runs[st->nr_runs - 1] : NULL;
+		if (run &&
+		    addr[i] <= run->start + run->count + HSSI_STATS_RUN_GAP) {
+			run->count = max(run->count, addr[i] + 2 - run->start);
+			continue;
+		}
+
+		run = &st->runs[st->nr_runs++];
+		run->start = addr[i];
+		run->count = 2;
+	}
+	kfree(addr);
+
+	for (i = 0; i < st->nr_runs; i++) {
+		st->runs[i].off = total;
+		total += st->runs[i].count;
+	}
+
+	st->raw = devm_kcalloc(dev, total, sizeof(*st->raw), GFP_KERNEL);
+	if (!st->raw)
+		return NULL;
+
+	for (i = 0; i < num; i++) {
+		for (j = 0; j < st->nr_runs; j++) {
+			run = &st->runs[j];
+			if (stat[i].addr >= run->start &&
+			    stat[i].addr < run->start + run->count)
+				break;
+		}
+		st->map[i] = run->off + stat[i].addr - run->start;
+	}
+
+	for (j = 0; j < HSSI_STD_MAX; j++) {
+		st->std[j] = -1;
+		for (i = 0; params->std_addr[j] && i < num; i++) {
+			if (stat[i].addr == params->std_addr[j]) {
+				st->std[j] = i;
+				break;
+			}
+		}
+	}
+
+	return st;
+}
+EXPORT_SYMBOL_GPL(devm_hssi_stats_init);
+
+MODULE_DESCRIPTION("HSSI MAC statistics");
+MODULE_AUTHOR("Intel Corporation");
+MODULE_AUTHOR("Esa Leskinen <ele@silicom.dk>");
+MODULE_LICENSE("GPL v2");
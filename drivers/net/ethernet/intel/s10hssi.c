@@ -9,11 +9,17 @@
 #include <linux/dfl.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
+#include <linux/hssi-stats.h>
 #include <linux/io-64-nonatomic-lo-hi.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/n5010-dp.h>
 #include <linux/netdevice.h>
 #include <linux/regmap.h>
 #include <linux/uaccess.h>
+#include <linux/version.h>
+#include <linux/workqueue.h>
 
 #define CAPABILITY_OFF		0x08
 #define CAP_AVAILABLE_RATES	GENMASK_ULL(7, 0)
@@ -67,17 +73,18 @@
 #define STATS_CLR_INT_US		1
 #define STATS_CLR_INT_TIMEOUT_US	1000
 
+static unsigned int link_poll_ms = 10;
+module_param(link_poll_ms, uint, 0644);
+MODULE_PARM_DESC(link_poll_ms,
+		 "Link state poll interval in ms while up (default 10)");
+
 struct s10hssi_drvdata {
 	struct net_device *netdev;
-	struct timer_list poll_timer;
-	struct work_struct poll_workq;
+	struct delayed_work poll_work;
 };
 
 struct s10hssi_ops_params {
-	struct stat_info *stats;
-	u32 num_stats;
-	u32 tx_clr_off;
-	u32 rx_clr_off;
+	struct hssi_stats_params stats;
 	u32 lpbk_off;
 	u32 lpbk_en_val;
 	u32 link_off;
@@ -88,37 +95,96 @@ struct s10hssi_netdata {
 	struct dfl_device *dfl_dev;
 	struct regmap *regmap;
 	struct s10hssi_ops_params *ops_params;
+	struct hssi_stats *stats;
+	struct n5010_dp *dp;
+
+	/* link state and flap history, protected by link_lock */
+	struct mutex link_lock;
 	u32 link_status;
+	u64 link_up_events;
+	u64 link_down_events;
+	u64 link_up_ts;
+	u64 link_down_ts;
 };
 
-static void poll_work(struct work_struct *arg)
+static void s10hssi_update_link(struct net_device *netdev)
 {
-	struct s10hssi_netdata *npriv;
-	struct s10hssi_drvdata *priv;
+	struct s10hssi_netdata *npriv = netdev_priv(netdev);
 	u32 link_status = 0;
 
-	priv = container_of(arg, struct s10hssi_drvdata, poll_workq);
-	npriv = netdev_priv(priv->netdev);
+	mutex_lock(&npriv->link_lock);
 
 	regmap_read(npriv->regmap, npriv->ops_params->link_off, &link_status);
 	link_status &= npriv->ops_params->link_mask;
 	if (link_status != npriv->link_status) {
 		npriv->link_status = link_status;
-		dev_dbg(&priv->netdev->dev, "link state: %u\n", link_status);
+		dev_dbg(&netdev->dev, "link state: %u\n", link_status);
 
-		if (link_status == npriv->ops_params->link_mask)
-			netif_carrier_on(priv->netdev);
-		else
-			netif_carrier_off(priv->netdev);
+		if (link_status == npriv->ops_params->link_mask) {
+			npriv->link_up_events++;
+			npriv->link_up_ts = ktime_get_real_ns();
+			netif_carrier_on(netdev);
+		} else {
+			npriv->link_down_events++;
+			npriv->link_down_ts = ktime_get_real_ns();
+			netif_carrier_off(netdev);
+		}
 	}
+
+	mutex_unlock(&npriv->link_lock);
+}
+
+static unsigned long s10hssi_poll_delay(void)
+{
+	return msecs_to_jiffies(max(READ_ONCE(link_poll_ms), 1U));
 }
 
-static void poll_timerf(struct timer_list *timer_arg)
+static void poll_work(struct work_struct *arg)
 {
-	struct s10hssi_drvdata *priv = from_timer(priv, timer_arg, poll_timer);
+	struct s10hssi_drvdata *priv;
+
+	priv = container_of(to_delayed_work(arg), struct s10hssi_drvdata,
+			    poll_work);
+
+	s10hssi_update_link(priv->netdev);
 
-	schedule_work(&priv->poll_workq);
-	mod_timer(&priv->poll_timer, jiffies + msecs_to_jiffies(1000));
+	schedule_delayed_work(&priv->poll_work, s10hssi_poll_delay());
+}
+
+static int netdev_open(struct net_device *netdev)
+{
+	struct s10hssi_netdata *npriv = netdev_priv(netdev);
+	struct s10hssi_drvdata *priv = dev_get_drvdata(&npriv->dfl_dev->dev);
+	int ret;
+
+	if (npriv->dp) {
+		ret = n5010_dp_open(npriv->dp);
+		if (ret)
+			return ret;
+	}
+
+	s10hssi_update_link(netdev);
+
+	/*
+	 * The MAC has no documented link change status to clear from an
+	 * interrupt handler, so the link state is polled while up.
+	 */
+	schedule_delayed_work(&priv->poll_work, s10hssi_poll_delay());
+
+	return 0;
+}
+
+static int netdev_stop(struct net_device *netdev)
+{
+	struct s10hssi_netdata *npriv = netdev_priv(netdev);
+	struct s10hssi_drvdata *priv = dev_get_drvdata(&npriv->dfl_dev->dev);
+
+	cancel_delayed_work_sync(&priv->poll_work);
+
+	if (npriv->dp)
+		n5010_dp_stop(npriv->dp);
+
+	return 0;
 }
 
 static int netdev_change_mtu(struct net_device *netdev, int new_mtu)
@@ -164,93 +230,122 @@ static int netdev_set_mac_address(struct net_device *ndev, void *p)
 static netdev_tx_t s10hssi_dummy_netdev_xmit(struct sk_buff *skb,
 					     struct net_device *dev)
 {
+	struct s10hssi_netdata *npriv;
+
 	if (!dev)
 		return -EINVAL;
 
+	npriv = netdev_priv(dev);
+	if (npriv->dp)
+		return n5010_dp_xmit(npriv->dp, skb);
+
 	kfree_skb(skb);
 	net_warn_ratelimited("%s(): Dropping skb.\n", __func__);
 	return NETDEV_TX_OK;
 }
 
+static void netdev_get_stats64(struct net_device *netdev,
+			       struct rtnl_link_stats64 *stats)
+{
+	struct s10hssi_netdata *npriv = netdev_priv(netdev);
+
+	hssi_stats_get_stats64(npriv->stats, stats);
+
+	/*
+	 * The MAC also counts the AFU traffic, with a host datapath the
+	 * packet and byte counters come from the host queues instead.
+	 */
+	if (npriv->dp) {
+		stats->tx_packets = 0;
+		stats->tx_bytes = 0;
+		stats->rx_packets = 0;
+		stats->rx_bytes = 0;
+		n5010_dp_get_stats64(npriv->dp, stats);
+	}
+}
+
 static const struct net_device_ops netdev_ops = {
+	.ndo_open = netdev_open,
+	.ndo_stop = netdev_stop,
 	.ndo_change_mtu = netdev_change_mtu,
 	.ndo_set_features = netdev_set_features,
 	.ndo_set_mac_address = netdev_set_mac_address,
 	.ndo_start_xmit = s10hssi_dummy_netdev_xmit,
+	.ndo_get_stats64 = netdev_get_stats64,
 };
 
-struct stat_info {
-	unsigned int addr;
-	char string[ETH_GSTRING_LEN];
-};
-
-#define STAT_INFO(_addr, _string) \
-	.addr = _addr, .string = _string,
-
-static struct stat_info stats_10g[] = {
+static const struct hssi_stat_info stats_10g[] = {
 	/* TX Statistics */
-	{STAT_INFO(0x1c02, "tx_frame_ok")},
-	{STAT_INFO(0x1c04, "tx_frame_err")},
-	{STAT_INFO(0x1c06, "tx_frame_crc_err")},
-	{STAT_INFO(0x1c08, "tx_octets_ok")},
-	{STAT_INFO(0x1c0a, "tx_pause_mac_ctrl_frames")},
-	{STAT_INFO(0x1c0c, "tx_if_err")},
-	{STAT_INFO(0x1c0e, "tx_unicast_frame_ok")},
-	{STAT_INFO(0x1c10, "tx_unicast_frame_err")},
-	{STAT_INFO(0x1c12, "tx_multicast_frame_ok")},
-	{STAT_INFO(0x1c14, "tx_multicast_frame_err")},
-	{STAT_INFO(0x1c16, "tx_broadcast_frame_ok")},
-	{STAT_INFO(0x1c18, "tx_broadcast_frame_err")},
-	{STAT_INFO(0x1c1a, "tx_ether_octets")},
-	{STAT_INFO(0x1c1c, "tx_ether_pkts")},
-	{STAT_INFO(0x1c1e, "tx_ether_undersize_pkts")},
-	{STAT_INFO(0x1c20, "tx_ether_oversize_pkts")},
-	{STAT_INFO(0x1c22, "tx_ether_pkts_64_octets")},
-	{STAT_INFO(0x1c24, "tx_ether_pkts_65_127_octets")},
-	{STAT_INFO(0x1c26, "tx_ether_pkts_128_255_octets")},
-	{STAT_INFO(0x1c28, "tx_ether_pkts_256_511_octets")},
-	{STAT_INFO(0x1c2a, "tx_ether_pkts_512_1023_octets")},
-	{STAT_INFO(0x1c2c, "tx_ether_pkts_1024_1518_octets")},
-	{STAT_INFO(0x1c2e, "tx_ether_pkts_1519_x_octets")},
-	{STAT_INFO(0x1c30, "tx_ether_fragments")},
-	{STAT_INFO(0x1c32, "tx_ether_jabbers")},
-	{STAT_INFO(0x1c34, "tx_ether_crc_err")},
-	{STAT_INFO(0x1c36, "tx_unicast_mac_ctrl_frames")},
-	{STAT_INFO(0x1c38, "tx_multicast_mac_ctrl_frames")},
-	{STAT_INFO(0x1c3a, "tx_broadcast_mac_ctrl_frames")},
-	{STAT_INFO(0x1c3c, "tx_pfc_mac_ctrl_frames")},
+	{HSSI_STAT_INFO(0x1c02, "tx_frame_ok")},
+	{HSSI_STAT_INFO(0x1c04, "tx_frame_err")},
+	{HSSI_STAT_INFO(0x1c06, "tx_frame_crc_err")},
+	{HSSI_STAT_INFO(0x1c08, "tx_octets_ok")},
+	{HSSI_STAT_INFO(0x1c0a, "tx_pause_mac_ctrl_frames")},
+	{HSSI_STAT_INFO(0x1c0c, "tx_if_err")},
+	{HSSI_STAT_INFO(0x1c0e, "tx_unicast_frame_ok")},
+	{HSSI_STAT_INFO(0x1c10, "tx_unicast_frame_err")},
+	{HSSI_STAT_INFO(0x1c12, "tx_multicast_frame_ok")},
+	{HSSI_STAT_INFO(0x1c14, "tx_multicast_frame_err")},
+	{HSSI_STAT_INFO(0x1c16, "tx_broadcast_frame_ok")},
+	{HSSI_STAT_INFO(0x1c18, "tx_broadcast_frame_err")},
+	{HSSI_STAT_INFO(0x1c1a, "tx_ether_octets")},
+	{HSSI_STAT_INFO(0x1c1c, "tx_ether_pkts")},
+	{HSSI_STAT_INFO(0x1c1e, "tx_ether_undersize_pkts")},
+	{HSSI_STAT_INFO(0x1c20, "tx_ether_oversize_pkts")},
+	{HSSI_STAT_INFO(0x1c22, "tx_ether_pkts_64_octets")},
+	{HSSI_STAT_INFO(0x1c24, "tx_ether_pkts_65_127_octets")},
+	{HSSI_STAT_INFO(0x1c26, "tx_ether_pkts_128_255_octets")},
+	{HSSI_STAT_INFO(0x1c28, "tx_ether_pkts_256_511_octets")},
+	{HSSI_STAT_INFO(0x1c2a, "tx_ether_pkts_512_1023_octets")},
+	{HSSI_STAT_INFO(0x1c2c, "tx_ether_pkts_1024_1518_octets")},
+	{HSSI_STAT_INFO(0x1c2e, "tx_ether_pkts_1519_x_octets")},
+	{HSSI_STAT_INFO(0x1c30, "tx_ether_fragments")},
+	{HSSI_STAT_INFO(0x1c32, "tx_ether_jabbers")},
+	{HSSI_STAT_INFO(0x1c34, "tx_ether_crc_err")},
+	{HSSI_STAT_INFO(0x1c36, "tx_unicast_mac_ctrl_frames")},
+	{HSSI_STAT_INFO(0x1c38, "tx_multicast_mac_ctrl_frames")},
+	{HSSI_STAT_INFO(0x1c3a, "tx_broadcast_mac_ctrl_frames")},
+	{HSSI_STAT_INFO(0x1c3c, "tx_pfc_mac_ctrl_frames")},
 
 	/* RX Statistics */
-	{STAT_INFO(0x0c02, "rx_frame_ok")},
-	{STAT_INFO(0x0c04, "rx_frame_err")},
-	{STAT_INFO(0x0c06, "rx_frame_crc_err")},
-	{STAT_INFO(0x0c08, "rx_octets_ok")},
-	{STAT_INFO(0x0c0a, "rx_pause_mac_ctrl_frames")},
-	{STAT_INFO(0x0c0c, "rx_if_err")},
-	{STAT_INFO(0x0c0e, "rx_unicast_frame_ok")},
-	{STAT_INFO(0x0c10, "rx_unicast_frame_err")},
-	{STAT_INFO(0x0c12, "rx_multicast_frame_ok")},
-	{STAT_INFO(0x0c14, "rx_multicast_frame_err")},
-	{STAT_INFO(0x0c16, "rx_broadcast_frame_ok")},
-	{STAT_INFO(0x0c18, "rx_broadcast_frame_err")},
-	{STAT_INFO(0x0c1a, "rx_ether_octets")},
-	{STAT_INFO(0x0c1c, "rx_ether_pkts")},
-	{STAT_INFO(0x0c1e, "rx_ether_undersize_pkts")},
-	{STAT_INFO(0x0c20, "rx_ether_oversize_pkts")},
-	{STAT_INFO(0x0c22, "rx_ether_pkts_64_octets")},
-	{STAT_INFO(0x0c24, "rx_ether_pkts_65_127_octets")},
-	{STAT_INFO(0x0c26, "rx_ether_pkts_128_255_octets")},
-	{STAT_INFO(0x0c28, "rx_ether_pkts_256_511_octets")},
-	{STAT_INFO(0x0c2a, "rx_ether_pkts_512_1023_octets")},
-	{STAT_INFO(0x0c2c, "rx_ether_pkts_1024_1518_octets")},
-	{STAT_INFO(0x0c2e, "rx_ether_pkts_1519_x_octets")},
-	{STAT_INFO(0x0c30, "rx_ether_fragments")},
-	{STAT_INFO(0x0c32, "rx_ether_jabbers")},
-	{STAT_INFO(0x0c34, "rx_ether_crc_err")},
-	{STAT_INFO(0x0c36, "rx_unicast_mac_ctrl_frames")},
-	{STAT_INFO(0x0c38, "rx_multicast_mac_ctrl_frames")},
-	{STAT_INFO(0x0c3a, "rx_broadcast_mac_ctrl_frames")},
-	{STAT_INFO(0x0c3c, "rx_pfc_mac_ctrl_frames")},
+	{HSSI_STAT_INFO(0x0c02, "rx_frame_ok")},
+	{HSSI_STAT_INFO(0x0c04, "rx_frame_err")},
+	{HSSI_STAT_INFO(0x0c06, "rx_frame_crc_err")},
+	{HSSI_STAT_INFO(0x0c08, "rx_octets_ok")},
+	{HSSI_STAT_INFO(0x0c0a, "rx_pause_mac_ctrl_frames")},
+	{HSSI_STAT_INFO(0x0c0c, "rx_if_err")},
+	{HSSI_STAT_INFO(0x0c0e, "rx_unicast_frame_ok")},
+	{HSSI_STAT_INFO(0x0c10, "rx_unicast_frame_err")},
+	{HSSI_STAT_INFO(0x0c12, "rx_multicast_frame_ok")},
+	{HSSI_STAT_INFO(0x0c14, "rx_multicast_frame_err")},
+	{HSSI_STAT_INFO(0x0c16, "rx_broadcast_frame_ok")},
+	{HSSI_STAT_INFO(0x0c18, "rx_broadcast_frame_err")},
+	{HSSI_STAT_INFO(0x0c1a, "rx_ether_octets")},
+	{HSSI_STAT_INFO(0x0c1c, "rx_ether_pkts")},
+	{HSSI_STAT_INFO(0x0c1e, "rx_ether_undersize_pkts")},
+	{HSSI_STAT_INFO(0x0c20, "rx_ether_oversize_pkts")},
+	{HSSI_STAT_INFO(0x0c22, "rx_ether_pkts_64_octets")},
+	{HSSI_STAT_INFO(0x0c24, "rx_ether_pkts_65_127_octets")},
+	{HSSI_STAT_INFO(0x0c26, "rx_ether_pkts_128_255_octets")},
+	{HSSI_STAT_INFO(0x0c28, "rx_ether_pkts_256_511_octets")},
+	{HSSI_STAT_INFO(0x0c2a, "rx_ether_pkts_512_1023_octets")},
+	{HSSI_STAT_INFO(0x0c2c, "rx_ether_pkts_1024_1518_octets")},
+	{HSSI_STAT_INFO(0x0c2e, "rx_ether_pkts_1519_x_octets")},
+	{HSSI_STAT_INFO(0x0c30, "rx_ether_fragments")},
+	{HSSI_STAT_INFO(0x0c32, "rx_ether_jabbers")},
+	{HSSI_STAT_INFO(0x0c34, "rx_ether_crc_err")},
+	{HSSI_STAT_INFO(0x0c36, "rx_unicast_mac_ctrl_frames")},
+	{HSSI_STAT_INFO(0x0c38, "rx_multicast_mac_ctrl_frames")},
+	{HSSI_STAT_INFO(0x0c3a, "rx_broadcast_mac_ctrl_frames")},
+	{HSSI_STAT_INFO(0x0c3c, "rx_pfc_mac_ctrl_frames")},
+};
+
+/* Software link statistics, reported after the MAC statistics */
+static const char link_stats[][ETH_GSTRING_LEN] = {
+	"link_up_events",
+	"link_down_events",
+	"link_last_up_ns",
+	"link_last_down_ns",
 };
 
 static void ethtool_get_strings(struct net_device *netdev, u32 stringset,
@@ -258,12 +353,12 @@ static void ethtool_get_strings(struct net_device *netdev, u32 stringset,
 {
 	struct s10hssi_netdata *npriv = netdev_priv(netdev);
 	unsigned int i, stats_num = 0;
-	struct stat_info *stat;
+	const struct hssi_stat_info *stat;
 
 	switch (stringset) {
 	case ETH_SS_STATS:
-		stat = npriv->ops_params->stats;
-		stats_num = npriv->ops_params->num_stats;
+		stat = npriv->ops_params->stats.info;
+		stats_num = npriv->ops_params->stats.num;
 		break;
 	default:
 		return;
@@ -271,6 +366,8 @@ static void ethtool_get_strings(struct net_device *netdev, u32 stringset,
 
 	for (i = 0; i < stats_num; i++, s += ETH_GSTRING_LEN)
 		memcpy(s, stat[i].string, ETH_GSTRING_LEN);
+
+	memcpy(s, link_stats, sizeof(link_stats));
 }
 
 static int ethtool_get_sset_count(struct net_device *netdev, int stringset)
@@ -279,84 +376,150 @@ static int ethtool_get_sset_count(struct net_device *netdev, int stringset)
 
 	switch (stringset) {
 	case ETH_SS_STATS:
-		return npriv->ops_params->num_stats;
+		return npriv->ops_params->stats.num + ARRAY_SIZE(link_stats);
 
 	default:
 		return 0;
 	}
 }
 
-static u64 read_mac_stat(struct regmap *regmap, unsigned int addr)
-{
-	u32 data_l, data_h;
-
-	regmap_read(regmap, addr, &data_l);
-	regmap_read(regmap, addr + 1, &data_h);
-
-	return data_l + ((u64)data_h << 32);
-}
-
 static int ethtool_reset(struct net_device *netdev, u32 *flags)
 {
 	struct s10hssi_netdata *npriv = netdev_priv(netdev);
+	const struct hssi_stats_params *params = &npriv->ops_params->stats;
 	struct device *dev = &npriv->dfl_dev->dev;
-	int ret;
+	int ret = 0;
 	u32 val;
 
 	if (*flags | ETH_RESET_MGMT) {
-		regmap_write(npriv->regmap, npriv->ops_params->tx_clr_off, 1);
+		hssi_stats_lock(npriv->stats);
 
-		ret = regmap_read_poll_timeout(npriv->regmap,  npriv->ops_params->tx_clr_off,
+		regmap_write(npriv->regmap, params->tx_clr_off, 1);
+
+		ret = regmap_read_poll_timeout(npriv->regmap,
+					       params->tx_clr_off,
 					       val, (!val), STATS_CLR_INT_US,
 					       STATS_CLR_INT_TIMEOUT_US);
 
 		if (ret) {
 			dev_err(dev, "%s failed to clear tx stats\n", __func__);
-			return ret;
+			goto unlock;
 		}
 
-		regmap_write(npriv->regmap, npriv->ops_params->rx_clr_off, 1);
+		regmap_write(npriv->regmap, params->rx_clr_off, 1);
 
-		ret = regmap_read_poll_timeout(npriv->regmap,  npriv->ops_params->rx_clr_off,
+		ret = regmap_read_poll_timeout(npriv->regmap,
+					       params->rx_clr_off,
 					       val, (!val), STATS_CLR_INT_US,
 					       STATS_CLR_INT_TIMEOUT_US);
 
 		if (ret) {
 			dev_err(dev, "%s failed to clear rx stats\n", __func__);
-			return ret;
+			goto unlock;
 		}
 		dev_info(dev, "%s reset statistics registers\n", __func__);
+unlock:
+		hssi_stats_unlock(npriv->stats);
 	}
 
-	return 0;
+	return ret;
 }
 
 static void ethtool_get_stats(struct net_device *netdev,
 			      struct ethtool_stats *stats, u64 *data)
 {
 	struct s10hssi_netdata *npriv = netdev_priv(netdev);
-	unsigned int i, stats_num = npriv->ops_params->num_stats;
-	struct stat_info *stat = npriv->ops_params->stats;
-	u32 flags = ETH_RESET_MGMT;
+	unsigned int i = npriv->ops_params->stats.num;
+
+	hssi_stats_read(npriv->stats, data);
+
+	mutex_lock(&npriv->link_lock);
+	data[i++] = npriv->link_up_events;
+	data[i++] = npriv->link_down_events;
+	data[i++] = npriv->link_up_ts;
+	data[i++] = npriv->link_down_ts;
+	mutex_unlock(&npriv->link_lock);
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+static void ethtool_get_pause_stats(struct net_device *netdev,
+				    struct ethtool_pause_stats *pause_stats)
+{
+	struct s10hssi_netdata *npriv = netdev_priv(netdev);
+
+	hssi_stats_get_pause_stats(npriv->stats, pause_stats);
+}
+
+static void ethtool_get_eth_mac_stats(struct net_device *netdev,
+				      struct ethtool_eth_mac_stats *mac_stats)
+{
+	struct s10hssi_netdata *npriv = netdev_priv(netdev);
+
+	hssi_stats_get_eth_mac_stats(npriv->stats, mac_stats);
+}
 
-	for (i = 0; i < stats_num; i++)
-		data[i] = read_mac_stat(npriv->regmap, stat[i].addr);
+static void ethtool_get_rmon_stats(struct net_device *netdev,
+				   struct ethtool_rmon_stats *rmon_stats,
+				   const struct ethtool_rmon_hist_range **ranges)
+{
+	struct s10hssi_netdata *npriv = netdev_priv(netdev);
 
-	ethtool_reset(netdev, &flags);
+	hssi_stats_get_rmon_stats(npriv->stats, rmon_stats, ranges);
 }
+#endif
 
 static const struct ethtool_ops ethtool_ops = {
 	.get_strings = ethtool_get_strings,
 	.get_sset_count = ethtool_get_sset_count,
 	.get_ethtool_stats = ethtool_get_stats,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+	.get_pause_stats = ethtool_get_pause_stats,
+	.get_eth_mac_stats = ethtool_get_eth_mac_stats,
+	.get_rmon_stats = ethtool_get_rmon_stats,
+#endif
 	.reset = ethtool_reset,
 };
 
+static const unsigned int std_10g[HSSI_STD_MAX] = {
+	[HSSI_STD_TX_UCAST]	= 0x1c0e,
+	[HSSI_STD_TX_MCAST]	= 0x1c12,
+	[HSSI_STD_TX_BCAST]	= 0x1c16,
+	[HSSI_STD_RX_UCAST]	= 0x0c0e,
+	[HSSI_STD_RX_MCAST]	= 0x0c12,
+	[HSSI_STD_RX_BCAST]	= 0x0c16,
+	[HSSI_STD_TX_OCTETS]	= 0x1c08,
+	[HSSI_STD_RX_OCTETS]	= 0x0c08,
+	[HSSI_STD_TX_PAUSE]	= 0x1c0a,
+	[HSSI_STD_RX_PAUSE]	= 0x0c0a,
+	[HSSI_STD_RX_CRC]	= 0x0c06,
+	[HSSI_STD_RX_UNDERSIZE]	= 0x0c1e,
+	[HSSI_STD_RX_OVERSIZE]	= 0x0c20,
+	[HSSI_STD_RX_FRAGMENTS]	= 0x0c30,
+	[HSSI_STD_RX_JABBERS]	= 0x0c32,
+	[HSSI_STD_TX_HIST + 0]	= 0x1c22,
+	[HSSI_STD_TX_HIST + 1]	= 0x1c24,
+	[HSSI_STD_TX_HIST + 2]	= 0x1c26,
+	[HSSI_STD_TX_HIST + 3]	= 0x1c28,
+	[HSSI_STD_TX_HIST + 4]	= 0x1c2a,
+	[HSSI_STD_TX_HIST + 5]	= 0x1c2c,
+	[HSSI_STD_TX_HIST + 6]	= 0x1c2e,
+	[HSSI_STD_RX_HIST + 0]	= 0x0c22,
+	[HSSI_STD_RX_HIST + 1]	= 0x0c24,
+	[HSSI_STD_RX_HIST + 2]	= 0x0c26,
+	[HSSI_STD_RX_HIST + 3]	= 0x0c28,
+	[HSSI_STD_RX_HIST + 4]	= 0x0c2a,
+	[HSSI_STD_RX_HIST + 5]	= 0x0c2c,
+	[HSSI_STD_RX_HIST + 6]	= 0x0c2e,
+};
+
 static const struct s10hssi_ops_params s10hssi_params = {
-	.stats = stats_10g,
-	.num_stats = ARRAY_SIZE(stats_10g),
-	.tx_clr_off = ILL_10G_TX_STATS_CLR,
-	.rx_clr_off = ILL_10G_RX_STATS_CLR,
+	.stats = {
+		.info = stats_10g,
+		.num = ARRAY_SIZE(stats_10g),
+		.std_addr = std_10g,
+		.tx_clr_off = ILL_10G_TX_STATS_CLR,
+		.rx_clr_off = ILL_10G_RX_STATS_CLR,
+	},
 	.lpbk_off = PHY_BASE_OFF + PHY_RX_SER_LOOP_BACK,
 	.lpbk_en_val = 1,
 	.link_off = PHY_BASE_OFF + PHY_RX_LOCKED_OFF,
@@ -373,75 +536,110 @@ static const struct regmap_access_table access_table_10g = {
 	.n_yes_ranges	= ARRAY_SIZE(regmap_range_10g),
 };
 
-static struct stat_info stats_100g[] = {
+static const struct hssi_stat_info stats_100g[] = {
 	/* tx statistics */
-	{STAT_INFO(0x800, "tx_fragments")},
-	{STAT_INFO(0x802, "tx_jabbers")},
-	{STAT_INFO(0x804, "tx_crcerr")},
-	{STAT_INFO(0x806, "tx_crcerr_sizeok")},
-	{STAT_INFO(0x808, "tx_mcast_data_err")},
-	{STAT_INFO(0x80a, "tx_bcast_data_err")},
-	{STAT_INFO(0x80c, "tx_ucast_data_err")},
-	{STAT_INFO(0x80e, "tx_mcast_ctrl_err")},
-	{STAT_INFO(0x810, "tx_bcast_ctrl_err")},
-	{STAT_INFO(0x812, "tx_ucast_ctrl_err")},
-	{STAT_INFO(0x814, "tx_pause_err")},
-	{STAT_INFO(0x816, "tx_64b")},
-	{STAT_INFO(0x818, "tx_65to127b")},
-	{STAT_INFO(0x81a, "tx_128to255b")},
-	{STAT_INFO(0x81c, "tx_256to511b")},
-	{STAT_INFO(0x81e, "tx_512to1023b")},
-	{STAT_INFO(0x820, "tx_1024to1518b")},
-	{STAT_INFO(0x822, "tx_1519tomaxb")},
-	{STAT_INFO(0x824, "tx_oversize")},
-	{STAT_INFO(0x836, "tx_st")},
-	{STAT_INFO(0x826, "tx_mcast_data_ok")},
-	{STAT_INFO(0x828, "tx_bcast_data_ok")},
-	{STAT_INFO(0x82a, "tx_ucast_data_ok")},
-	{STAT_INFO(0x82c, "tx_mcast_ctrl_ok")},
-	{STAT_INFO(0x82e, "tx_bcast_ctrl_ok")},
-	{STAT_INFO(0x830, "tx_ucast_ctrl_ok")},
-	{STAT_INFO(0x832, "tx_pause")},
-	{STAT_INFO(0x860, "tx_payload_octets_ok")},
-	{STAT_INFO(0x862, "tx_frame_octets_ok")},
+	{HSSI_STAT_INFO(0x800, "tx_fragments")},
+	{HSSI_STAT_INFO(0x802, "tx_jabbers")},
+	{HSSI_STAT_INFO(0x804, "tx_crcerr")},
+	{HSSI_STAT_INFO(0x806, "tx_crcerr_sizeok")},
+	{HSSI_STAT_INFO(0x808, "tx_mcast_data_err")},
+	{HSSI_STAT_INFO(0x80a, "tx_bcast_data_err")},
+	{HSSI_STAT_INFO(0x80c, "tx_ucast_data_err")},
+	{HSSI_STAT_INFO(0x80e, "tx_mcast_ctrl_err")},
+	{HSSI_STAT_INFO(0x810, "tx_bcast_ctrl_err")},
+	{HSSI_STAT_INFO(0x812, "tx_ucast_ctrl_err")},
+	{HSSI_STAT_INFO(0x814, "tx_pause_err")},
+	{HSSI_STAT_INFO(0x816, "tx_64b")},
+	{HSSI_STAT_INFO(0x818, "tx_65to127b")},
+	{HSSI_STAT_INFO(0x81a, "tx_128to255b")},
+	{HSSI_STAT_INFO(0x81c, "tx_256to511b")},
+	{HSSI_STAT_INFO(0x81e, "tx_512to1023b")},
+	{HSSI_STAT_INFO(0x820, "tx_1024to1518b")},
+	{HSSI_STAT_INFO(0x822, "tx_1519tomaxb")},
+	{HSSI_STAT_INFO(0x824, "tx_oversize")},
+	{HSSI_STAT_INFO(0x836, "tx_st")},
+	{HSSI_STAT_INFO(0x826, "tx_mcast_data_ok")},
+	{HSSI_STAT_INFO(0x828, "tx_bcast_data_ok")},
+	{HSSI_STAT_INFO(0x82a, "tx_ucast_data_ok")},
+	{HSSI_STAT_INFO(0x82c, "tx_mcast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x82e, "tx_bcast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x830, "tx_ucast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x832, "tx_pause")},
+	{HSSI_STAT_INFO(0x860, "tx_payload_octets_ok")},
+	{HSSI_STAT_INFO(0x862, "tx_frame_octets_ok")},
 
 	/* rx statistics */
-	{STAT_INFO(0x900, "rx_fragments")},
-	{STAT_INFO(0x902, "rx_jabbers")},
-	{STAT_INFO(0x904, "rx_crcerr")},
-	{STAT_INFO(0x906, "rx_crcerr_sizeok")},
-	{STAT_INFO(0x908, "rx_mcast_data_err")},
-	{STAT_INFO(0x90a, "rx_bcast_data_err")},
-	{STAT_INFO(0x90c, "rx_ucast_data_err")},
-	{STAT_INFO(0x90e, "rx_mcast_ctrl_err")},
-	{STAT_INFO(0x910, "rx_bcast_ctrl_err")},
-	{STAT_INFO(0x912, "rx_ucast_ctrl_err")},
-	{STAT_INFO(0x914, "rx_pause_err")},
-	{STAT_INFO(0x916, "rx_64b")},
-	{STAT_INFO(0x918, "rx_65to127b")},
-	{STAT_INFO(0x91a, "rx_128to255b")},
-	{STAT_INFO(0x91c, "rx_256to511b")},
-	{STAT_INFO(0x91e, "rx_512to1023b")},
-	{STAT_INFO(0x920, "rx_1024to1518b")},
-	{STAT_INFO(0x922, "rx_1519tomaxb")},
-	{STAT_INFO(0x924, "rx_oversize")},
-	{STAT_INFO(0x936, "rx_st")},
-	{STAT_INFO(0x926, "rx_mcast_data_ok")},
-	{STAT_INFO(0x928, "rx_bcast_data_ok")},
-	{STAT_INFO(0x92a, "rx_ucast_data_ok")},
-	{STAT_INFO(0x92c, "rx_mcast_ctrl_ok")},
-	{STAT_INFO(0x92e, "rx_bcast_ctrl_ok")},
-	{STAT_INFO(0x930, "rx_ucast_ctrl_ok")},
-	{STAT_INFO(0x932, "rx_pause")},
-	{STAT_INFO(0x960, "rx_payload_octets_ok")},
-	{STAT_INFO(0x962, "rx_frame_octets_ok")}
+	{HSSI_STAT_INFO(0x900, "rx_fragments")},
+	{HSSI_STAT_INFO(0x902, "rx_jabbers")},
+	{HSSI_STAT_INFO(0x904, "rx_crcerr")},
+	{HSSI_STAT_INFO(0x906, "rx_crcerr_sizeok")},
+	{HSSI_STAT_INFO(0x908, "rx_mcast_data_err")},
+	{HSSI_STAT_INFO(0x90a, "rx_bcast_data_err")},
+	{HSSI_STAT_INFO(0x90c, "rx_ucast_data_err")},
+	{HSSI_STAT_INFO(0x90e, "rx_mcast_ctrl_err")},
+	{HSSI_STAT_INFO(0x910, "rx_bcast_ctrl_err")},
+	{HSSI_STAT_INFO(0x912, "rx_ucast_ctrl_err")},
+	{HSSI_STAT_INFO(0x914, "rx_pause_err")},
+	{HSSI_STAT_INFO(0x916, "rx_64b")},
+	{HSSI_STAT_INFO(0x918, "rx_65to127b")},
+	{HSSI_STAT_INFO(0x91a, "rx_128to255b")},
+	{HSSI_STAT_INFO(0x91c, "rx_256to511b")},
+	{HSSI_STAT_INFO(0x91e, "rx_512to1023b")},
+	{HSSI_STAT_INFO(0x920, "rx_1024to1518b")},
+	{HSSI_STAT_INFO(0x922, "rx_1519tomaxb")},
+	{HSSI_STAT_INFO(0x924, "rx_oversize")},
+	{HSSI_STAT_INFO(0x936, "rx_st")},
+	{HSSI_STAT_INFO(0x926, "rx_mcast_data_ok")},
+	{HSSI_STAT_INFO(0x928, "rx_bcast_data_ok")},
+	{HSSI_STAT_INFO(0x92a, "rx_ucast_data_ok")},
+	{HSSI_STAT_INFO(0x92c, "rx_mcast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x92e, "rx_bcast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x930, "rx_ucast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x932, "rx_pause")},
+	{HSSI_STAT_INFO(0x960, "rx_payload_octets_ok")},
+	{HSSI_STAT_INFO(0x962, "rx_frame_octets_ok")}
+};
+
+static const unsigned int std_100g[HSSI_STD_MAX] = {
+	[HSSI_STD_TX_UCAST]	= 0x82a,
+	[HSSI_STD_TX_MCAST]	= 0x826,
+	[HSSI_STD_TX_BCAST]	= 0x828,
+	[HSSI_STD_RX_UCAST]	= 0x92a,
+	[HSSI_STD_RX_MCAST]	= 0x926,
+	[HSSI_STD_RX_BCAST]	= 0x928,
+	[HSSI_STD_TX_OCTETS]	= 0x860,
+	[HSSI_STD_RX_OCTETS]	= 0x960,
+	[HSSI_STD_TX_PAUSE]	= 0x832,
+	[HSSI_STD_RX_PAUSE]	= 0x932,
+	[HSSI_STD_RX_CRC]	= 0x904,
+	[HSSI_STD_RX_OVERSIZE]	= 0x924,
+	[HSSI_STD_RX_FRAGMENTS]	= 0x900,
+	[HSSI_STD_RX_JABBERS]	= 0x902,
+	[HSSI_STD_TX_HIST + 0]	= 0x816,
+	[HSSI_STD_TX_HIST + 1]	= 0x818,
+	[HSSI_STD_TX_HIST + 2]	= 0x81a,
+	[HSSI_STD_TX_HIST + 3]	= 0x81c,
+	[HSSI_STD_TX_HIST + 4]	= 0x81e,
+	[HSSI_STD_TX_HIST + 5]	= 0x820,
+	[HSSI_STD_TX_HIST + 6]	= 0x822,
+	[HSSI_STD_RX_HIST + 0]	= 0x916,
+	[HSSI_STD_RX_HIST + 1]	= 0x918,
+	[HSSI_STD_RX_HIST + 2]	= 0x91a,
+	[HSSI_STD_RX_HIST + 3]	= 0x91c,
+	[HSSI_STD_RX_HIST + 4]	= 0x91e,
+	[HSSI_STD_RX_HIST + 5]	= 0x920,
+	[HSSI_STD_RX_HIST + 6]	= 0x922,
 };
 
 static const struct s10hssi_ops_params intel_ll_100g_params = {
-	.stats = stats_100g,
-	.num_stats = ARRAY_SIZE(stats_100g),
-	.tx_clr_off = ILL_100G_TX_STATS_CLR,
-	.rx_clr_off = ILL_100G_RX_STATS_CLR,
+	.stats = {
+		.info = stats_100g,
+		.num = ARRAY_SIZE(stats_100g),
+		.std_addr = std_100g,
+		.latch = true,
+		.tx_clr_off = ILL_100G_TX_STATS_CLR,
+		.rx_clr_off = ILL_100G_RX_STATS_CLR,
+	},
 	.lpbk_off = ILL_100G_LPBK_OFF,
 	.lpbk_en_val = ILL_100G_LPBK_EN_VAL,
 };
@@ -496,9 +694,11 @@ static int s10hssi_mac_probe(struct dfl_device *dfl_dev)
 	if (!base)
 		return -ENOMEM;
 
-	priv->netdev = alloc_netdev(sizeof(struct s10hssi_netdata),
-				    "s10hssi%d", NET_NAME_UNKNOWN,
-				    s10hssi_init_netdev);
+	priv->netdev = alloc_netdev_mqs(sizeof(struct s10hssi_netdata),
+					"s10hssi%d", NET_NAME_UNKNOWN,
+					s10hssi_init_netdev,
+					max(n5010_dp_queues(), 1U),
+					max(n5010_dp_queues(), 1U));
 
 	if (!priv->netdev)
 		return -ENOMEM;
@@ -506,6 +706,7 @@ static int s10hssi_mac_probe(struct dfl_device *dfl_dev)
 	npriv = netdev_priv(priv->netdev);
 
 	npriv->dfl_dev = dfl_dev;
+	mutex_init(&npriv->link_lock);
 
 	val = readq(base + CAPABILITY_OFF);
 
@@ -555,6 +756,20 @@ static int s10hssi_mac_probe(struct dfl_device *dfl_dev)
 
 	npriv->regmap = regmap;
 
+	npriv->stats = devm_hssi_stats_init(dev, regmap,
+					    &npriv->ops_params->stats);
+	if (!npriv->stats)
+		return -ENOMEM;
+
+	if (n5010_dp_queues()) {
+		npriv->dp = n5010_dp_create(dev, priv->netdev);
+		if (!npriv->dp)
+			return -ENOMEM;
+
+		/* stop/wake and BQL need a qdisc in front of the rings */
+		priv->netdev->priv_flags &= ~IFF_NO_QUEUE;
+	}
+
 	SET_NETDEV_DEV(priv->netdev, &dfl_dev->dev);
 
 	flags = ETH_RESET_MGMT;
@@ -565,18 +780,18 @@ static int s10hssi_mac_probe(struct dfl_device *dfl_dev)
 		dev_err(&dfl_dev->dev, "failed to reset MGMT %s: %d",
 			priv->netdev->name, ret);
 
-	ret = register_netdev(priv->netdev);
-
-	if (ret)
-		dev_err(&dfl_dev->dev, "failed to register %s: %d",
-			priv->netdev->name, ret);
+	INIT_DELAYED_WORK(&priv->poll_work, poll_work);
 
 	dev_info(&dfl_dev->dev, "setting carrier off\n");
 	netif_carrier_off(priv->netdev);
 
-	INIT_WORK(&priv->poll_workq, poll_work);
-	timer_setup(&priv->poll_timer, poll_timerf, 0);
-	mod_timer(&priv->poll_timer, jiffies + msecs_to_jiffies(1000));
+	ret = register_netdev(priv->netdev);
+
+	if (ret) {
+		dev_err(&dfl_dev->dev, "failed to register %s: %d",
+			priv->netdev->name, ret);
+		free_netdev(priv->netdev);
+	}
 
 	return ret;
 }
@@ -586,8 +801,6 @@ static void s10hssi_mac_remove(struct dfl_device *dfl_dev)
 	struct s10hssi_drvdata *priv = dev_get_drvdata(&dfl_dev->dev);
 
 	unregister_netdev(priv->netdev);
-
-	del_timer_sync(&priv->poll_timer);
 }
 
 #define FME_FEATURE_ID_LL_10G_MAC 0xf
@@ -0,0 +1,355 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Silicom(R) N5010 host datapath loopback model
+ *
+ * Copyright (C) 2020 Silicom Denmark A/S. All rights reserved.
+ *
+ * Multi-queue TX/RX rings with NAPI polling for the FPGA netdevs, so that
+ * the netdev side of a host datapath (PTP, LLDP, management traffic) can be
+ * exercised without the card.
+ *
+ * The FPGA images do not expose a DMA feature to the host, so the device
+ * side of each queue pair is a software model of a MAC in loopback: frames
+ * posted to a TX ring are "transmitted" by the NAPI poll, copied into a
+ * freshly allocated RX buffer on the RX ring of the same queue and
+ * completed. Everything else (ring accounting, BQL, queue stop/wake, GRO)
+ * is what a DMA backed queue would do. Nothing goes out on the wire, so
+ * this is for testing only and is not built unless asked for.
+ */
+
+#include <linux/device.h>
+#include <linux/etherdevice.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/n5010-dp.h>
+#include <linux/netdevice.h>
+#include <linux/skbuff.h>
+#include <linux/u64_stats_sync.h>
+#include <linux/version.h>
+
+#define N5010_DP_RING_MIN	64
+#define N5010_DP_RING_MAX	4096
+
+static unsigned int queues;
+module_param(queues, uint, 0444);
+MODULE_PARM_DESC(queues,
+		 "Number of loopback queue pairs per port, 0 for control plane only (default 0)");
+
+static unsigned int ring_size = 512;
+module_param(ring_size, uint, 0444);
+MODULE_PARM_DESC(ring_size, "Loopback ring size (default 512)");
+
+struct n5010_dp_ring {
+	struct sk_buff **skb;
+	unsigned int head;	/* producer, free running */
+	unsigned int tail;	/* consumer, free running */
+};
+
+struct n5010_dp_queue {
+	struct n5010_dp *dp;
+	struct napi_struct napi;
+	unsigned int index;
+	struct n5010_dp_ring tx;
+	struct n5010_dp_ring rx;
+
+	/* only updated from the NAPI poll */
+	struct u64_stats_sync syncp;
+	u64 tx_packets;
+	u64 tx_bytes;
+	u64 rx_packets;
+	u64 rx_bytes;
+	u64 rx_dropped;
+};
+
+struct n5010_dp {
+	struct net_device *netdev;
+	unsigned int nr_queues;
+	unsigned int ring_size;
+	unsigned int ring_mask;
+	struct n5010_dp_queue *queues;
+};
+
+static unsigned int n5010_dp_used(struct n5010_dp_ring *ring, unsigned int head)
+{
+	return head - READ_ONCE(ring->tail);
+}
+
+/* Device side of the model: send the frame out and receive it back */
+static void n5010_dp_loopback(struct n5010_dp_queue *q, struct sk_buff *skb)
+{
+	struct n5010_dp *dp = q->dp;
+	struct n5010_dp_ring *rx = &q->rx;
+	struct sk_buff *nskb = NULL;
+
+	if (rx->head - rx->tail < dp->ring_size)
+		nskb = napi_alloc_skb(&q->napi, skb->len);
+
+	if (!nskb) {
+		u64_stats_update_begin(&q->syncp);
+		q->rx_dropped++;
+		u64_stats_update_end(&q->syncp);
+		return;
+	}
+
+	skb_copy_bits(skb, 0, skb_put(nskb, skb->len), skb->len);
+	rx->skb[rx->head++ & dp->ring_mask] = nskb;
+}
+
+static void n5010_dp_clean_tx(struct n5010_dp_queue *q, int budget)
+{
+	struct n5010_dp *dp = q->dp;
+	struct netdev_queue *txq = netdev_get_tx_queue(dp->netdev, q->index);
+	struct n5010_dp_ring *tx = &q->tx;
+	unsigned int pkts = 0, bytes = 0;
+	unsigned int head, tail;
+	struct sk_buff *skb;
+
+	/* pairs with the release in n5010_dp_xmit() */
+	head = smp_load_acquire(&tx->head);
+
+	for (tail = tx->tail; tail != head; tail++) {
+		skb = tx->skb[tail & dp->ring_mask];
+		tx->skb[tail & dp->ring_mask] = NULL;
+
+		n5010_dp_loopback(q, skb);
+
+		pkts++;
+		bytes += skb->len;
+		napi_consume_skb(skb, budget);
+	}
+
+	if (!pkts)
+		return;
+
+	smp_store_release(&tx->tail, tail);
+	netdev_tx_completed_queue(txq, pkts, bytes);
+
+	u64_stats_update_begin(&q->syncp);
+	q->tx_packets += pkts;
+	q->tx_bytes += bytes;
+	u64_stats_update_end(&q->syncp);
+
+	/* pairs with the barrier in n5010_dp_xmit() */
+	smp_mb();
+	if (netif_tx_queue_stopped(txq) &&
+	    n5010_dp_used(tx, READ_ONCE(tx->head)) < dp->ring_size)
+		netif_tx_wake_queue(txq);
+}
+
+static int n5010_dp_clean_rx(struct n5010_dp_queue *q, int budget)
+{
+	struct n5010_dp *dp = q->dp;
+	struct n5010_dp_ring *rx = &q->rx;
+	unsigned int bytes = 0;
+	struct sk_buff *skb;
+	int done = 0;
+
+	while (done < budget && rx->tail != rx->head) {
+		skb = rx->skb[rx->tail & dp->ring_mask];
+		rx->skb[rx->tail++ & dp->ring_mask] = NULL;
+
+		bytes += skb->len;
+		skb->protocol = eth_type_trans(skb, dp->netdev);
+		skb_record_rx_queue(skb, q->index);
+		napi_gro_receive(&q->napi, skb);
+		done++;
+	}
+
+	u64_stats_update_begin(&q->syncp);
+	q->rx_packets += done;
+	q->rx_bytes += bytes;
+	u64_stats_update_end(&q->syncp);
+
+	return done;
+}
+
+static bool n5010_dp_pending(struct n5010_dp_queue *q)
+{
+	return q->rx.tail != q->rx.head ||
+	       smp_load_acquire(&q->tx.head) != q->tx.tail;
+}
+
+static int n5010_dp_poll(struct napi_struct *napi, int budget)
+{
+	struct n5010_dp_queue *q = container_of(napi, struct n5010_dp_queue,
+						napi);
+	int done;
+
+	n5010_dp_clean_tx(q, budget);
+	done = n5010_dp_clean_rx(q, budget);
+
+	/*
+	 * A doorbell rung while we were still scheduled was lost, this is
+	 * where a DMA queue would unmask its interrupt and re-check.
+	 */
+	if (done < budget && napi_complete_done(napi, done) &&
+	    n5010_dp_pending(q))
+		napi_schedule(napi);
+
+	return done;
+}
+
+netdev_tx_t n5010_dp_xmit(struct n5010_dp *dp, struct sk_buff *skb)
+{
+	unsigned int qid = skb_get_queue_mapping(skb);
+	struct n5010_dp_queue *q = &dp->queues[qid];
+	struct netdev_queue *txq = netdev_get_tx_queue(dp->netdev, qid);
+	struct n5010_dp_ring *tx = &q->tx;
+	unsigned int head = tx->head;
+
+	if (unlikely(n5010_dp_used(tx, head) >= dp->ring_size)) {
+		netif_tx_stop_queue(txq);
+		return NETDEV_TX_BUSY;
+	}
+
+	skb_tx_timestamp(skb);
+	netdev_tx_sent_queue(txq, skb->len);
+
+	tx->skb[head & dp->ring_mask] = skb;
+	/* publish the slot before ringing the doorbell */
+	smp_store_release(&tx->head, ++head);
+
+	if (n5010_dp_used(tx, head) >= dp->ring_size) {
+		netif_tx_stop_queue(txq);
+		/* pairs with the barrier in n5010_dp_clean_tx() */
+		smp_mb();
+		if (n5010_dp_used(tx, head) < dp->ring_size)
+			netif_tx_start_queue(txq);
+	}
+
+	napi_schedule(&q->napi);
+
+	return NETDEV_TX_OK;
+}
+EXPORT_SYMBOL(n5010_dp_xmit);
+
+static void n5010_dp_drain(struct n5010_dp_ring *ring, unsigned int mask)
+{
+	for (; ring->tail != ring->head; ring->tail++) {
+		dev_kfree_skb_any(ring->skb[ring->tail & mask]);
+		ring->skb[ring->tail & mask] = NULL;
+	}
+
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+int n5010_dp_open(struct n5010_dp *dp)
+{
+	unsigned int i;
+
+	for (i = 0; i < dp->nr_queues; i++)
+		napi_enable(&dp->queues[i].napi);
+
+	netif_tx_start_all_queues(dp->netdev);
+
+	return 0;
+}
+EXPORT_SYMBOL(n5010_dp_open);
+
+void n5010_dp_stop(struct n5010_dp *dp)
+{
+	struct n5010_dp_queue *q;
+	unsigned int i;
+
+	netif_tx_disable(dp->netdev);
+
+	for (i = 0; i < dp->nr_queues; i++) {
+		q = &dp->queues[i];
+
+		napi_disable(&q->napi);
+		n5010_dp_drain(&q->tx, dp->ring_mask);
+		n5010_dp_drain(&q->rx, dp->ring_mask);
+		netdev_tx_reset_queue(netdev_get_tx_queue(dp->netdev, i));
+	}
+}
+EXPORT_SYMBOL(n5010_dp_stop);
+
+void n5010_dp_get_stats64(struct n5010_dp *dp,
+			  struct rtnl_link_stats64 *stats)
+{
+	u64 tx_packets, tx_bytes, rx_packets, rx_bytes, rx_dropped;
+	struct n5010_dp_queue *q;
+	unsigned int i, start;
+
+	for (i = 0; i < dp->nr_queues; i++) {
+		q = &dp->queues[i];
+
+		do {
+			start = u64_stats_fetch_begin(&q->syncp);
+			tx_packets = q->tx_packets;
+			tx_bytes = q->tx_bytes;
+			rx_packets = q->rx_packets;
+			rx_bytes = q->rx_bytes;
+			rx_dropped = q->rx_dropped;
+		} while (u64_stats_fetch_retry(&q->syncp, start));
+
+		stats->tx_packets += tx_packets;
+		stats->tx_bytes += tx_bytes;
+		stats->rx_packets += rx_packets;
+		stats->rx_bytes += rx_bytes;
+		stats->rx_dropped += rx_dropped;
+	}
+}
+EXPORT_SYMBOL(n5010_dp_get_stats64);
+
+/* Number of TX/RX queues the netdevs should be allocated with, 0 if none */
+unsigned int n5010_dp_queues(void)
+{
+	return queues;
+}
+EXPORT_SYMBOL(n5010_dp_queues);
+
+/*
+ * Set up one queue pair per TX queue of the netdev. Must be called before
+ * register_netdev(); the NAPI instances are removed by free_netdev().
+ */
+struct n5010_dp *n5010_dp_create(struct device *dev, struct net_device *netdev)
+{
+	struct n5010_dp_queue *q;
+	struct n5010_dp *dp;
+	unsigned int i;
+
+	dp = devm_kzalloc(dev, sizeof(*dp), GFP_KERNEL);
+	if (!dp)
+		return NULL;
+
+	dp->netdev = netdev;
+	dp->nr_queues = netdev->real_num_tx_queues;
+	dp->ring_size = roundup_pow_of_two(clamp_t(unsigned int, ring_size,
+						   N5010_DP_RING_MIN,
+						   N5010_DP_RING_MAX));
+	dp->ring_mask = dp->ring_size - 1;
+
+	dp->queues = devm_kcalloc(dev, dp->nr_queues, sizeof(*dp->queues),
+				  GFP_KERNEL);
+	if (!dp->queues)
+		return NULL;
+
+	for (i = 0; i < dp->nr_queues; i++) {
+		q = &dp->queues[i];
+		q->dp = dp;
+		q->index = i;
+
+		q->tx.skb = devm_kcalloc(dev, dp->ring_size, sizeof(*q->tx.skb),
+					 GFP_KERNEL);
+		q->rx.skb = devm_kcalloc(dev, dp->ring_size, sizeof(*q->rx.skb),
+					 GFP_KERNEL);
+		if (!q->tx.skb || !q->rx.skb)
+			return NULL;
+
+		u64_stats_init(&q->syncp);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 1, 0)
+		netif_napi_add(netdev, &q->napi, n5010_dp_poll);
+#else
+		netif_napi_add(netdev, &q->napi, n5010_dp_poll,
+			       NAPI_POLL_WEIGHT);
+#endif
+	}
+
+	return dp;
+}
+EXPORT_SYMBOL(n5010_dp_create);
+
+MODULE_DESCRIPTION("Host datapath loopback model for Silicom PAC N5010 (testing only)");
+MODULE_AUTHOR("Silicom Denmark A/S");
+MODULE_LICENSE("GPL v2");
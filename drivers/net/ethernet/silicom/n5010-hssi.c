@@ -9,15 +9,20 @@
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
 #include <linux/dfl.h>
+#include <linux/hssi-stats.h>
 #include <linux/io-64-nonatomic-lo-hi.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/n5010-dp.h>
 #include <linux/netdevice.h>
 #include <linux/phy.h>
 #include <linux/regmap.h>
 #include <linux/spi/spi.h>
 #include <linux/timer.h>
 #include <linux/uaccess.h>
+#include <linux/version.h>
+#include <linux/workqueue.h>
 
 #include "n5010-phy.h"
 
@@ -62,10 +67,7 @@
 #define STATS_CLR_INT_TIMEOUT_US	1000
 
 struct n5010_hssi_ops_params {
-	struct stat_info *stats;
-	u32 num_stats;
-	u32 tx_clr_off;
-	u32 rx_clr_off;
+	struct hssi_stats_params stats;
 };
 
 struct n5010_hssi_regmaps {
@@ -78,12 +80,22 @@ struct n5010_hssi_netdata {
 	struct regmap *regmap_phy;
 	u32 link_status;
 	const struct n5010_hssi_ops_params *ops_params;
+	struct hssi_stats *stats;
+	struct n5010_dp *dp;
+};
+
+struct n5010_hssi_port_init {
+	struct work_struct work;
+	struct n5010_hssi_drvdata *priv;
+	u64 port;
 };
 
 struct n5010_hssi_drvdata {
 	struct dfl_device *dfl_dev;
 	void __iomem *base;
 	u64  port_cnt;
+	struct device *phy_dev;
+	struct n5010_hssi_port_init *init;
 	struct net_device *netdev[];
 };
 
@@ -99,6 +111,15 @@ static bool n5010_hssi_update_link(struct net_device *netdev)
 
 static int netdev_open(struct net_device *netdev)
 {
+	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
+	int ret;
+
+	if (npriv->dp) {
+		ret = n5010_dp_open(npriv->dp);
+		if (ret)
+			return ret;
+	}
+
 	if (netdev->phydev)
 		phy_start(netdev->phydev);
 
@@ -107,9 +128,14 @@ static int netdev_open(struct net_device *netdev)
 
 static int netdev_stop(struct net_device *netdev)
 {
+	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
+
 	if (netdev->phydev)
 		phy_stop(netdev->phydev);
 
+	if (npriv->dp)
+		n5010_dp_stop(npriv->dp);
+
 	return 0;
 }
 
@@ -163,11 +189,46 @@ static int netdev_set_mac_address(struct net_device *netdev, void *p)
 
 static netdev_tx_t netdev_xmit(struct sk_buff *skb, struct net_device *netdev)
 {
+	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
+
+	if (npriv->dp)
+		return n5010_dp_xmit(npriv->dp, skb);
+
 	kfree_skb(skb);
 
 	return NETDEV_TX_OK;
 }
 
+static void netdev_get_stats64(struct net_device *netdev,
+			       struct rtnl_link_stats64 *stats)
+{
+	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
+
+	hssi_stats_get_stats64(npriv->stats, stats);
+
+	/*
+	 * The MAC also counts the AFU traffic, with a host datapath the
+	 * packet and byte counters come from the host queues instead.
+	 */
+	if (npriv->dp) {
+		stats->tx_packets = 0;
+		stats->tx_bytes = 0;
+		stats->rx_packets = 0;
+		stats->rx_bytes = 0;
+		n5010_dp_get_stats64(npriv->dp, stats);
+	}
+}
+
+static int netdev_get_phys_port_name(struct net_device *netdev, char *name,
+				     size_t len)
+{
+	/* netdevs take the first free %d name, this one is stable */
+	if (snprintf(name, len, "p%u", netdev->dev_port) >= len)
+		return -EINVAL;
+
+	return 0;
+}
+
 static const struct net_device_ops netdev_ops = {
 	.ndo_open = netdev_open,
 	.ndo_stop = netdev_stop,
@@ -175,28 +236,22 @@ static const struct net_device_ops netdev_ops = {
 	.ndo_change_mtu = netdev_change_mtu,
 	.ndo_set_features = netdev_set_features,
 	.ndo_set_mac_address = netdev_set_mac_address,
+	.ndo_get_stats64 = netdev_get_stats64,
+	.ndo_get_phys_port_name = netdev_get_phys_port_name,
 };
 
-struct stat_info {
-	unsigned int addr;
-	char string[ETH_GSTRING_LEN];
-};
-
-#define STAT_INFO(_addr, _string) \
-	.addr = _addr, .string = _string,
-
 static void ethtool_get_strings(struct net_device *netdev, u32 stringset,
 				u8 *s)
 {
 	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
 	unsigned int i, stats_num = 0;
-	struct stat_info *stat;
+	const struct hssi_stat_info *stat;
 
 	if (stringset != ETH_SS_STATS)
 		return;
 
-	stat = npriv->ops_params->stats;
-	stats_num = npriv->ops_params->num_stats;
+	stat = npriv->ops_params->stats.info;
+	stats_num = npriv->ops_params->stats.num;
 
 	for (i = 0; i < stats_num; i++, s += ETH_GSTRING_LEN)
 		memcpy(s, stat[i].string, ETH_GSTRING_LEN);
@@ -207,81 +262,107 @@ static int ethtool_get_sset_count(struct net_device *netdev, int stringset)
 	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
 
 	if (stringset == ETH_SS_STATS)
-		return npriv->ops_params->num_stats;
+		return npriv->ops_params->stats.num;
 
 	return 0;
 }
 
-static u64 read_mac_stat(struct regmap *regmap, unsigned int addr)
+static int ethtool_clear_stats(struct net_device *netdev,
+			       struct regmap *regmap)
 {
-	u32 data_l, data_h;
+	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
+	u32 reg, val;
+	int ret;
 
-	regmap_read(regmap, addr, &data_l);
-	regmap_read(regmap, addr + 1, &data_h);
+	reg = npriv->ops_params->stats.tx_clr_off;
+
+	ret = regmap_write(regmap, reg, 1);
+	if (ret)
+		return ret;
+
+	ret = regmap_write(regmap, reg, 0);
+	if (ret)
+		return ret;
+
+	ret = regmap_read_poll_timeout(regmap, reg, val, (val & 1) == 0,
+				       STATS_CLR_INT_US,
+				       STATS_CLR_INT_TIMEOUT_US);
+	if (ret) {
+		dev_err(&netdev->dev, "failed to clear tx stats\n");
+		return ret;
+	}
 
-	return data_l + ((u64)data_h << 32);
+	reg = npriv->ops_params->stats.rx_clr_off;
+
+	ret = regmap_write(regmap, reg, 1);
+	if (ret)
+		return ret;
+
+	ret = regmap_write(regmap, reg, 0);
+	if (ret)
+		return ret;
+
+	ret = regmap_read_poll_timeout(regmap, reg, val, (val & 1) == 0,
+				       STATS_CLR_INT_US,
+				       STATS_CLR_INT_TIMEOUT_US);
+	if (ret)
+		dev_err(&netdev->dev, "failed to clear rx stats\n");
+
+	return ret;
 }
 
 static int ethtool_reset(struct net_device *netdev, u32 *flags)
 {
 	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
-	struct regmap *regmap = npriv->regmap_mac;
-	u32 reg, val;
 	int ret;
 
 	if (*flags | ETH_RESET_MGMT) {
-		reg = npriv->ops_params->tx_clr_off;
-
-		ret = regmap_write(regmap, reg, 1);
+		hssi_stats_lock(npriv->stats);
+		ret = ethtool_clear_stats(netdev, npriv->regmap_mac);
+		hssi_stats_unlock(npriv->stats);
 		if (ret)
 			return ret;
 
-		ret = regmap_write(regmap, reg, 0);
-		if (ret)
-			return ret;
+		*flags &= ~ETH_RESET_MGMT;
+	}
 
-		ret = regmap_read_poll_timeout(regmap, reg, val, (val & 1) == 0,
-					       STATS_CLR_INT_US,
-					       STATS_CLR_INT_TIMEOUT_US);
-		if (ret) {
-			dev_err(&netdev->dev, "failed to clear tx stats\n");
-			return ret;
-		}
+	return 0;
+}
 
-		reg = npriv->ops_params->rx_clr_off;
+static void ethtool_get_stats(struct net_device *netdev,
+			      struct ethtool_stats *stats, u64 *data)
+{
+	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
 
-		ret = regmap_write(regmap, reg, 1);
-		if (ret)
-			return ret;
+	hssi_stats_read(npriv->stats, data);
+}
 
-		ret = regmap_write(regmap, reg, 0);
-		if (ret)
-			return ret;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+static void ethtool_get_pause_stats(struct net_device *netdev,
+				    struct ethtool_pause_stats *pause_stats)
+{
+	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
 
-		ret = regmap_read_poll_timeout(regmap, reg, val, (val & 1) == 0,
-					       STATS_CLR_INT_US,
-					       STATS_CLR_INT_TIMEOUT_US);
-		if (ret) {
-			dev_err(&netdev->dev, "failed to clear rx stats\n");
-			return ret;
-		}
+	hssi_stats_get_pause_stats(npriv->stats, pause_stats);
+}
 
-		*flags &= ~ETH_RESET_MGMT;
-	}
+static void ethtool_get_eth_mac_stats(struct net_device *netdev,
+				      struct ethtool_eth_mac_stats *mac_stats)
+{
+	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
 
-	return 0;
+	hssi_stats_get_eth_mac_stats(npriv->stats, mac_stats);
 }
 
-static void ethtool_get_stats(struct net_device *netdev,
-			      struct ethtool_stats *stats, u64 *data)
+static void ethtool_get_rmon_stats(struct net_device *netdev,
+				   struct ethtool_rmon_stats *rmon_stats,
+				   const struct ethtool_rmon_hist_range **ranges)
 {
 	struct n5010_hssi_netdata *npriv = netdev_priv(netdev);
-	unsigned int i, stats_num = npriv->ops_params->num_stats;
-	struct stat_info *stat = npriv->ops_params->stats;
 
-	for (i = 0; i < stats_num; i++)
-		data[i] = read_mac_stat(npriv->regmap_mac, stat[i].addr);
+	hssi_stats_get_rmon_stats(npriv->stats, rmon_stats, ranges);
 }
+#endif
 
 static int ethtool_module_info(struct net_device *netdev,
 			       struct ethtool_modinfo *modinfo)
@@ -293,80 +374,120 @@ static const struct ethtool_ops ethtool_ops = {
 	.get_strings = ethtool_get_strings,
 	.get_sset_count = ethtool_get_sset_count,
 	.get_ethtool_stats = ethtool_get_stats,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+	.get_pause_stats = ethtool_get_pause_stats,
+	.get_eth_mac_stats = ethtool_get_eth_mac_stats,
+	.get_rmon_stats = ethtool_get_rmon_stats,
+#endif
 	.get_link = ethtool_op_get_link,
 	.get_module_info = ethtool_module_info,
 	.reset = ethtool_reset,
 };
 
-static struct stat_info stats_100g[] = {
+static const struct hssi_stat_info stats_100g[] = {
 	/* tx statistics */
-	{STAT_INFO(0x800, "tx_fragments")},
-	{STAT_INFO(0x802, "tx_jabbers")},
-	{STAT_INFO(0x804, "tx_crcerr")},
-	{STAT_INFO(0x806, "tx_crcerr_sizeok")},
-	{STAT_INFO(0x808, "tx_mcast_data_err")},
-	{STAT_INFO(0x80a, "tx_bcast_data_err")},
-	{STAT_INFO(0x80c, "tx_ucast_data_err")},
-	{STAT_INFO(0x80e, "tx_mcast_ctrl_err")},
-	{STAT_INFO(0x810, "tx_bcast_ctrl_err")},
-	{STAT_INFO(0x812, "tx_ucast_ctrl_err")},
-	{STAT_INFO(0x814, "tx_pause_err")},
-	{STAT_INFO(0x816, "tx_64b")},
-	{STAT_INFO(0x818, "tx_65to127b")},
-	{STAT_INFO(0x81a, "tx_128to255b")},
-	{STAT_INFO(0x81c, "tx_256to511b")},
-	{STAT_INFO(0x81e, "tx_512to1023b")},
-	{STAT_INFO(0x820, "tx_1024to1518b")},
-	{STAT_INFO(0x822, "tx_1519tomaxb")},
-	{STAT_INFO(0x824, "tx_oversize")},
-	{STAT_INFO(0x836, "tx_st")},
-	{STAT_INFO(0x826, "tx_mcast_data_ok")},
-	{STAT_INFO(0x828, "tx_bcast_data_ok")},
-	{STAT_INFO(0x82a, "tx_ucast_data_ok")},
-	{STAT_INFO(0x82c, "tx_mcast_ctrl_ok")},
-	{STAT_INFO(0x82e, "tx_bcast_ctrl_ok")},
-	{STAT_INFO(0x830, "tx_ucast_ctrl_ok")},
-	{STAT_INFO(0x832, "tx_pause")},
-	{STAT_INFO(0x860, "tx_payload_octets_ok")},
-	{STAT_INFO(0x862, "tx_frame_octets_ok")},
+	{HSSI_STAT_INFO(0x800, "tx_fragments")},
+	{HSSI_STAT_INFO(0x802, "tx_jabbers")},
+	{HSSI_STAT_INFO(0x804, "tx_crcerr")},
+	{HSSI_STAT_INFO(0x806, "tx_crcerr_sizeok")},
+	{HSSI_STAT_INFO(0x808, "tx_mcast_data_err")},
+	{HSSI_STAT_INFO(0x80a, "tx_bcast_data_err")},
+	{HSSI_STAT_INFO(0x80c, "tx_ucast_data_err")},
+	{HSSI_STAT_INFO(0x80e, "tx_mcast_ctrl_err")},
+	{HSSI_STAT_INFO(0x810, "tx_bcast_ctrl_err")},
+	{HSSI_STAT_INFO(0x812, "tx_ucast_ctrl_err")},
+	{HSSI_STAT_INFO(0x814, "tx_pause_err")},
+	{HSSI_STAT_INFO(0x816, "tx_64b")},
+	{HSSI_STAT_INFO(0x818, "tx_65to127b")},
+	{HSSI_STAT_INFO(0x81a, "tx_128to255b")},
+	{HSSI_STAT_INFO(0x81c, "tx_256to511b")},
+	{HSSI_STAT_INFO(0x81e, "tx_512to1023b")},
+	{HSSI_STAT_INFO(0x820, "tx_1024to1518b")},
+	{HSSI_STAT_INFO(0x822, "tx_1519tomaxb")},
+	{HSSI_STAT_INFO(0x824, "tx_oversize")},
+	{HSSI_STAT_INFO(0x836, "tx_st")},
+	{HSSI_STAT_INFO(0x826, "tx_mcast_data_ok")},
+	{HSSI_STAT_INFO(0x828, "tx_bcast_data_ok")},
+	{HSSI_STAT_INFO(0x82a, "tx_ucast_data_ok")},
+	{HSSI_STAT_INFO(0x82c, "tx_mcast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x82e, "tx_bcast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x830, "tx_ucast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x832, "tx_pause")},
+	{HSSI_STAT_INFO(0x860, "tx_payload_octets_ok")},
+	{HSSI_STAT_INFO(0x862, "tx_frame_octets_ok")},
 
 	/* rx statistics */
-	{STAT_INFO(0x900, "rx_fragments")},
-	{STAT_INFO(0x902, "rx_jabbers")},
-	{STAT_INFO(0x904, "rx_crcerr")},
-	{STAT_INFO(0x906, "rx_crcerr_sizeok")},
-	{STAT_INFO(0x908, "rx_mcast_data_err")},
-	{STAT_INFO(0x90a, "rx_bcast_data_err")},
-	{STAT_INFO(0x90c, "rx_ucast_data_err")},
-	{STAT_INFO(0x90e, "rx_mcast_ctrl_err")},
-	{STAT_INFO(0x910, "rx_bcast_ctrl_err")},
-	{STAT_INFO(0x912, "rx_ucast_ctrl_err")},
-	{STAT_INFO(0x914, "rx_pause_err")},
-	{STAT_INFO(0x916, "rx_64b")},
-	{STAT_INFO(0x918, "rx_65to127b")},
-	{STAT_INFO(0x91a, "rx_128to255b")},
-	{STAT_INFO(0x91c, "rx_256to511b")},
-	{STAT_INFO(0x91e, "rx_512to1023b")},
-	{STAT_INFO(0x920, "rx_1024to1518b")},
-	{STAT_INFO(0x922, "rx_1519tomaxb")},
-	{STAT_INFO(0x924, "rx_oversize")},
-	{STAT_INFO(0x936, "rx_st")},
-	{STAT_INFO(0x926, "rx_mcast_data_ok")},
-	{STAT_INFO(0x928, "rx_bcast_data_ok")},
-	{STAT_INFO(0x92a, "rx_ucast_data_ok")},
-	{STAT_INFO(0x92c, "rx_mcast_ctrl_ok")},
-	{STAT_INFO(0x92e, "rx_bcast_ctrl_ok")},
-	{STAT_INFO(0x930, "rx_ucast_ctrl_ok")},
-	{STAT_INFO(0x932, "rx_pause")},
-	{STAT_INFO(0x960, "rx_payload_octets_ok")},
-	{STAT_INFO(0x962, "rx_frame_octets_ok")},
+	{HSSI_STAT_INFO(0x900, "rx_fragments")},
+	{HSSI_STAT_INFO(0x902, "rx_jabbers")},
+	{HSSI_STAT_INFO(0x904, "rx_crcerr")},
+	{HSSI_STAT_INFO(0x906, "rx_crcerr_sizeok")},
+	{HSSI_STAT_INFO(0x908, "rx_mcast_data_err")},
+	{HSSI_STAT_INFO(0x90a, "rx_bcast_data_err")},
+	{HSSI_STAT_INFO(0x90c, "rx_ucast_data_err")},
+	{HSSI_STAT_INFO(0x90e, "rx_mcast_ctrl_err")},
+	{HSSI_STAT_INFO(0x910, "rx_bcast_ctrl_err")},
+	{HSSI_STAT_INFO(0x912, "rx_ucast_ctrl_err")},
+	{HSSI_STAT_INFO(0x914, "rx_pause_err")},
+	{HSSI_STAT_INFO(0x916, "rx_64b")},
+	{HSSI_STAT_INFO(0x918, "rx_65to127b")},
+	{HSSI_STAT_INFO(0x91a, "rx_128to255b")},
+	{HSSI_STAT_INFO(0x91c, "rx_256to511b")},
+	{HSSI_STAT_INFO(0x91e, "rx_512to1023b")},
+	{HSSI_STAT_INFO(0x920, "rx_1024to1518b")},
+	{HSSI_STAT_INFO(0x922, "rx_1519tomaxb")},
+	{HSSI_STAT_INFO(0x924, "rx_oversize")},
+	{HSSI_STAT_INFO(0x936, "rx_st")},
+	{HSSI_STAT_INFO(0x926, "rx_mcast_data_ok")},
+	{HSSI_STAT_INFO(0x928, "rx_bcast_data_ok")},
+	{HSSI_STAT_INFO(0x92a, "rx_ucast_data_ok")},
+	{HSSI_STAT_INFO(0x92c, "rx_mcast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x92e, "rx_bcast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x930, "rx_ucast_ctrl_ok")},
+	{HSSI_STAT_INFO(0x932, "rx_pause")},
+	{HSSI_STAT_INFO(0x960, "rx_payload_octets_ok")},
+	{HSSI_STAT_INFO(0x962, "rx_frame_octets_ok")},
+};
+
+static const unsigned int std_100g[HSSI_STD_MAX] = {
+	[HSSI_STD_TX_UCAST]	= 0x82a,
+	[HSSI_STD_TX_MCAST]	= 0x826,
+	[HSSI_STD_TX_BCAST]	= 0x828,
+	[HSSI_STD_RX_UCAST]	= 0x92a,
+	[HSSI_STD_RX_MCAST]	= 0x926,
+	[HSSI_STD_RX_BCAST]	= 0x928,
+	[HSSI_STD_TX_OCTETS]	= 0x860,
+	[HSSI_STD_RX_OCTETS]	= 0x960,
+	[HSSI_STD_TX_PAUSE]	= 0x832,
+	[HSSI_STD_RX_PAUSE]	= 0x932,
+	[HSSI_STD_RX_CRC]	= 0x904,
+	[HSSI_STD_RX_OVERSIZE]	= 0x924,
+	[HSSI_STD_RX_FRAGMENTS]	= 0x900,
+	[HSSI_STD_RX_JABBERS]	= 0x902,
+	[HSSI_STD_TX_HIST + 0]	= 0x816,
+	[HSSI_STD_TX_HIST + 1]	= 0x818,
+	[HSSI_STD_TX_HIST + 2]	= 0x81a,
+	[HSSI_STD_TX_HIST + 3]	= 0x81c,
+	[HSSI_STD_TX_HIST + 4]	= 0x81e,
+	[HSSI_STD_TX_HIST + 5]	= 0x820,
+	[HSSI_STD_TX_HIST + 6]	= 0x822,
+	[HSSI_STD_RX_HIST + 0]	= 0x916,
+	[HSSI_STD_RX_HIST + 1]	= 0x918,
+	[HSSI_STD_RX_HIST + 2]	= 0x91a,
+	[HSSI_STD_RX_HIST + 3]	= 0x91c,
+	[HSSI_STD_RX_HIST + 4]	= 0x91e,
+	[HSSI_STD_RX_HIST + 5]	= 0x920,
+	[HSSI_STD_RX_HIST + 6]	= 0x922,
 };
 
 static const struct n5010_hssi_ops_params n5010_100g_params = {
-	.stats = stats_100g,
-	.num_stats = ARRAY_SIZE(stats_100g),
-	.tx_clr_off = ILL_100G_TX_STATS_CLR,
-	.rx_clr_off = ILL_100G_RX_STATS_CLR,
+	.stats = {
+		.info = stats_100g,
+		.num = ARRAY_SIZE(stats_100g),
+		.std_addr = std_100g,
+		.latch = true,
+		.tx_clr_off = ILL_100G_TX_STATS_CLR,
+		.rx_clr_off = ILL_100G_RX_STATS_CLR,
+	},
 };
 
 static void n5010_hssi_init_netdev(struct net_device *netdev)
@@ -444,14 +565,25 @@ static int n5010_hssi_create_netdev(struct n5010_hssi_drvdata *priv,
 	int err = -ENOMEM;
 	u32 flags;
 
-	netdev = alloc_netdev(sizeof(struct n5010_hssi_netdata),
-			      "n5010_hssi%d", NET_NAME_UNKNOWN,
-			      n5010_hssi_init_netdev);
+	netdev = alloc_netdev_mqs(sizeof(struct n5010_hssi_netdata),
+				  "n5010_hssi%d", NET_NAME_UNKNOWN,
+				  n5010_hssi_init_netdev,
+				  max(n5010_dp_queues(), 1U),
+				  max(n5010_dp_queues(), 1U));
 	if (!netdev)
 		return -ENOMEM;
 
 	npriv = netdev_priv(netdev);
 
+	if (n5010_dp_queues()) {
+		npriv->dp = n5010_dp_create(dev, netdev);
+		if (!npriv->dp)
+			goto err_free_netdev;
+
+		/* stop/wake and BQL need a qdisc in front of the rings */
+		netdev->priv_flags &= ~IFF_NO_QUEUE;
+	}
+
 	npriv->regmap_mac = n5010_hssi_create_regmap(priv, port, regmap_mac);
 	if (!npriv->regmap_mac)
 		goto err_free_netdev;
@@ -466,7 +598,16 @@ static int n5010_hssi_create_netdev(struct n5010_hssi_drvdata *priv,
 
 	npriv->ops_params = &n5010_100g_params;
 
+	npriv->stats = devm_hssi_stats_init(dev, npriv->regmap_mac,
+					    &npriv->ops_params->stats);
+	if (!npriv->stats) {
+		err = -ENOMEM;
+		goto err_free_netdev;
+	}
+
 	SET_NETDEV_DEV(netdev, dev);
+	/* ports register in completion order, dev_port identifies them */
+	netdev->dev_port = port;
 
 	npriv->link_status = FEC_RX_STATUS_LINK_NO;
 
@@ -531,11 +672,35 @@ static int n5010_match_phy_master(struct device *dev, const void *data)
 	return dfl_dev_get_base_dev(to_dfl_dev(dev)) == base_dev;
 }
 
+/*
+ * Each port is brought up from its own work item and its netdev registered
+ * as soon as it is ready, instead of serializing the ports in probe.
+ */
+static void n5010_hssi_port_init_work(struct work_struct *work)
+{
+	struct n5010_hssi_port_init *init =
+		container_of(work, struct n5010_hssi_port_init, work);
+	struct n5010_hssi_drvdata *priv = init->priv;
+	struct device *dev = &priv->dfl_dev->dev;
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = n5010_hssi_create_netdev(priv, priv->phy_dev, init->port);
+	if (ret)
+		dev_err(dev, "port %llu init failed: %d\n", init->port, ret);
+	else
+		dev_info(dev, "port %llu initialized in %lld us\n", init->port,
+			 ktime_us_delta(ktime_get(), start));
+}
+
 static void n5010_hssi_remove(struct dfl_device *dfl_dev)
 {
 	struct n5010_hssi_drvdata *priv = dev_get_drvdata(&dfl_dev->dev);
 	u64 port;
 
+	for (port = 0; port < priv->port_cnt; port++)
+		flush_work(&priv->init[port].work);
+
 	for (port = 0; port < priv->port_cnt; port++) {
 		struct net_device *my_netdev = priv->netdev[port];
 		if (my_netdev) {
@@ -548,6 +713,8 @@ static void n5010_hssi_remove(struct dfl_device *dfl_dev)
 			unregister_netdev(my_netdev);
 		}
 	}
+
+	put_device(priv->phy_dev);
 }
 
 static int n5010_hssi_probe(struct dfl_device *dfl_dev)
@@ -593,21 +760,32 @@ static int n5010_hssi_probe(struct dfl_device *dfl_dev)
 		goto err_phy_dev;
 	}
 
+	priv->init = devm_kcalloc(dev, port_cnt, sizeof(*priv->init),
+				  GFP_KERNEL);
+	if (!priv->init) {
+		ret = -ENOMEM;
+		goto err_phy_dev;
+	}
+
 	dev_set_drvdata(dev, priv);
 
 	priv->dfl_dev = dfl_dev;
 	priv->port_cnt = port_cnt;
 	priv->base = base;
+	/* used by the port init works, released in n5010_hssi_remove() */
+	priv->phy_dev = phy_dev;
 
 	for (port = 0; port < priv->port_cnt; port++) {
-		ret = n5010_hssi_create_netdev(priv, phy_dev, port);
-		if (ret) {
-			// cleanup network interfaces already created
-			n5010_hssi_remove(dfl_dev);
-			break;
-		}
+		priv->init[port].priv = priv;
+		priv->init[port].port = port;
+		INIT_WORK(&priv->init[port].work, n5010_hssi_port_init_work);
+		queue_work(system_unbound_wq, &priv->init[port].work);
 	}
 
+	put_device(phy_master);
+
+	return 0;
+
 err_phy_dev:
 	put_device(phy_dev);
 err_phy_master:
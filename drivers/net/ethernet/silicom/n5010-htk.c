@@ -9,10 +9,14 @@
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
 #include <linux/dfl.h>
+#include <linux/jiffies.h>
 #include <linux/module.h>
+#include <linux/n5010-dp.h>
 #include <linux/netdevice.h>
 #include <linux/regmap.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
 
 #define CAPABILITY_OFFSET 0x08
 #define CAP_AVAILABLE_RATES GENMASK_ULL(7, 0)
@@ -40,6 +44,33 @@
 
 #define MAC_SET_TX_RX_PROMISC_ENABLE 0x6000533
 
+#define XCVR_CHANNELS 4
+#define XCVR_ALL_CHANNELS GENMASK(XCVR_CHANNELS - 1, 0)
+
+#define DRP_BATCH_MAX 32
+
+enum n5010_htk_drp_type {
+	DRP_OP_RD,
+	DRP_OP_WR,
+	DRP_OP_SET,
+};
+
+struct n5010_htk_drp_op {
+	enum n5010_htk_drp_type type;
+	u32 addr;
+	u32 val;
+	u32 *rdata;
+};
+
+/* DRP operations queued for one port, issued by n5010_htk_drp_run() */
+struct n5010_htk_drp {
+	struct net_device *netdev;
+	struct regmap *regmap;
+	unsigned int nr;
+	int err;
+	struct n5010_htk_drp_op ops[DRP_BATCH_MAX];
+};
+
 struct n5010_htk_ops_params {
 	struct stat_info *stats;
 	u32 num_stats;
@@ -51,24 +82,81 @@ struct n5010_htk_netdata {
 	struct regmap *regmap_mac;
 	u32 priv_flags;
 	const struct n5010_htk_ops_params *ops_params;
+	struct n5010_htk_drp drp;
+	struct n5010_dp *dp;
+};
+
+struct n5010_htk_port_init {
+	struct work_struct work;
+	struct n5010_htk_drvdata *priv;
+	u64 port;
 };
 
 struct n5010_htk_drvdata {
 	struct dfl_device *dfl_dev;
 	void __iomem *base;
 	u64 port_cnt;
+	struct n5010_htk_port_init *init;
 	struct net_device *netdev[];
 };
 
+static int netdev_open(struct net_device *netdev)
+{
+	struct n5010_htk_netdata *npriv = netdev_priv(netdev);
+
+	if (npriv->dp)
+		return n5010_dp_open(npriv->dp);
+
+	return 0;
+}
+
+static int netdev_stop(struct net_device *netdev)
+{
+	struct n5010_htk_netdata *npriv = netdev_priv(netdev);
+
+	if (npriv->dp)
+		n5010_dp_stop(npriv->dp);
+
+	return 0;
+}
+
 static netdev_tx_t netdev_xmit(struct sk_buff *skb, struct net_device *netdev)
 {
+	struct n5010_htk_netdata *npriv = netdev_priv(netdev);
+
+	if (npriv->dp)
+		return n5010_dp_xmit(npriv->dp, skb);
+
 	kfree_skb(skb);
 
 	return NETDEV_TX_OK;
 }
 
+static void netdev_get_stats64(struct net_device *netdev,
+			       struct rtnl_link_stats64 *stats)
+{
+	struct n5010_htk_netdata *npriv = netdev_priv(netdev);
+
+	if (npriv->dp)
+		n5010_dp_get_stats64(npriv->dp, stats);
+}
+
+static int netdev_get_phys_port_name(struct net_device *netdev, char *name,
+				     size_t len)
+{
+	/* netdevs take the first free %d name, this one is stable */
+	if (snprintf(name, len, "p%u", netdev->dev_port) >= len)
+		return -EINVAL;
+
+	return 0;
+}
+
 static const struct net_device_ops netdev_ops = {
+	.ndo_open = netdev_open,
+	.ndo_stop = netdev_stop,
 	.ndo_start_xmit = netdev_xmit,
+	.ndo_get_stats64 = netdev_get_stats64,
+	.ndo_get_phys_port_name = netdev_get_phys_port_name,
 };
 
 struct stat_info {
@@ -342,301 +430,316 @@ static struct regmap *n5010_htk_create_regmap(struct n5010_htk_drvdata *priv,
 #define DRP_WDATA_OFFSET XCVR_OFFSET + 0x18
 #define DRP_RDATA_OFFSET XCVR_OFFSET + 0x1C
 
-/*
- * "Wait for the DRP_RDY register in the DRP Control/Status Register (offset 0x10) to be set again to
- * indicate that the DRP write operation is complete. Check additional DRP_STATUS register bits (if
- * available) in DRP Control/Status Register (offset 0x10) to ensure that no error has occurred."
- * No DRP_STATUS available for this design as it targets E-tile.
- */
-#define WAIT_DRP_RDY(timeout_message) \
-timeout = 0; \
-drp_ready_status = 0; \
-for (;;) { \
-	regmap_read(regmap, DRP_OFFSET, &readdata); \
-	drp_ready_status = (readdata >> 4) & 0x1; /* Indicates that the previously requested DRP read/write */ \
-	/* operation is complete and a new DRP read/write operation can be initiated. */ \
-	if (drp_ready_status != 0) { \
-		break; \
-	} else { \
-		if (timeout > 0) { \
-			printk(timeout_message, readdata, timeout, xcvr_channel); \
-			return 0; \
-		} \
-		timeout++; \
-	} \
-}
+#define DRP_CTRL_ENABLE 0x4
+#define DRP_CTRL_READ 0x5
+#define DRP_CTRL_WRITE 0x7
+#define DRP_RDY BIT(4)
+#define DRP_RDY_TIMEOUT_US 1000
+#define DRP_CHANNEL_SHIFT 19
 
-/*
- * n5010_htk_drp_wr implements the DRP write Operation described in Hitek Systems
- * "Transceiver Wrapper User Guide" from May 10, 2021.
- * Section: "4.1 DRP Write Operation" (Comments in "" refers to the steps
- * described in that section of the document.)
- */
-static u32 n5010_htk_drp_wr(struct regmap *regmap, u32 drp_addr, u32 drp_data,
-			    u32 xcvr_channel)
+static int n5010_htk_drp_wait_rdy(struct n5010_htk_drp *drp)
 {
-	u32 readdata;
-	u32 drp_ready_status = 0;
-	u32 timeout = 0;
-
-	// "Set the DRP_ENABLE register in the DRP Control/Status Register (offset 0x10)"
-	// set DRP_ENABLE bit:
-	regmap_write(regmap, DRP_OFFSET, 0x4);
-	regmap_read(regmap, DRP_OFFSET, &readdata);
-
-	WAIT_DRP_RDY("n5010_htk: ERROR - Timeout. n5010_htk_drp_wr Prior to write operation. DRP_RDY is stuck low. readdata = 0x%x, timeout=%d, xcvr=%d\n")
-
-	// "Set the DRP_ADDR and DRP_WDATA register bits in DRP Address Register (offset 0x14) and DRP
-	//  Write Data Register (offset 0x18) to write to the required transceiver or PLL register."
-	regmap_write(regmap, DRP_ADDR_OFFSET, drp_addr + (xcvr_channel << 19));
-	regmap_write(regmap, DRP_WDATA_OFFSET, drp_data);
+	u32 val;
 
-	// "Set additional DRP_BLK_TYPE and DRP_BLK_NUM register bits (if available) in DRP Control/Status
-	//  Register (offset 0x10) to select between multiple DRP blocks if a combination of multiple
-	//  transceivers and PLLs."
-	// Not applicable for this design as it targets an E-tile.
+	return regmap_read_poll_timeout(drp->regmap, DRP_OFFSET, val,
+					val & DRP_RDY, 0, DRP_RDY_TIMEOUT_US);
+}
 
-	// "Set the DRP_REQ register to ‘1’ and DRP_WR_RDn register to ‘1’ in the DRP Control/Status Register
-	//  (offset 0x10) to initiate a DRP write operation."
-	regmap_write(regmap, DRP_OFFSET, 0x7);
+/* Issue one DRP request and return to DRP_ENABLE only, dropping DRP_REQ */
+static int n5010_htk_drp_req(struct n5010_htk_drp *drp, u32 ctrl)
+{
+	int ret;
 
-	WAIT_DRP_RDY("n5010_htk: ERROR - Timeout. n5010_htk_drp_wr After write operation. DRP_RDY is stuck low. readdata = 0x%x, timeout=%d, xcvr=%d\n")
+	ret = regmap_write(drp->regmap, DRP_OFFSET, ctrl);
+	if (!ret)
+		ret = n5010_htk_drp_wait_rdy(drp);
+	if (!ret)
+		ret = regmap_write(drp->regmap, DRP_OFFSET, DRP_CTRL_ENABLE);
 
-	// return DRP status
-	return drp_ready_status; // Success equals return: 1. (0 means timeout)
+	return ret;
 }
 
 /*
- * n5010_htk_drp_wr implements the DRP read Operation described in Hitek Systems
- * "Transceiver Wrapper User Guide" from May 10, 2021.
- * Section: "4.2 DRP Read Operation" (Comments in "" refers to the steps
- * described in that section of the document.)
+ * n5010_htk_drp_run issues the queued DRP operations back-to-back, using the
+ * DRP Read and Write Operations described in Hitek Systems "Transceiver
+ * Wrapper User Guide" from May 10, 2021, Sections "4.1" and "4.2".
+ *
+ * DRP_ENABLE is set and DRP_RDY polled once per batch; after that DRP_RDY is
+ * only polled for completion of each request. DRP_ADDR is only rewritten
+ * when it changes, so a read-modify-write costs one address write.
+ * DRP_BLK_TYPE/DRP_BLK_NUM and DRP_STATUS do not apply as this design
+ * targets E-tile.
  */
-static u32 n5010_htk_drp_rd(struct regmap *regmap, u32 drp_addr,
-			    u32 xcvr_channel)
+static int n5010_htk_drp_run(struct n5010_htk_drp *drp)
 {
-	u32 readdata;
-	u32 drp_ready_status;
-	u32 timeout;
+	struct regmap *regmap = drp->regmap;
+	struct n5010_htk_drp_op *op = NULL;
+	u32 addr = U32_MAX, rdata = 0;
+	unsigned int i;
+	int ret;
 
-	// "Set the DRP_ENABLE register in the DRP Control/Status Register (offset 0x10)"
-	// set DRP_ENABLE bit
-	regmap_write(regmap, DRP_OFFSET, 0x4);
+	if (!drp->nr || drp->err)
+		goto out;
 
-	WAIT_DRP_RDY("n5010_htk: ERROR - Timeout. n5010_htk_drp_rd Prior to read operation DRP_RDY is stuck low. readdata = 0x%x, timeout=%d, xcvr=%d\n")
+	ret = regmap_write(regmap, DRP_OFFSET, DRP_CTRL_ENABLE);
+	if (!ret)
+		ret = n5010_htk_drp_wait_rdy(drp);
 
-	// "Set the DRP_ADDR register bits in DRP Address Register (offset 0x14) to read from the required
-	//  transceiver or PLL register."
-	regmap_write(regmap, DRP_ADDR_OFFSET, drp_addr + (xcvr_channel << 19));
+	for (i = 0; i < drp->nr && !ret; i++) {
+		op = &drp->ops[i];
 
-	// "Set additional DRP_BLK_TYPE and DRP_BLK_NUM register bits (if available) in DRP Control/Status
-	//  Register (offset 0x10) to select between multiple DRP blocks if a combination of multiple
-	//  transceivers and PLLs."
-	// Not applicable for this design as it targets an E-tile.
+		if (op->addr != addr) {
+			ret = regmap_write(regmap, DRP_ADDR_OFFSET, op->addr);
+			addr = op->addr;
+		}
 
-	// "Set the DRP_REQ register to '1' and DRP_WR_RDn register to '0' in the DRP Control/Status Register
-	//  (offset 0x10) to initiate a DRP read operation."
-	regmap_write(regmap, DRP_OFFSET, 0x5);
+		if (!ret && op->type != DRP_OP_WR) {
+			ret = n5010_htk_drp_req(drp, DRP_CTRL_READ);
+			if (!ret)
+				ret = regmap_read(regmap, DRP_RDATA_OFFSET, &rdata);
+			if (!ret && op->rdata)
+				*op->rdata = rdata;
+		}
 
-	WAIT_DRP_RDY("n5010_htk: ERROR - Timeout. n5010_htk_drp_rd after read operation  DRP_RDY is stuck low. readdata = 0x%x, timeout=%d, xcvr=%d\n")
+		if (!ret && op->type != DRP_OP_RD) {
+			ret = regmap_write(regmap, DRP_WDATA_OFFSET,
+					   op->type == DRP_OP_SET ?
+					   rdata | op->val : op->val);
+			if (!ret)
+				ret = n5010_htk_drp_req(drp, DRP_CTRL_WRITE);
+		}
+	}
 
-	// "Read the DRP_RDATA register bits from DRP Read Data Register (offset 0x1C)."
-	regmap_read(regmap, DRP_RDATA_OFFSET, &readdata);
-	return readdata;
+	if (ret) {
+		netdev_err(drp->netdev, "DRP access to 0x%x failed: %d\n",
+			   op ? op->addr : 0, ret);
+		drp->err = ret;
+	}
+
+out:
+	drp->nr = 0;
+
+	return drp->err;
 }
 
-/*
- * n5010_htk_drp_rmw wraps read, modify, write,
- * including xcvr_channel and a debug message before and after write with step number.
-*/
-static void n5010_htk_drp_rmw(struct net_device *netdev, u32 drp_addr, u32 modifier, u32 xcvr_channel, u32 step)
+static void n5010_htk_drp_queue(struct n5010_htk_drp *drp,
+				enum n5010_htk_drp_type type, u32 ch,
+				u32 addr, u32 val, u32 *rdata)
 {
-	struct n5010_htk_netdata *npriv = netdev_priv(netdev);
-	struct regmap *regmap = npriv->regmap_mac;
-	u32 drp_rd = n5010_htk_drp_rd(regmap, drp_addr, xcvr_channel);
-	u32 drp_ret;
+	struct n5010_htk_drp_op *op;
+
+	if (drp->nr == ARRAY_SIZE(drp->ops))
+		n5010_htk_drp_run(drp);
 
-	//netdev_dbg(netdev, "HTKDEBUG: rmw.%u. pre ch: %d read = 0x%x", step, xcvr_channel, drp_rd);
-	drp_ret = n5010_htk_drp_wr(regmap, drp_addr, drp_rd | modifier, xcvr_channel);
-	drp_rd  = n5010_htk_drp_rd(regmap, drp_addr, xcvr_channel);
-	//netdev_dbg(netdev, "HTKDEBUG: rmw.%u. post ch: %d read = 0x%x write return = 0x%x", step, xcvr_channel, drp_rd, drp_ret);
+	op = &drp->ops[drp->nr++];
+	op->type = type;
+	op->addr = addr + (ch << DRP_CHANNEL_SHIFT);
+	op->val = val;
+	op->rdata = rdata;
+}
+
+static void n5010_htk_drp_wr(struct n5010_htk_drp *drp, u32 ch, u32 addr,
+			     u32 val)
+{
+	n5010_htk_drp_queue(drp, DRP_OP_WR, ch, addr, val, NULL);
+}
+
+static void n5010_htk_drp_rd(struct n5010_htk_drp *drp, u32 ch, u32 addr,
+			     u32 *rdata)
+{
+	n5010_htk_drp_queue(drp, DRP_OP_RD, ch, addr, 0, rdata);
+}
+
+/* read-modify-write setting the bits in mask, without a verification read */
+static void n5010_htk_drp_set(struct n5010_htk_drp *drp, u32 ch, u32 addr,
+			      u32 mask)
+{
+	n5010_htk_drp_queue(drp, DRP_OP_SET, ch, addr, mask, NULL);
 }
 
 /*
- * n5010_htk_pma_choose_config requests PMA configurationload load
- * and waits until ??. This is only performed on channel 0.
+ * n5010_htk_pma_choose_config requests PMA configuration load
+ * and waits until it is loaded. This is only performed on channel 0.
  */
 static void n5010_htk_pma_choose_config(struct net_device *netdev, u32 step)
 {
 	struct n5010_htk_netdata *npriv = netdev_priv(netdev);
-	struct regmap *regmap = npriv->regmap_mac;
+	struct n5010_htk_drp *drp = &npriv->drp;
+	u32 drp_rd = 0;
+	u32 timeout;
 
-	u32 drp_rd;
-	u32 timeout = 0;
-	n5010_htk_drp_wr(regmap, 0x40143 /*Request PMA configuration load*/,
-			0x80 /* Load PMA config 0l*/, 0 );
-	do {
-		drp_rd = n5010_htk_drp_rd(regmap, 0x40144 /*PMA Configuration Loading Status*/, 0);
-		//netdev_dbg(netdev, "HTKDEBUG: %u. PMA configuration load status returns:: 0x%x", step, drp_rd);
-		drp_rd = (drp_rd & 0x1);
-		//netdev_dbg(netdev, "HTKDEBUG: %u. PMA configuration load status returns:: 0x%x", step, drp_rd);
-		timeout++;
-		if (timeout >= 1024) {
-		   netdev_info(netdev, "HTKDEBUG: %u. ERROR. Timeout while waiting for  0x40144[0] = 1.", step);
-		   break;
-		}
-	} while (drp_rd != 1);
+	n5010_htk_drp_wr(drp, 0, 0x40143 /*Request PMA configuration load*/,
+			 0x80 /* Load PMA config 0l*/);
+
+	for (timeout = 0; timeout < 1024; timeout++) {
+		n5010_htk_drp_rd(drp, 0, 0x40144 /*PMA Configuration Loading Status*/,
+				 &drp_rd);
+		if (n5010_htk_drp_run(drp))
+			return;
+		if (drp_rd & 0x1)
+			return;
+	}
+
+	netdev_info(netdev, "HTKDEBUG: %u. ERROR. Timeout while waiting for  0x40144[0] = 1.", step);
 }
 
 /*
- * n5010_htk_load_pma_config_params loads params_code into registers
- * and waits until pma_done.
+ * n5010_htk_load_pma_config_params loads params_code into the PMA registers
+ * of every channel and waits until pma_done on all of them, so the channels
+ * process the operation in parallel.
  */
-static u32 n5010_htk_load_pma_config_params(struct net_device *netdev,
-					     u32 xcvr_channel, u32 params_code)
+static int n5010_htk_load_pma_config_params(struct net_device *netdev,
+					    u32 params_code)
 {
 	struct n5010_htk_netdata *npriv = netdev_priv(netdev);
-	struct regmap *regmap = npriv->regmap_mac;
-	u32 ret;
-	u32 pma_done = 0;
-	u32 timeout = 0;
-	ret = n5010_htk_drp_wr(regmap, 0x200 /*PMA register 0*/,
-			       (params_code >> 0) & 0xFF /* PMA register data*/,
-			       xcvr_channel);
-	ret = n5010_htk_drp_wr(regmap, 0x201 /*PMA register 1*/,
-			       (params_code >> 8) & 0xFF /* PMA register data*/,
-			       xcvr_channel);
-	ret = n5010_htk_drp_wr(regmap, 0x202 /*PMA register 2*/,
-			       (params_code >> 16) &
-				       0xFF /* PMA register data*/,
-			       xcvr_channel);
-	ret = n5010_htk_drp_wr(regmap, 0x203 /*PMA register 3*/,
-			       (params_code >> 24) &
-				       0xFF /* PMA register data*/,
-			       xcvr_channel);
-
-	do {
-		u32 val_0x207 = n5010_htk_drp_rd(regmap, 0x207 /*PMA operation status*/,
-				       xcvr_channel);
-		pma_done = ((val_0x207 >> 7) & 0x1) & ((val_0x207 & 0x1) ^ 0x1); // Bit 7 = 1 => operation completed. Bit 0 = 0 => Operation completed successfully
-		timeout++;
-	} while ((pma_done != 1) && (timeout < 1024));
-	if (timeout >= 1023)
-	   netdev_info(netdev, "n5010_htk: ERROR timeout while Waiting for PMA operating mode setting status. readdata = 0x%x, timeout=%d, xcvr=%d\n",
-			       ret, timeout, xcvr_channel);
-	return pma_done; // Returns 1 on success. (0 means timeout)
+	struct n5010_htk_drp *drp = &npriv->drp;
+	unsigned long pending = XCVR_ALL_CHANNELS;
+	u32 status[XCVR_CHANNELS];
+	unsigned int ch, i;
+	u32 timeout;
+	int ret;
+
+	for (ch = 0; ch < XCVR_CHANNELS; ch++)
+		for (i = 0; i < 4; i++)
+			n5010_htk_drp_wr(drp, ch, 0x200 + i /*PMA register i*/,
+					 (params_code >> (8 * i)) & 0xFF);
+
+	for (timeout = 0; pending && timeout < 1024; timeout++) {
+		for_each_set_bit(ch, &pending, XCVR_CHANNELS)
+			n5010_htk_drp_rd(drp, ch, 0x207 /*PMA operation status*/,
+					 &status[ch]);
+		ret = n5010_htk_drp_run(drp);
+		if (ret)
+			return ret;
+
+		// Bit 7 = 1 => operation completed. Bit 0 = 0 => Operation completed successfully
+		for_each_set_bit(ch, &pending, XCVR_CHANNELS)
+			if ((status[ch] & 0x81) == 0x80)
+				__clear_bit(ch, &pending);
+	}
+
+	if (pending) {
+		netdev_info(netdev, "n5010_htk: ERROR timeout while Waiting for PMA operating mode setting status. code = 0x%x, xcvr mask = 0x%lx\n",
+			    params_code, pending);
+		return -ETIMEDOUT;
+	}
+
+	return 0;
 }
 
 /*
  * n5010_htk_update_pma_setting implements the attribute update flow described in Intels's
- * "E-tile Transceiver PHY User Guide" 683723. 2022-09-30. Section 
+ * "E-tile Transceiver PHY User Guide" 683723. 2022-09-30. Section
  * "7.11. PMA Attribute Details"
- * Returns data or 0 if timeout.
+ * The attribute is sent to all channels in the mask before any of them is
+ * polled, so the PMAs act on it in parallel. The returned attribute data of
+ * each channel is stored in data[] if not NULL.
  */
-static int n5010_htk_update_pma_setting(struct net_device *netdev, u32 xcvr_channel, u32 pma_setting)
+static int n5010_htk_update_pma_setting(struct net_device *netdev,
+					unsigned long channels,
+					u32 pma_setting, u32 *data)
 {
 	struct n5010_htk_netdata *npriv = netdev_priv(netdev);
-	struct regmap *regmap = npriv->regmap_mac;
-	u32 ret;
-	u32 return_data;
-	u32 pma_done = 0;
-	u32 timeout = 0;
-
-	ret = n5010_htk_drp_wr(regmap, 0x84 /*PMA code value [7:0] */,
-			       (pma_setting >> 0) & 0xFF /* PMA register data*/,
-			       xcvr_channel);
-	ret = n5010_htk_drp_wr(regmap, 0x85 /*PMA code value [15:8] */,
-			       (pma_setting >> 8) & 0xFF /* PMA register data*/,
-			       xcvr_channel);
-	ret = n5010_htk_drp_wr(regmap, 0x86 /*PMA code address [7:0] */,
-			       (pma_setting >> 16) & 0xFF /* PMA register data*/,
-			       xcvr_channel);
-	ret = n5010_htk_drp_wr(regmap, 0x87 /*PMA code address [15:8] */,
-			       (pma_setting >> 24) & 0xFF /* PMA register data*/,
-			       xcvr_channel);
-
-	// Step 2. Read modify write to set 0x90[0] to 1 PMA operation status:
-	n5010_htk_drp_rmw(netdev, 0x90, 0x1, xcvr_channel, 2);
+	struct n5010_htk_drp *drp = &npriv->drp;
+	u32 lo[XCVR_CHANNELS], hi[XCVR_CHANNELS];
+	u32 status[XCVR_CHANNELS];
+	unsigned long pending;
+	unsigned int ch, i;
+	u32 timeout;
+	int ret;
+
+	// Step 1. Write the PMA code value and address to 0x84-0x87
+	// Step 2. Read modify write to set 0x90[0] to 1 PMA operation status
+	for_each_set_bit(ch, &channels, XCVR_CHANNELS) {
+		for (i = 0; i < 4; i++)
+			n5010_htk_drp_wr(drp, ch, 0x84 + i,
+					 (pma_setting >> (8 * i)) & 0xFF);
+		n5010_htk_drp_set(drp, ch, 0x90, 0x1);
+	}
 
 	// Step 3. Read 0x8A[7] until it is 1:
-	timeout = 0;
-	do {
-		udelay(100);
-		ret = n5010_htk_drp_rd(regmap, 0x8A /*PMA operation status*/,
-				       xcvr_channel);
-		pma_done = (ret >> 7) & 0x1;
-		//printk("HTKDEBUG: n5010_htk_update_pma_setting Post write 0x8A readdata = 0x%x, xcvr=%d, When PMA attribute code is sent to the PMA this number is 1: 0x%x\n", ret, xcvr_channel, pma_done);
-		timeout++;
-	} while((pma_done != 1) && (timeout < 10000));
-	if (timeout >= 10000) {
-		netdev_info(netdev, "n5010_htk: ERROR n5010_htk_update_pma_setting Step 3. Timeout while waiting for PMA Attribute sent: 0x%x Post write 0x8A readdata = 0x%x, xcvr=%d, Timeout count: %d\n", pma_setting, ret, xcvr_channel, timeout);
-		return 0;
+	pending = channels;
+	for (timeout = 0; pending && timeout < 10000; timeout++) {
+		usleep_range(100, 200);
+		for_each_set_bit(ch, &pending, XCVR_CHANNELS)
+			n5010_htk_drp_rd(drp, ch, 0x8A /*PMA operation status*/,
+					 &status[ch]);
+		ret = n5010_htk_drp_run(drp);
+		if (ret)
+			return ret;
+
+		for_each_set_bit(ch, &pending, XCVR_CHANNELS)
+			if (status[ch] & 0x80)
+				__clear_bit(ch, &pending);
+	}
+	if (pending) {
+		netdev_info(netdev, "n5010_htk: ERROR n5010_htk_update_pma_setting Step 3. Timeout while waiting for PMA Attribute sent: 0x%x, xcvr mask = 0x%lx\n",
+			    pma_setting, pending);
+		return -ETIMEDOUT;
 	}
 
 	// Step 4: Read 0x8B[0] until it is 0:
-	timeout = 0;
-	do {
-		ret = n5010_htk_drp_rd(regmap, 0x8B /*[0] = 0 indicates that the PMA is done acting on the Attribute and code*/,
-				       xcvr_channel);
-		//printk("HTKDEBUG: n5010_htk_update_pma_setting Post write 0x8B readdata = 0x%x, xcvr=%d, PMA attribute code transaction completed when bit 0 of last vector is 0.\n", ret, xcvr_channel);
-		timeout++;
-		pma_done = 1 - (ret & 0x1); // pma_done will be 0 while bit [0] is one
-	} while((pma_done != 1) && (timeout < 1024));
-	if ( timeout >= 1024 ) {
-		netdev_info(netdev, "ERROR n5010_htk_update_pma_setting Step 4. Timeout while waiting for PMA Attribute transaction complete. Post write 0x8B readdata = 0x%x, xcvr=%d, Timeout count: %d\n",
-			ret, xcvr_channel, timeout);
-		return 0;
+	pending = channels;
+	for (timeout = 0; pending && timeout < 1024; timeout++) {
+		for_each_set_bit(ch, &pending, XCVR_CHANNELS)
+			n5010_htk_drp_rd(drp, ch, 0x8B /*[0] = 0 indicates that the PMA is done acting on the Attribute and code*/,
+					 &status[ch]);
+		ret = n5010_htk_drp_run(drp);
+		if (ret)
+			return ret;
+
+		for_each_set_bit(ch, &pending, XCVR_CHANNELS)
+			if (!(status[ch] & 0x1))
+				__clear_bit(ch, &pending);
+	}
+	if (pending) {
+		netdev_info(netdev, "ERROR n5010_htk_update_pma_setting Step 4. Timeout while waiting for PMA Attribute transaction complete. xcvr mask = 0x%lx\n",
+			    pending);
+		return -ETIMEDOUT;
 	}
-	//printk("HTKDEBUG: n5010_htk_update_pma_setting Step 4. Post write 0x8B readdata = 0x%x, xcvr=%d, Timeout count: %d. pma_done is: %d\n",
-	//		       ret, xcvr_channel, timeout, pma_done);
-
-	{
-		u32 val_0x88;
-		u32 val_0x89;
-		// Step 5: Read the values of 0x89 and 0x88:
-		val_0x89 = n5010_htk_drp_rd(regmap, 0x89 /* */, xcvr_channel);
-		val_0x88 = n5010_htk_drp_rd(regmap, 0x88 /* */, xcvr_channel);
-		return_data = ((val_0x89 << 8) | val_0x88);
-		//printk("HTKDEBUG: DEBUG - n5010_htk_update_pma_setting Step 5. return_data value: 0x%x\n", return_data);
+
+	// Step 5: Read the values of 0x89 and 0x88
+	// Step 6: Write a 1 to 0x8A[7] to clear the 1 which should be there
+	for_each_set_bit(ch, &channels, XCVR_CHANNELS) {
+		n5010_htk_drp_rd(drp, ch, 0x89, &hi[ch]);
+		n5010_htk_drp_rd(drp, ch, 0x88, &lo[ch]);
+		n5010_htk_drp_set(drp, ch, 0x8A, 0x80);
 	}
+	ret = n5010_htk_drp_run(drp);
+	if (ret)
+		return ret;
 
-	// Step 6: Write a 1 to 0x8A[7] to clear the 1 which should be there:
-	n5010_htk_drp_rmw(netdev, 0x8A, 0x80, xcvr_channel, 6);
-	return return_data;
+	if (data)
+		for_each_set_bit(ch, &channels, XCVR_CHANNELS)
+			data[ch] = (hi[ch] << 8) | lo[ch];
+
+	return 0;
 }
 
 static void n5010_htk_pma_verify_adaptation(struct net_device *netdev, u32 step)
 {
-	struct n5010_htk_netdata *npriv = netdev_priv(netdev);
-	struct regmap *regmap = npriv->regmap_mac;
-	u32 xcvr_channel;
+	unsigned long pending = XCVR_ALL_CHANNELS;
+	u32 data[XCVR_CHANNELS];
+	unsigned int ch;
+	u32 timeout;
+
+	for (timeout = 0; pending && timeout <= 10000; timeout++) {
+		if (n5010_htk_update_pma_setting(netdev, pending, 0x01260B00,
+						 data))
+			break;
 
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		u32 timeout = 0;
-		u32 drp_ret;
-		u32 drp_rd;
-		for (;;) {
-			drp_ret = n5010_htk_update_pma_setting(netdev, xcvr_channel, 0x01260B00); 
-			//netdev_dbg(netdev, "HTKDEBUG: %u. Starting initial adaptation for channel: %d,  PMA setting returns: 0x%x",
-			//	       step, xcvr_channel, drp_ret);
-			drp_rd = n5010_htk_drp_rd(regmap, 0x88 /*PMA attribute code return value [7:0]*/, xcvr_channel);
-			drp_rd = (drp_rd & 0x1);
-			//netdev_dbg(netdev, "HTKDEBUG: %u. Monitoring initial adaptation for channel: %d,  PMA setting returns: %d",
-			//			step, xcvr_channel, drp_rd);
-			if (drp_rd == 0) {
-				break;
-			} else {
-				if (timeout >= 10000) {
-					netdev_info(netdev, "HTKDEBUG: %u. ERROR Timeout while waiting for adaptation done for channel: %d, Register 0x88[0] returns: 0x%x, Timeout value: %d",
-						step, xcvr_channel, drp_rd, timeout);
-					break;
-				}
-				timeout++;
-			}
-		};
-		netdev_dbg(netdev, "HTKDEBUG: %u. Monitoring of initial adaptation done for channel: %d, Register 0x88[0] returns: 0x%x, Timeout value: %d",
-			step, xcvr_channel, drp_rd, timeout);
+		// 0x88[0] returns 0 once the initial adaptation is done
+		for_each_set_bit(ch, &pending, XCVR_CHANNELS)
+			if (!(data[ch] & 0x1))
+				__clear_bit(ch, &pending);
 	}
+
+	if (pending)
+		netdev_info(netdev, "HTKDEBUG: %u. ERROR Timeout while waiting for adaptation done for xcvr mask: 0x%lx, Timeout value: %d",
+			    step, pending, timeout);
+	else
+		netdev_dbg(netdev, "HTKDEBUG: %u. Monitoring of initial adaptation done for all channels, Timeout value: %d",
+			   step, timeout);
 }
 
 /*
@@ -663,7 +766,7 @@ static u32 n5010_htk_reset(struct net_device *netdev)
 	regmap_write(regmap, XCVR_CSR1_OFFSET, (0xFFFFFFFD & readdata) | 0x2);
 	//netdev_dbg(netdev, "HTKDEBUG: n5010_htk_reset - The Reset has been asserted");
 
-	udelay(1000);
+	usleep_range(1000, 2000);
 
 	regmap_write(regmap, XCVR_CSR1_OFFSET, (0xFFFFFFFD & readdata));
 	//netdev_dbg(netdev, "HTKDEBUG: n5010_htk_reset - The Reset has been DE-asserted");
@@ -677,7 +780,7 @@ static u32 n5010_htk_reset(struct net_device *netdev)
 		} else {
 			tx_rx_ready_status_ok_cnt = 0;
 			resample_cnt++;
-			udelay(200);
+			usleep_range(200, 400);
 		}
 		timeout++;
 		if (timeout >= 20000) {
@@ -703,76 +806,59 @@ static u32 n5010_htk_reset(struct net_device *netdev)
 static void n5010_htk_setup_regs(struct net_device *netdev)
 {
 	struct n5010_htk_netdata *npriv = netdev_priv(netdev);
+	struct n5010_htk_drp *drp = &npriv->drp;
 	struct regmap *regmap = npriv->regmap_mac;
+	u32 rx_locked[XCVR_CHANNELS];
 	u32 readdata;
-	u32 drp_rd;
-	u32 drp_ret;
 
 	u32 timeout = 0;
 	u32 xcvr_channel;
 	u32 chs_w_rx_traffic; // Number of channels with data arriving on the Rx
 	u32 chs_has_rx_traffic_cnt; // Number of times in a row that all channels have Rx traffic 
-	//u32 eye_heights[4];
 	u32 i;
 
+	drp->err = 0;
+
 	netdev_dbg(netdev, "HTKDEBUG: 1. Start. assert and deassert Reset to the Native PHY by writing XCVR register offset 4 to 0x2");
 	n5010_htk_reset(netdev);
 	netdev_dbg(netdev, "HTKDEBUG: 1. End. Reset sequence.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 2. Start. Clear the register that indicates PMA attribute has been sent to the PMA.");
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
+	for (xcvr_channel = 0; xcvr_channel < XCVR_CHANNELS; xcvr_channel++) {
 		//Read-modify-write 0x8A[7] = 0x1 to clear PMA attributes sent.
-		n5010_htk_drp_rmw(netdev, 0x8A, 0x80, xcvr_channel, 2);
+		n5010_htk_drp_set(drp, xcvr_channel, 0x8A, 0x80);
 	}
+	n5010_htk_drp_run(drp);
 	netdev_dbg(netdev, "HTKDEBUG: 2. End.   Clear the register that indicates PMA attribute has been sent to the PMA.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 3. Start. Trigger PMA Analog Reset.");
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		netdev_dbg(netdev, "HTKDEBUG: 3. PMA Analog Reset xcvr_channel %d", xcvr_channel);
-		n5010_htk_load_pma_config_params(netdev, xcvr_channel,	0x81000000 /* Write reset opcode to PMA UG-20056 6.4. PMA Analog Reset*/);
-		drp_rd = n5010_htk_drp_rd(regmap, 0x8A /*PMA attribute status*/, xcvr_channel);
-		netdev_dbg(netdev, "HTKDEBUG: 3. The very interesting register 0x8A. XCVR ch: %d has value: 0x%x", xcvr_channel, drp_rd);
-	}
+	n5010_htk_load_pma_config_params(netdev, 0x81000000 /* Write reset opcode to PMA UG-20056 6.4. PMA Analog Reset*/);
 	netdev_dbg(netdev, "HTKDEBUG: 3. End.   Trigger PMA Analog Reset.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 4. Start. Enable PMA calibration and re-load the initial PMA settings.");
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		netdev_dbg(netdev, "HTKDEBUG: 4. xcvr_channel: %d", xcvr_channel);
-
+	for (xcvr_channel = 0; xcvr_channel < XCVR_CHANNELS; xcvr_channel++) {
 		//Read-modify-write 0x95[5] = 0x1 to enable PMA calibration when loading the new PMA settings.
-		n5010_htk_drp_rmw(netdev, 0x95, 0x20, xcvr_channel, 4);
+		n5010_htk_drp_set(drp, xcvr_channel, 0x95, 0x20);
 
 		//Read-modify-write 0x91[0] = 0x1 to load PMA settings into PMA.
-		n5010_htk_drp_rmw(netdev, 0x91, 0x01, xcvr_channel, 4);
-
-		drp_rd = n5010_htk_drp_rd(regmap, 0x8A /*PMA attribute status*/, xcvr_channel);
-		netdev_dbg(netdev, "HTKDEBUG: 4. The very interesting register 0x8A. XCVR ch: %d has value: 0x%x", xcvr_channel, drp_rd);
+		n5010_htk_drp_set(drp, xcvr_channel, 0x91, 0x01);
 	}
+	n5010_htk_drp_run(drp);
 	netdev_dbg(netdev, "HTKDEBUG: 4. End.   Enable PMA calibration and re-load the initial PMA settings.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 5. Start. Set loopback and PRBS mode using Opcode.");
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		netdev_dbg(netdev, "HTKDEBUG: 5. Set loopback and PRBS mode for xcvr_channel: %d", xcvr_channel);
-		n5010_htk_load_pma_config_params(
-			netdev, xcvr_channel,
-			0x9300000D /* Set Tx and Rx to PRBS31, Hard PRBS Gen, Enable loopback */);
-	}
+	n5010_htk_load_pma_config_params(netdev, 0x9300000D /* Set Tx and Rx to PRBS31, Hard PRBS Gen, Enable loopback */);
 	netdev_dbg(netdev, "HTKDEBUG: 5. End.   Set loopback and PRBS mode using Opcode..");
 
 
 	// This sets the Initial adaptation level to "full effort" by reading from PMA
-	// Attribute 0x0118 and then writing 0x0001 to it. This is the same as the default 
+	// Attribute 0x0118 and then writing 0x0001 to it. This is the same as the default
 	// value so maybe we can leave it out.
 	netdev_dbg(netdev, "HTKDEBUG: 6. Start. Set initial adaptation effort level.");
-
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		drp_ret = n5010_htk_update_pma_setting(netdev, xcvr_channel, 0x002C0118); // 0x002C Attribute code: reads the Initial Adaptation effort level.
-		netdev_dbg(netdev, "HTKDEBUG: 6. Setting initial adaptation level for channel: %x,  first PMA setting returns: 0x%x",
-			       xcvr_channel, drp_ret);
-		drp_ret = n5010_htk_update_pma_setting(netdev, xcvr_channel, 0x006C0001); // 0x006c attribute code Writes the Initial Adaptation effort level.
-		netdev_dbg(netdev, "HTKDEBUG: 6. Setting initial adaptation level for channel: %x, second PMA setting returns: 0x%x",
-			       xcvr_channel, drp_ret);
-	}
+	// 0x002C Attribute code: reads the Initial Adaptation effort level.
+	n5010_htk_update_pma_setting(netdev, XCVR_ALL_CHANNELS, 0x002C0118, NULL);
+	// 0x006c attribute code Writes the Initial Adaptation effort level.
+	n5010_htk_update_pma_setting(netdev, XCVR_ALL_CHANNELS, 0x006C0001, NULL);
 	netdev_dbg(netdev, "HTKDEBUG: 6. End.   Set initial adaptation effort level.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 7. Start. Choose the PMA configuration.");
@@ -780,21 +866,11 @@ static void n5010_htk_setup_regs(struct net_device *netdev)
 	netdev_dbg(netdev, "HTKDEBUG: 7. End.   Choose the PMA configuration.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 8. Start. Load the configuration into the transceiver channel.");
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		netdev_dbg(netdev, "HTKDEBUG: 8. Load PMA configuration for xcvr_channel: %d",
-		       xcvr_channel);
-		n5010_htk_load_pma_config_params(
-			netdev, xcvr_channel,
-			0x94000000 /* Load PMA Configuration */);
-	}
+	n5010_htk_load_pma_config_params(netdev, 0x94000000 /* Load PMA Configuration */);
 	netdev_dbg(netdev, "HTKDEBUG: 8. End.   Load the configuration into the transceiver channel.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 9. Start. Perform Initial adaptation.");
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		drp_ret = n5010_htk_update_pma_setting(netdev, xcvr_channel, 0x000A0001); 
-		netdev_dbg(netdev, "HTKDEBUG: 9. Starting initial adaptation for channel: %d,  PMA setting returns: 0x%x",
-			       xcvr_channel, drp_ret);
-	}
+	n5010_htk_update_pma_setting(netdev, XCVR_ALL_CHANNELS, 0x000A0001, NULL);
 	netdev_dbg(netdev, "HTKDEBUG: 9. End.   Perform Initial adaptation.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 10. Start. Verify that the initial adaptation status is complete.");
@@ -803,13 +879,10 @@ static void n5010_htk_setup_regs(struct net_device *netdev)
 	netdev_dbg(netdev, "HTKDEBUG: 10. End.   Verify that the initial adaptation status is complete.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 11. Start. Move to Mission/User Mode.");
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		n5010_htk_load_pma_config_params(netdev, xcvr_channel,
-						 0x9300001E); // Disable; Internal Loopback and Hard PRBs generator
-	}
+	n5010_htk_load_pma_config_params(netdev, 0x9300001E); // Disable; Internal Loopback and Hard PRBs generator
 	netdev_dbg(netdev, "HTKDEBUG: 11. End. Move to Mission/User Mode.");
 
-	udelay(10000);
+	msleep(10);
 
 	netdev_dbg(netdev, "HTKDEBUG: 11.5. Start. Wait for Rx traffic available.");
 	timeout = 0;
@@ -818,21 +891,18 @@ static void n5010_htk_setup_regs(struct net_device *netdev)
 		udelay(1);
 		timeout++;
 		chs_w_rx_traffic=0;
-		for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-			drp_rd = n5010_htk_drp_rd(regmap, 0x40080 , xcvr_channel);
-			//netdev_dbg(netdev, "HTKDEBUG: 11.5. DEBUG - Channel: %d Register 0x40080 with bit 0 being rx_locked_to_data: %x", xcvr_channel, drp_rd);
-			chs_w_rx_traffic += (drp_rd & 0x1);
-			// This eye height measurement does not work, 
-			//eye_heights[xcvr_channel] = n5010_htk_update_pma_setting(regmap, xcvr_channel, 0x002C1700); // 0x002C PMA Attribute code: Read. 0x1700 PMA Attribute data: Eye height.
-		}
-		//netdev_dbg(netdev, "HTKDEBUG: 11.5. DEBUG - Number of channels that have Rx traffic: %d", chs_w_rx_traffic);
-		//netdev_dbg(netdev, "HTKDEBUG: 11.5. DEBUG - Eye heights. Ch3: %d, Ch2: %d,  Ch1: %d, Ch0: %d", eye_heights[3], eye_heights[2], eye_heights[1], eye_heights[0]);
-		if (chs_w_rx_traffic == 4) {
+		for (xcvr_channel = 0; xcvr_channel < XCVR_CHANNELS; xcvr_channel++)
+			n5010_htk_drp_rd(drp, xcvr_channel, 0x40080, &rx_locked[xcvr_channel]);
+		if (n5010_htk_drp_run(drp))
+			break;
+		// Register 0x40080 bit 0 is rx_locked_to_data
+		for (xcvr_channel = 0; xcvr_channel < XCVR_CHANNELS; xcvr_channel++)
+			chs_w_rx_traffic += (rx_locked[xcvr_channel] & 0x1);
+		if (chs_w_rx_traffic == XCVR_CHANNELS) {
 			chs_has_rx_traffic_cnt++;
 		} else {
 			chs_has_rx_traffic_cnt = 0;
 		}
-		//netdev_dbg(netdev, "HTKDEBUG: 11.5. DEBUG - Number of times in a row that all channels have Rx traffic: %d", chs_has_rx_traffic_cnt);
 		if  (timeout >= 10000) {
 			netdev_info(netdev, "HTKDEBUG: 11.5. ERROR Timeout while waiting for all channels to have Rx traffic. Timeout value: %d", timeout);
 			break;
@@ -844,11 +914,7 @@ static void n5010_htk_setup_regs(struct net_device *netdev)
 	netdev_dbg(netdev, "HTKDEBUG: 12. Set initial adaptation effort level. NOT IMPLEMENTED AS THE PREVIOUS SELECTED LEVEL IS REQUESTED");
 
 	netdev_dbg(netdev, "HTKDEBUG: 13. Start. Perform Initial adaptation.");
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		drp_ret = n5010_htk_update_pma_setting(netdev, xcvr_channel, 0x000A0001); 
-		netdev_dbg(netdev, "HTKDEBUG: 13. Starting initial adaptation for channel: %d,  PMA setting returns: 0x%x",
-			       xcvr_channel, drp_ret);
-	}
+	n5010_htk_update_pma_setting(netdev, XCVR_ALL_CHANNELS, 0x000A0001, NULL);
 	netdev_dbg(netdev, "HTKDEBUG: 13. End.   Perform Initial adaptation.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 14. Start. Verify that the initial adaptation status is complete.");
@@ -861,21 +927,11 @@ static void n5010_htk_setup_regs(struct net_device *netdev)
 	netdev_dbg(netdev, "HTKDEBUG: 15. End.   Choose the PMA configuration.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 16. Start. Load the configuration into the transceiver channel.");
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		netdev_dbg(netdev, "HTKDEBUG: 16. Load PMA configuration for xcvr_channel: %d",
-		       xcvr_channel);
-		n5010_htk_load_pma_config_params(
-			netdev, xcvr_channel,
-			0x94000001 /* Load PMA Configuration */);
-	}
+	n5010_htk_load_pma_config_params(netdev, 0x94000001 /* Load PMA Configuration */);
 	netdev_dbg(netdev, "HTKDEBUG: 16. End.   Load the configuration into the transceiver channel.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 17. Start. Start Continuous Adaptation.");
-	for (xcvr_channel = 0; xcvr_channel < 4; xcvr_channel++) {
-		drp_ret = n5010_htk_update_pma_setting(netdev, xcvr_channel, 0x000A0006); 
-		netdev_dbg(netdev, "HTKDEBUG: 17. Starting Continuous adaptation for channel: %d,  PMA setting returns: 0x%x",
-			       xcvr_channel, drp_ret);
-	}
+	n5010_htk_update_pma_setting(netdev, XCVR_ALL_CHANNELS, 0x000A0006, NULL);
 	netdev_dbg(netdev, "HTKDEBUG: 17. End.   Start Continuous Adaptation.");
 
 	netdev_dbg(netdev, "HTKDEBUG: 18. Start. Reset Transceivers.");
@@ -935,27 +991,41 @@ static int n5010_htk_create_netdev(struct n5010_htk_drvdata *priv, u64 port)
 	struct n5010_htk_netdata *npriv;
 	struct net_device *netdev;
 	int err = -ENOMEM;
+	unsigned long deadline;
 	u32 timeout = 0;
 	u32 link = 0;
 
-	netdev = alloc_netdev(sizeof(struct n5010_htk_netdata), "n5010_htk%d",
-			      NET_NAME_UNKNOWN, n5010_htk_init_netdev);
+	netdev = alloc_netdev_mqs(sizeof(struct n5010_htk_netdata), "n5010_htk%d",
+				  NET_NAME_UNKNOWN, n5010_htk_init_netdev,
+				  max(n5010_dp_queues(), 1U),
+				  max(n5010_dp_queues(), 1U));
 
 	if (!netdev)
 		return -ENOMEM;
 
 	npriv = netdev_priv(netdev);
 
+	if (n5010_dp_queues()) {
+		npriv->dp = n5010_dp_create(dev, netdev);
+		if (!npriv->dp)
+			goto err_free_netdev;
+
+		/* stop/wake and BQL need a qdisc in front of the rings */
+		netdev->priv_flags &= ~IFF_NO_QUEUE;
+	}
+
 	npriv->regmap_mac = n5010_htk_create_regmap(priv, port);
 	if (!npriv->regmap_mac)
 		goto err_free_netdev;
 
 	npriv->ops_params = &n5010_100g_params;
 	npriv->priv_flags = 0;
+	npriv->drp.netdev = netdev;
+	npriv->drp.regmap = npriv->regmap_mac;
 
 	SET_NETDEV_DEV(netdev, dev);
-
-	priv->netdev[port] = netdev;
+	/* ports register in completion order, dev_port identifies them */
+	netdev->dev_port = port;
 
 	/* Setup needed data to make netdev_dbg print without "(unnamed net_device) (uninitialized)"
 	 * but without registering netdev to avoid seeing no link */
@@ -971,26 +1041,27 @@ static int n5010_htk_create_netdev(struct n5010_htk_drvdata *priv, u64 port)
 	n5010_htk_clear_stats(npriv);
 
 	// Wait until link with timeout of 2s
+	deadline = jiffies + 2 * HZ;
 	for (;;) {
 		link = ethtool_get_link(netdev);
-		if (link == 1) {
+		if (link == 1 || time_after(jiffies, deadline))
 			break;
-		} else {
-			if (timeout > 20000) {
-				break;
-			}
-		}
 		timeout++;
-		udelay(100);
+		usleep_range(100, 200);
 	}
 
+	/* the name above is only for the messages, let the core pick one */
+	strscpy(netdev->name, "n5010_htk%d", IFNAMSIZ);
+
 	err = register_netdev(netdev);
 	if (err) {
 		dev_err(dev, "failed to register %s: %d", netdev->name, err);
-		goto err_unreg_netdev;
+		goto err_free_netdev;
 	}
 
-	if (timeout > 20000) {
+	priv->netdev[port] = netdev;
+
+	if (link != 1) {
 		netdev_info(netdev, "created, Link is down");
 	} else {
 		netdev_info(netdev, "created, Link is up");
@@ -998,20 +1069,40 @@ static int n5010_htk_create_netdev(struct n5010_htk_drvdata *priv, u64 port)
 	netdev_dbg(netdev, "tests: %u", timeout);
 	return 0;
 
-err_unreg_netdev:
-	unregister_netdev(netdev);
-	return err;
-
 err_free_netdev:
 	free_netdev(netdev);
 	return err;
 }
 
+/*
+ * Each port is brought up from its own work item so that the transceiver
+ * reset and PMA adaptation of the ports run in parallel, and each netdev is
+ * registered as soon as its port is ready.
+ */
+static void n5010_htk_port_init_work(struct work_struct *work)
+{
+	struct n5010_htk_port_init *init =
+		container_of(work, struct n5010_htk_port_init, work);
+	struct device *dev = &init->priv->dfl_dev->dev;
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = n5010_htk_create_netdev(init->priv, init->port);
+	if (ret)
+		dev_err(dev, "port %llu init failed: %d\n", init->port, ret);
+	else
+		dev_info(dev, "port %llu initialized in %lld us\n", init->port,
+			 ktime_us_delta(ktime_get(), start));
+}
+
 static void n5010_htk_remove(struct dfl_device *dfl_dev)
 {
 	struct n5010_htk_drvdata *priv = dev_get_drvdata(&dfl_dev->dev);
 	u64 port;
 
+	for (port = 0; port < priv->port_cnt; port++)
+		flush_work(&priv->init[port].work);
+
 	for (port = 0; port < priv->port_cnt; port++) {
 		struct net_device *my_netdev = priv->netdev[port];
 		if (my_netdev)
@@ -1046,16 +1137,22 @@ static int n5010_htk_probe(struct dfl_device *dfl_dev)
 
 	dev_set_drvdata(dev, priv);
 
+	priv->init = devm_kcalloc(dev, port_cnt, sizeof(*priv->init),
+				  GFP_KERNEL);
+	if (!priv->init) {
+		ret = -ENOMEM;
+		goto err_phy_dev;
+	}
+
 	priv->dfl_dev = dfl_dev;
 	priv->port_cnt = port_cnt;
 	priv->base = base;
 
 	for (port = 0; port < priv->port_cnt; port++) {
-		ret = n5010_htk_create_netdev(priv, port);
-		if (ret) {
-			n5010_htk_remove(dfl_dev);
-			break;
-		}
+		priv->init[port].priv = priv;
+		priv->init[port].port = port;
+		INIT_WORK(&priv->init[port].work, n5010_htk_port_init_work);
+		queue_work(system_unbound_wq, &priv->init[port].work);
 	}
 
 err_phy_dev:
@@ -8,6 +8,7 @@
 #include <linux/bitfield.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
+#include <linux/delay.h>
 #include <linux/i2c.h>
 #include <linux/io-64-nonatomic-lo-hi.h>
 #include <linux/module.h>
@@ -49,7 +50,14 @@
 
 #define DELAY_US 1000
 
-#define QSFP_CHECK_TIME 500
+/*
+ * Hotplug poll interval: QSFP_POLL_MIN_MS right after a change, doubling
+ * up to QSFP_POLL_MAX_MS while the cage is stable. The controller has no
+ * documented module present interrupt or status to clear, so presence is
+ * always polled.
+ */
+#define QSFP_POLL_MIN_MS	100
+#define QSFP_POLL_MAX_MS	2000
 
 static const struct regmap_range qsfp_mem_regmap_range[] = {
 	regmap_reg_range(CONF_OFF, STAT_OFF),
@@ -84,17 +92,17 @@ static const struct regmap_config mmio_cfg = {
 static void qsfp_init(struct qsfp *qsfp)
 {
 	writeq(CONF_RST_MOD | CONF_RST_CON | CONF_MOD_SEL, qsfp->base + CONF_OFF);
-	udelay(DELAY_US);
+	usleep_range(DELAY_US, DELAY_US * 2);
 	writeq(CONF_MOD_SEL, qsfp->base + CONF_OFF);
-	udelay(DELAY_US);
+	usleep_range(DELAY_US, DELAY_US * 2);
 
 	qsfp_init_i2c(qsfp);
 
-	udelay(DELAY_US);
+	usleep_range(DELAY_US, DELAY_US * 2);
 	writeq(DELAY_VALUE, qsfp->base + DELAY_REG);
 
 	writeq(CONF_POLL_EN | CONF_MOD_SEL, qsfp->base + CONF_OFF);
-	udelay(DELAY_US);
+	usleep_range(DELAY_US, DELAY_US * 2);
 }
 
 int check_qsfp_plugin(struct qsfp *qsfp)
@@ -135,9 +143,28 @@ const struct attribute_group *qsfp_mem_groups[] = {
 };
 EXPORT_SYMBOL_GPL(qsfp_mem_groups);
 
+static void qsfp_schedule_poll(struct qsfp *qsfp, bool changed)
+{
+	unsigned long delay;
+
+	if (changed)
+		qsfp->poll_ms = QSFP_POLL_MIN_MS;
+	else
+		qsfp->poll_ms = min_t(unsigned int, qsfp->poll_ms * 2,
+				      QSFP_POLL_MAX_MS);
+
+	/* let the slow polls of many cages share wakeups */
+	delay = msecs_to_jiffies(qsfp->poll_ms);
+	if (qsfp->poll_ms == QSFP_POLL_MAX_MS)
+		delay = round_jiffies_relative(delay);
+
+	schedule_delayed_work(&qsfp->dwork, delay);
+}
+
 void qsfp_check_hotplug(struct work_struct *work)
 {
 	struct delayed_work *dwork;
+	bool changed = false;
 	struct qsfp *qsfp;
 	u64 status;
 
@@ -153,19 +180,23 @@ void qsfp_check_hotplug(struct work_struct *work)
 		dev_info(qsfp->dev, "detected QSFP plugin\n");
 		qsfp_init(qsfp);
 		WRITE_ONCE(qsfp->init, QSFP_INIT_DONE);
+		changed = true;
 	} else if (!check_qsfp_plugin(qsfp) &&
 		   qsfp->init == QSFP_INIT_DONE) {
 		dev_info(qsfp->dev, "detected QSFP unplugin\n");
 		WRITE_ONCE(qsfp->init, QSFP_INIT_RESET);
+		changed = true;
 	}
 	mutex_unlock(&qsfp->lock);
 
-	schedule_delayed_work(&qsfp->dwork, msecs_to_jiffies(QSFP_CHECK_TIME));
+	qsfp_schedule_poll(qsfp, changed);
 }
 
 int qsfp_init_work(struct qsfp *qsfp)
 {
 	INIT_DELAYED_WORK(&qsfp->dwork, qsfp_check_hotplug);
+	qsfp->poll_ms = QSFP_POLL_MIN_MS;
+
 	qsfp_check_hotplug(&qsfp->dwork.work);
 	return 0;
 }
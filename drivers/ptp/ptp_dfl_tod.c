@@ -6,15 +6,21 @@
  *
  */
 
+#include <linux/bitfield.h>
 #include <linux/clk.h>
-#include <linux/delay.h>
+#include <linux/debugfs.h>
 #include <linux/dfl.h>
 #include <linux/gcd.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/ptp_clock_kernel.h>
+#include <linux/seq_file.h>
+#include <linux/version.h>
 
 #define FME_FEATURE_ID_TOD		0x22
 
@@ -27,6 +33,8 @@
 #define TOD_ADJUST_MS_MAX		(((((TOD_PERIOD_MAX) >> 16) + 1) * \
 					  ((TOD_ADJUST_COUNT_MAX) + 1)) /  \
 					 1000000UL)
+#define TOD_ADJUST_POLL_NS		(10 * NSEC_PER_USEC)
+#define TOD_LAT_BUCKETS			16
 
 /* Time-of-Day (ToD) clock register space. */
 #define CLK_F				0x38
@@ -39,6 +47,49 @@
 #define DRIFT_ADJUST			0x11c
 #define DRIFT_ADJUST_RATE		0x120
 
+/*
+ * Optional timestamp I/O block, present if the ToD feature has the
+ * DFHv1_PARAM_ID_TOD_IO parameter. The parameter gives the number of
+ * periodic outputs and external timestamp inputs, whether a PPS event is
+ * generated, and the offset of the block from the ToD register space.
+ *
+ * There is no IP documentation for this block: neither the block nor the
+ * parameter is part of the ToD clock IP the feature is built on. Both are
+ * defined by this driver. The parameter ID is specific to the ToD feature,
+ * like the 8250_dfl ones are to the UART, and the register map below is the
+ * reference for FPGA designs that add the block next to the ToD clock.
+ */
+#define DFHv1_PARAM_ID_TOD_IO		0x5
+#define DFHv1_PARAM_TOD_IO_N_PER_OUT	GENMASK_ULL(7, 0)
+#define DFHv1_PARAM_TOD_IO_N_EXT_TS	GENMASK_ULL(15, 8)
+#define DFHv1_PARAM_TOD_IO_PPS		BIT_ULL(16)
+#define DFHv1_PARAM_TOD_IO_OFFSET	GENMASK_ULL(63, 32)
+
+#define TOD_IO_MAX_CHANNELS		8
+
+/* Event status (write 1 to clear) and enable, shared by all channels */
+#define IO_IRQ_STATUS			0x0
+#define IO_IRQ_MASK			0x4
+#define IO_IRQ_PPS			BIT(0)
+#define IO_IRQ_EXTTS(n)			BIT(1 + (n))
+
+/* Per channel registers, periodic outputs first, then external inputs */
+#define IO_CHAN(n)			(0x20 * (1 + (n)))
+#define IO_CTRL				0x0
+#define IO_CTRL_EN			BIT(0)
+#define IO_CTRL_RISING			BIT(1)
+#define IO_CTRL_FALLING			BIT(2)
+#define IO_PO_START_SECL		0x4
+#define IO_PO_START_SECH		0x8
+#define IO_PO_START_NS			0xc
+#define IO_PO_PERIOD_NSL		0x10
+#define IO_PO_PERIOD_NSH		0x14
+#define IO_TS_NS			0x4
+#define IO_TS_SECL			0x8
+#define IO_TS_SECH			0xc
+
+#define TOD_IO_POLL_MS			10
+
 struct dfl_tod {
 	struct device *dev;
 	struct ptp_clock_info ptp_clock_ops;
@@ -49,32 +100,92 @@ struct dfl_tod {
 
 	/* ToD clock registers protection */
 	spinlock_t tod_lock;
+
+	/* Offset adjustment state, protected by tod_lock */
+	struct hrtimer adj_timer;
+	ktime_t adj_deadline;
+	bool adj_busy;
+	s32 adj_step;
+	s32 adj_rem;
+	u32 adj_rem_period;
+	s64 adj_queued;
+
+	/* Time read latency measurement, protected by tod_lock */
+	struct dentry *dbgfs;
+	bool lat_enabled;
+	u64 lat_count;
+	u64 lat_min;
+	u64 lat_max;
+	u64 lat_sum;
+	u64 lat_hist[TOD_LAT_BUCKETS];
+
+	/* Timestamp I/O block, events enabled in io_mask */
+	void __iomem *io;
+	int irq;
+	u32 io_mask;
 };
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 0, 0)
+struct ptp_system_timestamp;
+static inline void ptp_read_system_prets(struct ptp_system_timestamp *sts) {}
+static inline void ptp_read_system_postts(struct ptp_system_timestamp *sts) {}
+#endif
+
 /* A fine ToD HW clock offset adjustment.
  * To perform the fine offset adjustment the AdjustPeriod register is used
  * to replace the Period register for AdjustCount clock cycles in hardware.
+ * The adjustment completes asynchronously, this function only arms it and
+ * returns the time it is expected to take.
  * The dt->tod_lock spinlock must be held when calling this function.
  */
-static int fine_adjust_tod_clock(struct dfl_tod *dt, u32 adjust_period,
-				 u32 adjust_count)
+static ktime_t fine_adjust_tod_clock(struct dfl_tod *dt, u32 adjust_period,
+				     u32 adjust_count, s32 step)
 {
 	void __iomem *base = dt->tod_ctrl;
-	int limit;
+	u64 ns;
 
 	writel(adjust_period, base + ADJUST_PERIOD);
 	writel(adjust_count, base + ADJUST_COUNT);
 
-	/* Wait for present offset adjustment update to complete */
-	limit = TOD_ADJUST_MS_MAX;
-	while (limit--) {
-		if (!readl(base + ADJUST_COUNT))
-			break;
-		mdelay(1);
+	ns = ((u64)adjust_count * adjust_period) >> 16;
+
+	dt->adj_busy = true;
+	dt->adj_step = step;
+	dt->adj_deadline = ktime_add_ms(ktime_get(), TOD_ADJUST_MS_MAX);
+
+	return ns_to_ktime(max_t(u64, ns, TOD_ADJUST_POLL_NS));
+}
+
+/* Stop any offset adjustment in flight and drop the queued ones.
+ * The dt->tod_lock spinlock must be held when calling this function.
+ */
+static void cancel_adjust_tod_clock(struct dfl_tod *dt)
+{
+	void __iomem *base = dt->tod_ctrl;
+
+	if (dt->adj_busy) {
+		writel(0, base + ADJUST_PERIOD);
+		writel(0, base + ADJUST_COUNT);
 	}
-	if (limit < 0)
-		return -EBUSY;
-	return 0;
+
+	dt->adj_busy = false;
+	dt->adj_step = 0;
+	dt->adj_rem = 0;
+	dt->adj_rem_period = 0;
+	dt->adj_queued = 0;
+}
+
+/* Offset which is requested by adjtime but not applied to the HW clock yet.
+ * The dt->tod_lock spinlock must be held when calling this function.
+ */
+static s64 pending_adjust_tod_clock(struct dfl_tod *dt)
+{
+	s64 pending = dt->adj_queued + dt->adj_rem;
+
+	if (dt->adj_busy)
+		pending += (s64)readl(dt->tod_ctrl + ADJUST_COUNT) * dt->adj_step;
+
+	return pending;
 }
 
 /* A coarse ToD HW clock offset adjustment.
@@ -112,12 +223,139 @@ static int coarse_adjust_tod_clock(struct dfl_tod *dt, s64 delta)
 	return 0;
 }
 
+/* Start the next queued offset adjustment, if any.
+ * Returns the time to wait before polling for its completion, or 0 if no
+ * fine adjustment is in flight.
+ * The dt->tod_lock spinlock must be held when calling this function.
+ */
+static ktime_t start_adjust_tod_clock(struct dfl_tod *dt)
+{
+	u32 period, diff, rem = 0, rem_period, adj_period;
+	void __iomem *base = dt->tod_ctrl;
+	int neg_adj = 0;
+	s64 delta;
+	u64 count;
+	s32 step;
+
+	/* Finish the trailing remainder cycle of the previous adjustment */
+	if (dt->adj_rem_period) {
+		rem_period = dt->adj_rem_period;
+		step = dt->adj_rem;
+		dt->adj_rem_period = 0;
+		dt->adj_rem = 0;
+		return fine_adjust_tod_clock(dt, rem_period, 1, step);
+	}
+
+	delta = dt->adj_queued;
+	dt->adj_queued = 0;
+	if (!delta)
+		return 0;
+
+	if (delta < 0) {
+		neg_adj = 1;
+		delta = -delta;
+	}
+
+	/* Get the maximum possible value of the Period register offset
+	 * adjustment in nanoseconds scale. This depends on the current
+	 * Period register setting and the maximum and minimum possible
+	 * values of the Period register.
+	 */
+	period = readl(base + PERIOD);
+
+	if (neg_adj)
+		diff = (period - TOD_PERIOD_MIN) >> 16;
+	else
+		diff = (TOD_PERIOD_MAX - period) >> 16;
+
+	/* Find the number of cycles required for the
+	 * time adjustment
+	 */
+	count = diff ? div_u64_rem(delta, diff, &rem) : U64_MAX;
+
+	/* If count is larger than the maximum count,
+	 * just set the time.
+	 */
+	if (count > TOD_ADJUST_COUNT_MAX) {
+		/* Perform the coarse time offset adjustment */
+		coarse_adjust_tod_clock(dt, neg_adj ? -delta : delta);
+		return 0;
+	}
+
+	if (neg_adj) {
+		adj_period = period - (diff << 16);
+		rem_period = period - (rem << 16);
+	} else {
+		adj_period = period + (diff << 16);
+		rem_period = period + (rem << 16);
+	}
+
+	/* If there is a remainder, adjust the period for an
+	 * additional cycle once the count cycles are done
+	 */
+	if (count && rem) {
+		dt->adj_rem_period = rem_period;
+		dt->adj_rem = neg_adj ? -(s32)rem : (s32)rem;
+	}
+
+	/* Adjust the period for count cycles to adjust the time */
+	if (count) {
+		step = neg_adj ? -(s32)diff : (s32)diff;
+		return fine_adjust_tod_clock(dt, adj_period, count, step);
+	}
+
+	step = neg_adj ? -(s32)rem : (s32)rem;
+	return fine_adjust_tod_clock(dt, rem_period, 1, step);
+}
+
+static enum hrtimer_restart dfl_tod_adjust_timer(struct hrtimer *timer)
+{
+	struct dfl_tod *dt = container_of(timer, struct dfl_tod, adj_timer);
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	void __iomem *base = dt->tod_ctrl;
+	unsigned long flags;
+	ktime_t wait;
+
+	spin_lock_irqsave(&dt->tod_lock, flags);
+
+	if (!dt->adj_busy)
+		goto unlock;
+
+	/* Poll until present offset adjustment update completes */
+	if (readl(base + ADJUST_COUNT)) {
+		if (ktime_before(ktime_get(), dt->adj_deadline)) {
+			hrtimer_forward_now(timer, ns_to_ktime(TOD_ADJUST_POLL_NS));
+			ret = HRTIMER_RESTART;
+		} else {
+			dev_warn_ratelimited(dt->dev, "offset adjustment timed out\n");
+			cancel_adjust_tod_clock(dt);
+		}
+		goto unlock;
+	}
+
+	dt->adj_busy = false;
+	dt->adj_step = 0;
+
+	wait = start_adjust_tod_clock(dt);
+	if (wait) {
+		hrtimer_forward_now(timer, wait);
+		ret = HRTIMER_RESTART;
+	}
+
+unlock:
+	spin_unlock_irqrestore(&dt->tod_lock, flags);
+
+	return ret;
+}
+
 static int dfl_tod_adjust_fine(struct ptp_clock_info *ptp, long scaled_ppm)
 {
 	struct dfl_tod *dt = container_of(ptp, struct dfl_tod, ptp_clock_ops);
 	u32 tod_period, tod_rem, tod_drift_adjust_fns, tod_drift_adjust_rate;
 	void __iomem *base = dt->tod_ctrl;
 	unsigned long flags, rate;
+	s64 pending;
+	ktime_t wait;
 	u64 ppb;
 
 	/* Get the clock rate from clock frequency register offset */
@@ -150,11 +388,27 @@ static int dfl_tod_adjust_fine(struct ptp_clock_info *ptp, long scaled_ppm)
 		tod_drift_adjust_rate = 0;
 
 	spin_lock_irqsave(&dt->tod_lock, flags);
+
+	/* ADJUST_PERIOD and adj_step of an offset adjustment in flight were
+	 * derived from the old Period, stop it and queue what is left of it
+	 * again, so that it is re-armed from the new Period below. The cycles
+	 * the hardware runs between reading ADJUST_COUNT and stopping it are
+	 * lost, at most a few ns.
+	 */
+	pending = pending_adjust_tod_clock(dt);
+	cancel_adjust_tod_clock(dt);
+	dt->adj_queued = pending;
+
 	writel(tod_period, base + PERIOD);
 	writel(0, base + ADJUST_PERIOD);
 	writel(0, base + ADJUST_COUNT);
 	writel(tod_drift_adjust_fns, base + DRIFT_ADJUST);
 	writel(tod_drift_adjust_rate, base + DRIFT_ADJUST_RATE);
+
+	wait = start_adjust_tod_clock(dt);
+	if (wait)
+		hrtimer_start(&dt->adj_timer, wait, HRTIMER_MODE_REL);
+
 	spin_unlock_irqrestore(&dt->tod_lock, flags);
 
 	return 0;
@@ -163,83 +417,75 @@ static int dfl_tod_adjust_fine(struct ptp_clock_info *ptp, long scaled_ppm)
 static int dfl_tod_adjust_time(struct ptp_clock_info *ptp, s64 delta)
 {
 	struct dfl_tod *dt = container_of(ptp, struct dfl_tod, ptp_clock_ops);
-	u32 period, diff, rem, rem_period, adj_period;
-	void __iomem *base = dt->tod_ctrl;
-	int neg_adj = 0, ret = 0;
 	unsigned long flags;
-	u64 count;
-
-	if (delta < 0) {
-		neg_adj = 1;
-		delta = -delta;
-	}
-
-	spin_lock_irqsave(&dt->tod_lock, flags);
-
-	/* Get the maximum possible value of the Period register offset
-	 * adjustment in nanoseconds scale. This depends on the current
-	 * Period register setting and the maximum and minimum possible
-	 * values of the Period register.
-	 */
-	period = readl(base + PERIOD);
+	ktime_t wait;
 
-	if (neg_adj)
-		diff = (period - TOD_PERIOD_MIN) >> 16;
-	else
-		diff = (TOD_PERIOD_MAX - period) >> 16;
-
-	/* Find the number of cycles required for the
-	 * time adjustment
+	/* The adjustment is queued and carried out from adj_timer, so that
+	 * the caller never waits for the hardware with the lock held.
+	 * gettime accounts for the pending part in the meantime.
 	 */
-	count = div_u64_rem(delta, diff, &rem);
-
-	if (neg_adj) {
-		adj_period = period - (diff << 16);
-		rem_period = period - (rem << 16);
-	} else {
-		adj_period = period + (diff << 16);
-		rem_period = period + (rem << 16);
-	}
-
-	/* If count is larger than the maximum count,
-	 * just set the time.
-	 */
-	if (count > TOD_ADJUST_COUNT_MAX) {
-		/* Perform the coarse time offset adjustment */
-		ret = coarse_adjust_tod_clock(dt, delta);
-	} else {
-		/* Adjust the period for count cycles to adjust the time */
-		if (count)
-			ret = fine_adjust_tod_clock(dt, adj_period, count);
-
-		/* If there is a remainder, adjust the period for an
-		 * additional cycle
-		 */
-		if (rem)
-			ret = fine_adjust_tod_clock(dt, rem_period, 1);
+	spin_lock_irqsave(&dt->tod_lock, flags);
+	dt->adj_queued += delta;
+	if (!dt->adj_busy) {
+		wait = start_adjust_tod_clock(dt);
+		if (wait)
+			hrtimer_start(&dt->adj_timer, wait, HRTIMER_MODE_REL);
 	}
-
 	spin_unlock_irqrestore(&dt->tod_lock, flags);
 
-	return ret;
+	return 0;
 }
 
-static int dfl_tod_get_time(struct ptp_clock_info *ptp, struct timespec64 *ts)
+/* Account the duration of one time read in the latency histogram.
+ * The dt->tod_lock spinlock must be held when calling this function.
+ */
+static void account_read_latency(struct dfl_tod *dt, u64 ns)
+{
+	if (!dt->lat_count || ns < dt->lat_min)
+		dt->lat_min = ns;
+	if (ns > dt->lat_max)
+		dt->lat_max = ns;
+
+	dt->lat_count++;
+	dt->lat_sum += ns;
+	dt->lat_hist[min_t(int, fls64(ns), TOD_LAT_BUCKETS - 1)]++;
+}
+
+static int dfl_tod_get_timex(struct ptp_clock_info *ptp, struct timespec64 *ts,
+			     struct ptp_system_timestamp *sts)
 {
 	struct dfl_tod *dt = container_of(ptp, struct dfl_tod, ptp_clock_ops);
 	u32 seconds_msb, seconds_lsb, nanosec;
 	void __iomem *base = dt->tod_ctrl;
+	u64 seconds, start = 0;
 	unsigned long flags;
-	u64 seconds;
+	s64 pending;
 
 	spin_lock_irqsave(&dt->tod_lock, flags);
+	if (dt->lat_enabled)
+		start = ktime_get_ns();
+
+	/* Reading NANOSEC latches the seconds, bracket only that read */
+	ptp_read_system_prets(sts);
 	nanosec = readl(base + NANOSEC);
+	ptp_read_system_postts(sts);
+
+	if (dt->lat_enabled)
+		account_read_latency(dt, ktime_get_ns() - start);
+
 	seconds_lsb = readl(base + SECONDSL);
 	seconds_msb = readl(base + SECONDSH);
+	pending = pending_adjust_tod_clock(dt);
 	spin_unlock_irqrestore(&dt->tod_lock, flags);
 
 	seconds = (((u64)(seconds_msb & 0x0000ffff)) << 32) | seconds_lsb;
 
+	/* Report the time the clock converges to */
+	if (pending) {
+		seconds = div_u64_rem(seconds * NSEC_PER_SEC + nanosec + pending,
+				      NSEC_PER_SEC, &nanosec);
+	}
+
 	ts->tv_nsec = nanosec;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 5, 0)
 	ts->tv_sec = (__kernel_old_time_t)seconds;
@@ -250,6 +496,11 @@ static int dfl_tod_get_time(struct ptp_clock_info *ptp, struct timespec64 *ts)
 	return 0;
 }
 
+static int dfl_tod_get_time(struct ptp_clock_info *ptp, struct timespec64 *ts)
+{
+	return dfl_tod_get_timex(ptp, ts, NULL);
+}
+
 static int dfl_tod_set_time(struct ptp_clock_info *ptp,
 			    const struct timespec64 *ts)
 {
@@ -261,6 +512,7 @@ static int dfl_tod_set_time(struct ptp_clock_info *ptp,
 	unsigned long flags;
 
 	spin_lock_irqsave(&dt->tod_lock, flags);
+	cancel_adjust_tod_clock(dt);
 	writel(seconds_msb, base + SECONDSH);
 	writel(seconds_lsb, base + SECONDSL);
 	writel(nanosec, base + NANOSEC);
@@ -269,10 +521,212 @@ static int dfl_tod_set_time(struct ptp_clock_info *ptp,
 	return 0;
 }
 
+/* Deliver captured timestamps and PPS events to the PTP event queue */
+static void dfl_tod_io_events(struct dfl_tod *dt)
+{
+	struct ptp_clock_info *info = &dt->ptp_clock_ops;
+	u64 ts[TOD_IO_MAX_CHANNELS];
+	struct ptp_clock_event event;
+	u32 status, ns, secl, sech;
+	unsigned long flags;
+	void __iomem *chan;
+	int i;
+
+	spin_lock_irqsave(&dt->tod_lock, flags);
+	status = readl(dt->io + IO_IRQ_STATUS) & dt->io_mask;
+
+	/* Read the captured timestamps before a new capture is allowed */
+	for (i = 0; i < info->n_ext_ts; i++) {
+		if (!(status & IO_IRQ_EXTTS(i)))
+			continue;
+
+		chan = dt->io + IO_CHAN(info->n_per_out + i);
+		ns = readl(chan + IO_TS_NS);
+		secl = readl(chan + IO_TS_SECL);
+		sech = readl(chan + IO_TS_SECH);
+		ts[i] = ((((u64)(sech & 0x0000ffff)) << 32) | secl) *
+			NSEC_PER_SEC + ns;
+	}
+
+	if (status)
+		writel(status, dt->io + IO_IRQ_STATUS);
+	spin_unlock_irqrestore(&dt->tod_lock, flags);
+
+	if (status & IO_IRQ_PPS) {
+		event.type = PTP_CLOCK_PPS;
+		ptp_clock_event(dt->ptp_clock, &event);
+	}
+
+	for (i = 0; i < info->n_ext_ts; i++) {
+		if (!(status & IO_IRQ_EXTTS(i)))
+			continue;
+
+		event.type = PTP_CLOCK_EXTTS;
+		event.index = i;
+		event.timestamp = ts[i];
+		ptp_clock_event(dt->ptp_clock, &event);
+	}
+}
+
+static irqreturn_t dfl_tod_irq_handler(int irq, void *dev_id)
+{
+	struct dfl_tod *dt = dev_id;
+
+	dfl_tod_io_events(dt);
+
+	return IRQ_HANDLED;
+}
+
+/* Without an interrupt the events are polled from the PTP aux worker */
+static long dfl_tod_aux_work(struct ptp_clock_info *ptp)
+{
+	struct dfl_tod *dt = container_of(ptp, struct dfl_tod, ptp_clock_ops);
+
+	dfl_tod_io_events(dt);
+
+	return READ_ONCE(dt->io_mask) ? msecs_to_jiffies(TOD_IO_POLL_MS) : -1;
+}
+
+/* The dt->tod_lock spinlock must be held when calling this function. */
+static void dfl_tod_io_set_mask(struct dfl_tod *dt, u32 bit, int on)
+{
+	u32 mask = on ? dt->io_mask | bit : dt->io_mask & ~bit;
+
+	/* Drop stale events before enabling a source */
+	if (on && !(dt->io_mask & bit))
+		writel(bit, dt->io + IO_IRQ_STATUS);
+
+	dt->io_mask = mask;
+	writel(mask, dt->io + IO_IRQ_MASK);
+}
+
+static int dfl_tod_enable_perout(struct dfl_tod *dt,
+				 struct ptp_perout_request *req, int on)
+{
+	void __iomem *chan;
+	u64 start, period;
+
+	if (req->index >= dt->ptp_clock_ops.n_per_out || req->flags)
+		return -EINVAL;
+
+	chan = dt->io + IO_CHAN(req->index);
+
+	if (!on) {
+		writel(0, chan + IO_CTRL);
+		return 0;
+	}
+
+	start = req->start.sec;
+	period = (u64)req->period.sec * NSEC_PER_SEC + req->period.nsec;
+	if (!period || req->start.nsec >= NSEC_PER_SEC)
+		return -EINVAL;
+
+	writel(0, chan + IO_CTRL);
+	writel(lower_32_bits(start), chan + IO_PO_START_SECL);
+	writel(upper_32_bits(start) & 0x0000ffff, chan + IO_PO_START_SECH);
+	writel(req->start.nsec, chan + IO_PO_START_NS);
+	writel(lower_32_bits(period), chan + IO_PO_PERIOD_NSL);
+	writel(upper_32_bits(period), chan + IO_PO_PERIOD_NSH);
+	writel(IO_CTRL_EN, chan + IO_CTRL);
+
+	return 0;
+}
+
+static int dfl_tod_enable_extts(struct dfl_tod *dt,
+				struct ptp_extts_request *req, int on)
+{
+	void __iomem *chan;
+	u32 ctrl = 0;
+
+	if (req->index >= dt->ptp_clock_ops.n_ext_ts)
+		return -EINVAL;
+
+	chan = dt->io + IO_CHAN(dt->ptp_clock_ops.n_per_out + req->index);
+
+	if (on) {
+		ctrl = IO_CTRL_EN;
+		if (req->flags & PTP_RISING_EDGE)
+			ctrl |= IO_CTRL_RISING;
+		if (req->flags & PTP_FALLING_EDGE)
+			ctrl |= IO_CTRL_FALLING;
+		/* Default to the rising edge if none is given */
+		if (!(ctrl & (IO_CTRL_RISING | IO_CTRL_FALLING)))
+			ctrl |= IO_CTRL_RISING;
+	}
+
+	writel(ctrl, chan + IO_CTRL);
+	dfl_tod_io_set_mask(dt, IO_IRQ_EXTTS(req->index), on);
+
+	return 0;
+}
+
 static int dfl_tod_enable_feature(struct ptp_clock_info *ptp,
 				  struct ptp_clock_request *request, int on)
 {
-	return -EOPNOTSUPP;
+	struct dfl_tod *dt = container_of(ptp, struct dfl_tod, ptp_clock_ops);
+	unsigned long flags;
+	int ret;
+
+	if (!dt->io)
+		return -EOPNOTSUPP;
+
+	spin_lock_irqsave(&dt->tod_lock, flags);
+	switch (request->type) {
+	case PTP_CLK_REQ_PEROUT:
+		ret = dfl_tod_enable_perout(dt, &request->perout, on);
+		break;
+	case PTP_CLK_REQ_EXTTS:
+		ret = dfl_tod_enable_extts(dt, &request->extts, on);
+		break;
+	case PTP_CLK_REQ_PPS:
+		if (!ptp->pps) {
+			ret = -EOPNOTSUPP;
+			break;
+		}
+		dfl_tod_io_set_mask(dt, IO_IRQ_PPS, on);
+		ret = 0;
+		break;
+	default:
+		ret = -EOPNOTSUPP;
+		break;
+	}
+	spin_unlock_irqrestore(&dt->tod_lock, flags);
+
+	if (!ret && on && dt->irq < 0 && request->type != PTP_CLK_REQ_PEROUT)
+		ptp_schedule_worker(dt->ptp_clock, 0);
+
+	return ret;
+}
+
+/* Set up the optional timestamp I/O block from the DFHv1 parameter */
+static void dfl_tod_io_init(struct dfl_tod *dt, struct dfl_device *ddev)
+{
+	struct ptp_clock_info *info = &dt->ptp_clock_ops;
+	u32 n_per_out, n_ext_ts;
+	u64 v;
+
+	dt->irq = -1;
+
+	if (dfh_get_u64_param_val(ddev, DFHv1_PARAM_ID_TOD_IO, &v))
+		return;
+
+	n_per_out = FIELD_GET(DFHv1_PARAM_TOD_IO_N_PER_OUT, v);
+	n_ext_ts = FIELD_GET(DFHv1_PARAM_TOD_IO_N_EXT_TS, v);
+
+	if (n_per_out + n_ext_ts > TOD_IO_MAX_CHANNELS ||
+	    FIELD_GET(DFHv1_PARAM_TOD_IO_OFFSET, v) +
+	    IO_CHAN(n_per_out + n_ext_ts) > resource_size(&ddev->mmio_res)) {
+		dev_warn(dt->dev, "invalid ToD I/O parameter 0x%llx\n", v);
+		return;
+	}
+
+	dt->io = dt->tod_ctrl + FIELD_GET(DFHv1_PARAM_TOD_IO_OFFSET, v);
+	writel(0, dt->io + IO_IRQ_MASK);
+
+	info->n_per_out = n_per_out;
+	info->n_ext_ts = n_ext_ts;
+	info->pps = !!(v & DFHv1_PARAM_TOD_IO_PPS);
+	info->do_aux_work = dfl_tod_aux_work;
 }
 
 static struct ptp_clock_info dfl_tod_clock_ops = {
@@ -286,14 +740,99 @@ static struct ptp_clock_info dfl_tod_clock_ops = {
 	.adjfine = dfl_tod_adjust_fine,
 	.adjtime = dfl_tod_adjust_time,
 	.gettime64 = dfl_tod_get_time,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 0, 0)
+	.gettimex64 = dfl_tod_get_timex,
+#endif
 	.settime64 = dfl_tod_set_time,
 	.enable = dfl_tod_enable_feature,
 };
 
+static int read_latency_show(struct seq_file *s, void *unused)
+{
+	struct dfl_tod *dt = s->private;
+	u64 hist[TOD_LAT_BUCKETS];
+	u64 count, min, max, sum;
+	unsigned long flags;
+	bool enabled;
+	int i;
+
+	spin_lock_irqsave(&dt->tod_lock, flags);
+	enabled = dt->lat_enabled;
+	count = dt->lat_count;
+	min = dt->lat_min;
+	max = dt->lat_max;
+	sum = dt->lat_sum;
+	memcpy(hist, dt->lat_hist, sizeof(hist));
+	spin_unlock_irqrestore(&dt->tod_lock, flags);
+
+	seq_printf(s, "enabled: %d\n", enabled);
+	seq_printf(s, "count: %llu\n", count);
+	if (!count)
+		return 0;
+
+	seq_printf(s, "min_ns: %llu\n", min);
+	seq_printf(s, "max_ns: %llu\n", max);
+	seq_printf(s, "avg_ns: %llu\n", div64_u64(sum, count));
+
+	for (i = 0; i < TOD_LAT_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		if (i == TOD_LAT_BUCKETS - 1)
+			seq_printf(s, ">=%llu: %llu\n", BIT_ULL(i - 1), hist[i]);
+		else
+			seq_printf(s, "<%llu: %llu\n", BIT_ULL(i), hist[i]);
+	}
+
+	return 0;
+}
+
+static int read_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, read_latency_show, inode->i_private);
+}
+
+/* Writing 1 resets and starts the measurement, 0 stops it */
+static ssize_t read_latency_write(struct file *file, const char __user *buf,
+				  size_t count, loff_t *ppos)
+{
+	struct dfl_tod *dt = ((struct seq_file *)file->private_data)->private;
+	unsigned long flags;
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(buf, count, &enable);
+	if (ret)
+		return ret;
+
+	spin_lock_irqsave(&dt->tod_lock, flags);
+	if (enable) {
+		dt->lat_count = 0;
+		dt->lat_min = 0;
+		dt->lat_max = 0;
+		dt->lat_sum = 0;
+		memset(dt->lat_hist, 0, sizeof(dt->lat_hist));
+	}
+	dt->lat_enabled = enable;
+	spin_unlock_irqrestore(&dt->tod_lock, flags);
+
+	return count;
+}
+
+static const struct file_operations read_latency_fops = {
+	.owner = THIS_MODULE,
+	.open = read_latency_open,
+	.read = seq_read,
+	.write = read_latency_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static int dfl_tod_probe(struct dfl_device *ddev)
 {
 	struct device *dev = &ddev->dev;
 	struct dfl_tod *dt;
+	char name[32];
+	int ret;
 
 	dt = devm_kzalloc(dev, sizeof(*dt), GFP_KERNEL);
 	if (!dt)
@@ -306,6 +845,8 @@ static int dfl_tod_probe(struct dfl_device *ddev)
 
 	dt->dev = dev;
 	spin_lock_init(&dt->tod_lock);
+	hrtimer_init(&dt->adj_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dt->adj_timer.function = dfl_tod_adjust_timer;
 	dev_set_drvdata(dev, dt);
 
 	dev_info(&ddev->dev, "\tTOD Ctrl at 0x%08lx\n",
@@ -313,14 +854,34 @@ static int dfl_tod_probe(struct dfl_device *ddev)
 
 	/* Register the PTP clock driver to the kernel */
 	dt->ptp_clock_ops = dfl_tod_clock_ops;
+	dfl_tod_io_init(dt, ddev);
 
 	dt->ptp_clock = ptp_clock_register(&dt->ptp_clock_ops, dev);
 	if (IS_ERR(dt->ptp_clock)) {
 		dev_err(&ddev->dev, "Unable to register PTP clock\n");
+		ret = PTR_ERR(dt->ptp_clock);
 		dt->ptp_clock = NULL;
-		return PTR_ERR(dt->ptp_clock);
+		return ret;
+	}
+
+	/* Fall back to polling the events if there is no interrupt */
+	if (dt->io && ddev->num_irqs &&
+	    (dt->ptp_clock_ops.n_ext_ts || dt->ptp_clock_ops.pps)) {
+		ret = request_irq(ddev->irqs[0], dfl_tod_irq_handler, 0,
+				  dev_name(dev), dt);
+		if (ret)
+			dev_warn(dev, "failed to request irq %d, polling events\n",
+				 ddev->irqs[0]);
+		else
+			dt->irq = ddev->irqs[0];
 	}
 
+	snprintf(name, sizeof(name), "dfl_tod_ptp%d",
+		 ptp_clock_index(dt->ptp_clock));
+	dt->dbgfs = debugfs_create_dir(name, NULL);
+	debugfs_create_file("read_latency", 0600, dt->dbgfs, dt,
+			    &read_latency_fops);
+
 	return 0;
 }
 
@@ -328,11 +889,20 @@ static void dfl_tod_remove(struct dfl_device *ddev)
 {
 	struct dfl_tod *dt = dev_get_drvdata(&ddev->dev);
 
+	debugfs_remove_recursive(dt->dbgfs);
+
+	if (dt->io)
+		writel(0, dt->io + IO_IRQ_MASK);
+	if (dt->irq >= 0)
+		free_irq(dt->irq, dt);
+
 	/* Unregister the PTP clock driver from the kernel */
 	if (dt->ptp_clock) {
 		ptp_clock_unregister(dt->ptp_clock);
 		dt->ptp_clock = NULL;
 	}
+
+	hrtimer_cancel(&dt->adj_timer);
 }
 
 static const struct dfl_device_id dfl_tod_ids[] = {
@@ -32,23 +32,6 @@ struct dfl_uart {
 	int line;
 };
 
-static int dfh_get_u64_param_val(struct dfl_device *dfl_dev, int param_id, u64 *pval)
-{
-	size_t psize;
-	u64 *p;
-
-	p = dfh_find_param(dfl_dev, param_id, &psize);
-	if (IS_ERR(p))
-		return PTR_ERR(p);
-
-	if (psize != sizeof(*pval))
-		return -EINVAL;
-
-	*pval = *p;
-
-	return 0;
-}
-
 static int dfl_uart_get_params(struct dfl_device *dfl_dev, struct uart_8250_port *uart)
 {
 	struct device *dev = &dfl_dev->dev;
@@ -96,4 +96,5 @@ void dfl_driver_unregister(struct dfl_driver *dfl_drv);
 		      dfl_driver_unregister)
 
 void *dfh_find_param(struct dfl_device *dfl_dev, int param_id, size_t *pcount);
+int dfh_get_u64_param_val(struct dfl_device *dfl_dev, int param_id, u64 *pval);
 #endif /* __LINUX_DFL_H */
@@ -0,0 +1,94 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+/* HSSI MAC statistics header.
+ *
+ * Split out of s10hssi.c and n5010-hssi.c in 2026:
+ * Copyright (C) 2020 Intel Corporation. All rights reserved.
+ * Copyright (C) 2020 Silicom Denmark. All rights reserved.
+ */
+
+#ifndef __LINUX_HSSI_STATS_H
+#define __LINUX_HSSI_STATS_H
+
+#include <linux/ethtool.h>
+#include <linux/netdevice.h>
+#include <linux/regmap.h>
+#include <linux/version.h>
+
+#define HSSI_STATS_HIST_BUCKETS		7
+#define HSSI_STATS_HIST_MAX_LEN		9600
+
+/* Counters reported through rtnl and the standard ethtool stats groups */
+enum hssi_stats_std {
+	HSSI_STD_TX_UCAST,
+	HSSI_STD_TX_MCAST,
+	HSSI_STD_TX_BCAST,
+	HSSI_STD_RX_UCAST,
+	HSSI_STD_RX_MCAST,
+	HSSI_STD_RX_BCAST,
+	HSSI_STD_TX_OCTETS,
+	HSSI_STD_RX_OCTETS,
+	HSSI_STD_TX_PAUSE,
+	HSSI_STD_RX_PAUSE,
+	HSSI_STD_RX_CRC,
+	HSSI_STD_RX_UNDERSIZE,
+	HSSI_STD_RX_OVERSIZE,
+	HSSI_STD_RX_FRAGMENTS,
+	HSSI_STD_RX_JABBERS,
+	HSSI_STD_TX_HIST,
+	HSSI_STD_RX_HIST = HSSI_STD_TX_HIST + HSSI_STATS_HIST_BUCKETS,
+	HSSI_STD_MAX = HSSI_STD_RX_HIST + HSSI_STATS_HIST_BUCKETS,
+};
+
+/**
+ * struct hssi_stat_info - one 64-bit MAC counter
+ * @addr: register address of the low word, the high word follows it.
+ * @string: ethtool name of the counter.
+ */
+struct hssi_stat_info {
+	unsigned int addr;
+	char string[ETH_GSTRING_LEN];
+};
+
+#define HSSI_STAT_INFO(_addr, _string) \
+	.addr = _addr, .string = _string,
+
+/**
+ * struct hssi_stats_params - statistics block of a MAC
+ * @info: counters, in ethtool order.
+ * @num: number of counters in @info.
+ * @std_addr: address of each standard counter, 0 if the MAC has none.
+ * @latch: the MAC has shadow registers to latch the counters.
+ * @tx_clr_off: TX statistics control register.
+ * @rx_clr_off: RX statistics control register.
+ */
+struct hssi_stats_params {
+	const struct hssi_stat_info *info;
+	unsigned int num;
+	const unsigned int *std_addr;
+	bool latch;
+	u32 tx_clr_off;
+	u32 rx_clr_off;
+};
+
+struct hssi_stats;
+
+struct hssi_stats *devm_hssi_stats_init(struct device *dev,
+					struct regmap *regmap,
+					const struct hssi_stats_params *params);
+void hssi_stats_lock(struct hssi_stats *st);
+void hssi_stats_unlock(struct hssi_stats *st);
+void hssi_stats_read(struct hssi_stats *st, u64 *data);
+void hssi_stats_get_stats64(struct hssi_stats *st,
+			    struct rtnl_link_stats64 *stats);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+void hssi_stats_get_pause_stats(struct hssi_stats *st,
+				struct ethtool_pause_stats *pause_stats);
+void hssi_stats_get_eth_mac_stats(struct hssi_stats *st,
+				  struct ethtool_eth_mac_stats *mac_stats);
+void hssi_stats_get_rmon_stats(struct hssi_stats *st,
+			       struct ethtool_rmon_stats *rmon_stats,
+			       const struct ethtool_rmon_hist_range **ranges);
+#endif
+
+#endif //__LINUX_HSSI_STATS_H
@@ -7,11 +7,13 @@
 #ifndef __MFD_INTEL_M10_BMC_H
 #define __MFD_INTEL_M10_BMC_H
 
+#include <linux/atomic.h>
 #include <linux/bitfield.h>
 #include <linux/bits.h>
 #include <linux/dev_printk.h>
 #include <linux/regmap.h>
 #include <linux/rwsem.h>
+#include <linux/xarray.h>
 
 #define M10BMC_N3000_LEGACY_BUILD_VER	0x300468
 #define M10BMC_N3000_SYS_BASE		0x300800
@@ -336,6 +338,18 @@
 #define M10BMC_FLASH_INT_US			1
 #define M10BMC_FLASH_TIMEOUT_US			10000
 
+/*
+ * Time-to-live classes for the system register snapshot cache, in ms.
+ * Volatile registers (e.g. doorbell) always go to the bus, immutable ones
+ * (versions, MAC address) are read once until the cache is invalidated.
+ */
+#define M10BMC_SYS_TTL_VOLATILE			0
+#define M10BMC_SYS_TTL_SLOW			(10 * 1000)
+#define M10BMC_SYS_TTL_IMMUTABLE		UINT_MAX
+
+/* Nothing is cached for this long after an image reload is requested */
+#define M10BMC_SYS_CACHE_RELOAD_MS		(30 * 1000)
+
 /**
  * struct m10bmc_csr_map - Intel MAX 10 BMC CSR register map
  */
@@ -392,7 +406,8 @@ struct intel_m10bmc;
  * @unlock_write: unlock flash access
  *
  * Write must be protected with @lock_write and @unlock_write. While the flash
- * is locked, @read returns -EBUSY.
+ * is locked, @read may be served from data captured before the lock was
+ * taken; otherwise it returns -EBUSY.
  */
 struct intel_m10bmc_flash_bulk_ops {
 	int (*read)(struct intel_m10bmc *m10bmc, u8 *buf, u32 addr, u32 size);
@@ -414,6 +429,10 @@ enum m10bmc_fw_state {
  * @flash_bulk_ops: optional device specific operations for flash R/W
  * @bmcfw_lock: read/write semaphore to BMC firmware running state
  * @bmcfw_state: BMC firmware running state
+ * @flash_gen: flash generation count, bumped when flash contents may change
+ * @sys_cache: snapshot cache of system register values, indexed by offset
+ * @sys_cache_gen: bumped on each invalidation, protected by the sys_cache lock
+ * @sys_cache_hold: if set, jiffies until which nothing is stored in @sys_cache
  */
 struct intel_m10bmc {
 	struct device *dev;
@@ -422,6 +441,10 @@ struct intel_m10bmc {
 	const struct intel_m10bmc_flash_bulk_ops *flash_bulk_ops;
 	struct rw_semaphore bmcfw_lock;
 	enum m10bmc_fw_state bmcfw_state;
+	atomic_t flash_gen;
+	struct xarray sys_cache;
+	unsigned int sys_cache_gen;
+	unsigned long sys_cache_hold;
 };
 
 /*
@@ -429,7 +452,13 @@ struct intel_m10bmc {
  *
  * m10bmc_raw_read - read m10bmc register per addr
  * m10bmc_sys_read - read m10bmc system register per offset
+ * m10bmc_sys_read_cached - read m10bmc system register, accepting a cached
+ *			    value up to ttl_ms old
+ * m10bmc_sys_bulk_read - read count consecutive m10bmc system registers
  * m10bmc_sys_update_bits - update m10bmc system register per offset
+ * m10bmc_sys_cache_invalidate - drop all cached system register values
+ * m10bmc_sys_cache_reload - drop all cached values and stop caching while
+ *			     the BMC or FPGA reloads its image
  */
 static inline int
 m10bmc_raw_read(struct intel_m10bmc *m10bmc, unsigned int addr,
@@ -448,9 +477,19 @@ m10bmc_raw_read(struct intel_m10bmc *m10bmc, unsigned int addr,
 int m10bmc_sys_read(struct intel_m10bmc *m10bmc, unsigned int offset,
 		    unsigned int *val);
 
+int m10bmc_sys_read_cached(struct intel_m10bmc *m10bmc, unsigned int offset,
+			   unsigned int *val, unsigned int ttl_ms);
+
+int m10bmc_sys_bulk_read(struct intel_m10bmc *m10bmc, unsigned int offset,
+			 unsigned int *val, size_t count);
+
 int m10bmc_sys_update_bits(struct intel_m10bmc *m10bmc, unsigned int offset,
 			   unsigned int msk, unsigned int val);
 
+void m10bmc_sys_cache_invalidate(struct intel_m10bmc *m10bmc);
+
+void m10bmc_sys_cache_reload(struct intel_m10bmc *m10bmc);
+
 /*
  * Track the state of the firmware, as it is not available for
  * register handshakes during secure updates.
@@ -463,6 +502,27 @@ int m10bmc_fw_state_enter(struct intel_m10bmc *m10bmc,
 
 void m10bmc_fw_state_exit(struct intel_m10bmc *m10bmc);
 
+/*
+ * Flash generation count. Readers that cache flash contents compare the
+ * generation they cached against m10bmc_flash_gen() to detect updates.
+ * The count is bumped when a flash update takes the flash and again when
+ * it releases it, so an odd generation means an update is in progress.
+ */
+static inline unsigned int m10bmc_flash_gen(struct intel_m10bmc *m10bmc)
+{
+	return atomic_read(&m10bmc->flash_gen);
+}
+
+static inline bool m10bmc_flash_gen_busy(unsigned int gen)
+{
+	return gen & 1;
+}
+
+static inline void m10bmc_flash_gen_bump(struct intel_m10bmc *m10bmc)
+{
+	atomic_inc(&m10bmc->flash_gen);
+}
+
 /*
  * MAX10 BMC Core support
  */
@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Header File for the Silicom N5010 host datapath loopback model
+ *
+ * Copyright (C) 2020 Silicom Denmark A/S. All rights reserved.
+ */
+
+#ifndef __LINUX_N5010_DP_H
+#define __LINUX_N5010_DP_H
+
+#include <linux/netdevice.h>
+
+struct n5010_dp;
+
+/*
+ * The host datapath is a software loopback model for testing only, the
+ * hooks are no-ops unless it is enabled at build time.
+ */
+#if IS_ENABLED(CONFIG_N5010_DP_LOOPBACK)
+unsigned int n5010_dp_queues(void);
+struct n5010_dp *n5010_dp_create(struct device *dev, struct net_device *netdev);
+int n5010_dp_open(struct n5010_dp *dp);
+void n5010_dp_stop(struct n5010_dp *dp);
+netdev_tx_t n5010_dp_xmit(struct n5010_dp *dp, struct sk_buff *skb);
+void n5010_dp_get_stats64(struct n5010_dp *dp,
+			  struct rtnl_link_stats64 *stats);
+#else
+static inline unsigned int n5010_dp_queues(void)
+{
+	return 0;
+}
+
+static inline struct n5010_dp *n5010_dp_create(struct device *dev,
+					       struct net_device *netdev)
+{
+	return NULL;
+}
+
+static inline int n5010_dp_open(struct n5010_dp *dp)
+{
+	return 0;
+}
+
+static inline void n5010_dp_stop(struct n5010_dp *dp)
+{
+}
+
+static inline netdev_tx_t n5010_dp_xmit(struct n5010_dp *dp,
+					struct sk_buff *skb)
+{
+	dev_kfree_skb_any(skb);
+
+	return NETDEV_TX_OK;
+}
+
+static inline void n5010_dp_get_stats64(struct n5010_dp *dp,
+					struct rtnl_link_stats64 *stats)
+{
+}
+#endif
+
+#endif
@@ -31,6 +31,7 @@ enum qsfp_init_status {
  * @dev: point to device.
  * @init: qsfp init status.
  * @lock: lock for qsfp initial function and status.
+ * @poll_ms: current hotplug poll interval.
  */
 struct qsfp {
 	void __iomem *base;
@@ -39,6 +40,7 @@ struct qsfp {
 	struct device *dev;
 	enum qsfp_init_status init;
 	struct mutex lock;
+	unsigned int poll_ms;
 };
 
 int qsfp_init_work(struct qsfp *qsfp);
@@ -218,6 +218,155 @@ struct dfl_fpga_irq_set {
 					     DFL_PORT_BASE + 8,	\
 					     struct dfl_fpga_irq_set)
 
+/**
+ * struct dfl_fpga_irq_affinity - the argument for
+ *				  DFL_FPGA_XXX_SET_IRQ_AFFINITY ioctl.
+ *
+ * @index: Index of the irq.
+ * @cpu: CPU to route the irq to. A negative value restores the default
+ *	 routing to the CPUs local to the device.
+ */
+struct dfl_fpga_irq_affinity {
+	__u32 index;
+	__s32 cpu;
+};
+
+/**
+ * DFL_FPGA_PORT_UINT_SET_IRQ_AFFINITY - _IOW(DFL_FPGA_MAGIC, DFL_PORT_BASE + 9,
+ *					      struct dfl_fpga_irq_affinity)
+ *
+ * Route an fpga AFU interrupt to the given CPU, e.g. the one waiting on its
+ * eventfd. The setting is kept when the interrupt trigger is set again.
+ * Return: 0 on success, -errno on failure.
+ */
+#define DFL_FPGA_PORT_UINT_SET_IRQ_AFFINITY	_IOW(DFL_FPGA_MAGIC,	\
+						     DFL_PORT_BASE + 9,	\
+						     struct dfl_fpga_irq_affinity)
+
+/**
+ * struct dfl_fpga_irq_coalesce - the argument for
+ *				  DFL_FPGA_XXX_SET_IRQ_COALESCE ioctl.
+ *
+ * @index: Index of the irq.
+ * @max_events: Number of interrupts signalled to the eventfd at once. 0 or 1
+ *		signals every interrupt as it happens.
+ * @max_usecs: Max time in microseconds an interrupt may wait for others to
+ *	       be signalled with it. Required if @max_events is above 1.
+ */
+struct dfl_fpga_irq_coalesce {
+	__u32 index;
+	__u32 max_events;
+	__u32 max_usecs;
+};
+
+/**
+ * DFL_FPGA_PORT_UINT_SET_IRQ_COALESCE - _IOW(DFL_FPGA_MAGIC, DFL_PORT_BASE + 10,
+ *					      struct dfl_fpga_irq_coalesce)
+ *
+ * Coalesce the signals of an fpga AFU interrupt. The eventfd counter is
+ * still incremented once per interrupt, but readers are woken up once per
+ * batch. The interrupt is not masked until the batch is consumed, the AFU
+ * may keep raising it and the following interrupts start the next batch.
+ * The setting is kept when the interrupt trigger is set again.
+ * Return: 0 on success, -errno on failure.
+ */
+#define DFL_FPGA_PORT_UINT_SET_IRQ_COALESCE	_IOW(DFL_FPGA_MAGIC,	\
+						     DFL_PORT_BASE + 10, \
+						     struct dfl_fpga_irq_coalesce)
+
+/**
+ * struct dfl_fpga_irq_ring_hdr - header of an irq completion ring.
+ *
+ * @head: Index of the next record written by the kernel.
+ * @tail: Index of the next record to be consumed, written by userspace.
+ * @mask: Number of records in the ring minus one.
+ * @overflow: Number of records dropped because the ring was full.
+ *
+ * The records follow the header. Record n is at index (n & @mask), and
+ * records from @tail up to @head are valid. @head and @tail wrap at 2^32.
+ */
+struct dfl_fpga_irq_ring_hdr {
+	__u32 head;
+	__u32 tail;
+	__u32 mask;
+	__u32 overflow;
+};
+
+/**
+ * struct dfl_fpga_irq_ring_rec - record of an irq completion ring.
+ *
+ * @index: Index of the irq which fired.
+ * @count: Number of interrupts signalled by this record.
+ * @timestamp: CLOCK_MONOTONIC time of the signal in nanoseconds.
+ */
+struct dfl_fpga_irq_ring_rec {
+	__u32 index;
+	__u32 count;
+	__u64 timestamp;
+};
+
+/**
+ * DFL_FPGA_PORT_UINT_SET_IRQ_RING - _IOWR(DFL_FPGA_MAGIC, DFL_PORT_BASE + 11,
+ *					     struct dfl_fpga_irq_ring)
+ *
+ * Create a completion ring for the fpga AFU interrupts, or remove it if
+ * entries is 0. While the ring exists, every signal of an interrupt
+ * trigger also appends a record to the ring, so passing the same eventfd
+ * for all interrupts in DFL_FPGA_PORT_UINT_SET_IRQ gives a single wakeup
+ * fd for all of them. The ring can only be changed while no interrupt
+ * trigger is set. Driver fills the mmap offset and size of the ring.
+ * Return: 0 on success, -errno on failure.
+ */
+struct dfl_fpga_irq_ring {
+	/* Input */
+	__u32 argsz;		/* Structure length */
+	__u32 flags;		/* Zero for now */
+	__u32 entries;		/* Number of records, a power of 2 */
+	__u32 padding;
+	/* Output */
+	__u64 offset;		/* Ring offset from start of device fd */
+	__u64 size;		/* Ring size (bytes) */
+};
+
+#define DFL_FPGA_PORT_UINT_SET_IRQ_RING	_IO(DFL_FPGA_MAGIC, DFL_PORT_BASE + 11)
+
+/**
+ * struct dfl_fpga_irq_status - status of an irq in the busy-poll page.
+ *
+ * @count: Number of interrupts raised, updated from the hard irq handler
+ *	   before the eventfd is signalled. Read it with acquire semantics.
+ * @padding: Reserved.
+ * @timestamp: CLOCK_MONOTONIC time of the last interrupt in nanoseconds.
+ */
+struct dfl_fpga_irq_status {
+	__u32 count;
+	__u32 padding;
+	__u64 timestamp;
+};
+
+/**
+ * DFL_FPGA_PORT_UINT_GET_POLL_INFO - _IOR(DFL_FPGA_MAGIC, DFL_PORT_BASE + 12,
+ *					   struct dfl_fpga_irq_poll_info)
+ *
+ * Get the location of the read-only busy-poll page of the fpga AFU
+ * interrupts. The page holds one struct dfl_fpga_irq_status per irq, so a
+ * thread can spin on the count of an irq and only block on its eventfd
+ * once its own polling budget is exhausted.
+ * Return: 0 on success, -errno on failure.
+ */
+struct dfl_fpga_irq_poll_info {
+	/* Input */
+	__u32 argsz;		/* Structure length */
+	/* Output */
+	__u32 flags;		/* Zero for now */
+	__u32 num;		/* Number of irqs with a status entry */
+	__u32 padding;
+	__u64 offset;		/* Page offset from start of device fd */
+	__u64 size;		/* Page size (bytes) */
+};
+
+#define DFL_FPGA_PORT_UINT_GET_POLL_INFO	_IO(DFL_FPGA_MAGIC, DFL_PORT_BASE + 12)
+
 /* IOCTLs for FME file descriptor */
 
 /**
@@ -284,4 +433,39 @@ struct dfl_fpga_fme_port_pr {
 					     DFL_FME_BASE + 4,	\
 					     struct dfl_fpga_irq_set)
 
+/*
+ * DFL enumeration snapshot
+ *
+ * When the dfl module is loaded with snapshot=1, every word of the Device
+ * Feature Lists read during enumeration is recorded. The result is exposed
+ * by the "dfl_snapshot" binary attribute of the FPGA region created for the
+ * device, in the following layout:
+ *
+ *   struct dfl_snapshot_header
+ *   struct dfl_snapshot_dfl	[nr_dfls]	enumerated DFL regions
+ *   struct dfl_snapshot_word	[nr_words]	words read, sorted by addr
+ *
+ * Addresses are MMIO bus addresses. Words which were not read during
+ * enumeration (e.g. feature CSRs) are not part of the snapshot.
+ */
+#define DFL_SNAPSHOT_MAGIC	0x534c4644	/* "DFLS" */
+#define DFL_SNAPSHOT_VERSION	1
+
+struct dfl_snapshot_header {
+	__u32 magic;
+	__u32 version;
+	__u32 nr_dfls;
+	__u32 nr_words;
+};
+
+struct dfl_snapshot_dfl {
+	__u64 start;
+	__u64 len;
+};
+
+struct dfl_snapshot_word {
+	__u64 addr;
+	__u64 val;
+};
+
 #endif /* _UAPI_LINUX_FPGA_DFL_H */
@@ -39,11 +39,18 @@
  * Upload a data buffer to the target device. The user must provide the
  * data buffer, size, and an eventfd file descriptor.
  *
+ * By default the data buffer is copied into the kernel before the upload
+ * starts. With FPGA_IMAGE_WRITE_PIN_USER_BUF, the user pages are pinned
+ * and streamed to the device in place; the buffer must then stay mapped
+ * and unmodified until the eventfd is signalled.
+ *
  * Return: 0 on success, -errno on failure.
  */
+#define FPGA_IMAGE_WRITE_PIN_USER_BUF	(1 << 0)
+
 struct fpga_image_write {
 	/* Input */
-	__u32 flags;		/* Zero for now */
+	__u32 flags;		/* FPGA_IMAGE_WRITE_* flags */
 	__u32 size;		/* Data size (in bytes) to be written */
 	__s32 evtfd;		/* File descriptor for completion signal */
 	__u64 buf;		/* User space address of source data */
@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Benchmark the DFL enumeration on synthetic cards
+ *
+ * Usage: dfl-bench [-n CARDS] [-s SEED] [-S] [SCENARIO...]
+ *
+ * Each scenario generates CARDS synthetic DFLs of a given shape, enumerates
+ * them with the DFL framework and reports the time spent in
+ * dfl_fpga_feature_devs_enumerate() and the MMIO reads it issued. With -S
+ * the enumeration snapshot is recorded as well, as with snapshot=1.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dfl_harness.h"
+
+#define BENCH_DFL_START		0x90000000ULL
+
+struct bench_scenario {
+	const char *name;
+	const char *desc;
+	struct dfl_gen_params p;
+	bool mixed;
+};
+
+static const struct bench_scenario scenarios[] = {
+	{
+		.name = "v0",
+		.desc = "DFHv0 only, FME and one port",
+		.p = { .nr_ports = 1, .nr_features = 8, .afu = true },
+	}, {
+		.name = "v1",
+		.desc = "DFHv1 only, small parameter blocks",
+		.p = { .nr_ports = 1, .nr_features = 8, .v1_percent = 100,
+		       .nr_params = 4, .param_words = 2, .afu = true },
+	}, {
+		.name = "params",
+		.desc = "DFHv1 only, large parameter blocks",
+		.p = { .nr_ports = 1, .nr_features = 8, .v1_percent = 100,
+		       .nr_params = 64, .param_words = 32, .afu = true },
+	}, {
+		.name = "deep",
+		.desc = "long chains of features and interfaces",
+		.p = { .nr_ports = 4, .nr_features = 256, .v1_percent = 50,
+		       .nr_params = 2, .param_words = 1, .nr_interfaces = 4 },
+	}, {
+		.name = "mixed",
+		.desc = "random shape per card",
+		.mixed = true,
+	},
+};
+
+static uint32_t bench_rand(unsigned int *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+/* shape of a "mixed" card, drawn from the card seed */
+static void bench_mixed(struct dfl_gen_params *p, unsigned int seed)
+{
+	unsigned int r = seed ? seed : 1;
+
+	p->nr_ports = bench_rand(&r) % 5;
+	p->nr_features = bench_rand(&r) % 64;
+	p->v1_percent = bench_rand(&r) % 101;
+	p->nr_params = bench_rand(&r) % 16;
+	p->param_words = bench_rand(&r) % 16;
+	p->nr_interfaces = bench_rand(&r) % 3;
+	p->afu = bench_rand(&r) % 2;
+}
+
+static int bench_run(const struct bench_scenario *s, unsigned int cards,
+		     unsigned int seed, unsigned int flags)
+{
+	unsigned long long features = 0, fdevs = 0, ns = 0, reads = 0;
+	struct dfl_enum_result res;
+	struct dfl_gen_params p;
+	struct dfl_region dfl;
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < cards; i++) {
+		p = s->p;
+		p.seed = seed + i;
+		if (s->mixed)
+			bench_mixed(&p, p.seed);
+
+		ret = dfl_gen(&p, BENCH_DFL_START, &dfl);
+		if (ret) {
+			fprintf(stderr, "%s: card %u: generation failed: %s\n",
+				s->name, i, strerror(-ret));
+			break;
+		}
+
+		dfl_mmio_reads = 0;
+		ret = dfl_enumerate(&dfl, 1, flags, &res);
+		dfl_mmio_reset();
+		if (ret) {
+			fprintf(stderr, "%s: card %u: enumeration failed: %s\n",
+				s->name, i, strerror(-ret));
+			break;
+		}
+
+		fdevs += res.nr_fdevs;
+		features += res.nr_features;
+		ns += res.enum_ns;
+		reads += dfl_mmio_reads;
+		dfl_enum_result_free(&res);
+	}
+
+	if (!i)
+		return ret;
+
+	printf("%-8s %6u cards %8.1f fdevs %9.1f features %10.2f us/card %8.1f ns/feature %9.1f reads/card\n",
+	       s->name, i, (double)fdevs / i, (double)features / i,
+	       ns / 1000.0 / i, features ? (double)ns / features : 0.0,
+	       (double)reads / i);
+
+	return ret;
+}
+
+static void usage(const char *prog)
+{
+	unsigned int i;
+
+	fprintf(stderr, "usage: %s [-n CARDS] [-s SEED] [-S] [SCENARIO...]\n\n",
+		prog);
+	for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+		fprintf(stderr, "  %-8s %s\n", scenarios[i].name,
+			scenarios[i].desc);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int cards = 1000, seed = 1, flags = 0, i;
+	const struct bench_scenario *s;
+	int ret, c;
+
+	while ((c = getopt(argc, argv, "n:s:S")) != -1) {
+		switch (c) {
+		case 'n':
+			cards = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			flags |= DFL_ENUM_SNAPSHOT;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	dfl_harness_verbose = DFL_LOG_ERR;
+
+	ret = dfl_harness_init();
+	if (ret) {
+		fprintf(stderr, "harness init failed: %s\n", strerror(-ret));
+		return 1;
+	}
+
+	if (optind == argc) {
+		for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]) && !ret;
+		     i++)
+			ret = bench_run(&scenarios[i], cards, seed, flags);
+		goto out;
+	}
+
+	for (; optind < argc && !ret; optind++) {
+		for (s = NULL, i = 0;
+		     i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+			if (!strcmp(argv[optind], scenarios[i].name))
+				s = &scenarios[i];
+
+		if (!s) {
+			usage(argv[0]);
+			ret = -EINVAL;
+			break;
+		}
+
+		ret = bench_run(s, cards, seed, flags);
+	}
+
+out:
+	if (dfl_harness_warnings)
+		fprintf(stderr, "%lu warnings\n", dfl_harness_warnings);
+
+	dfl_harness_exit();
+
+	return ret || dfl_harness_warnings ? 1 : 0;
+}
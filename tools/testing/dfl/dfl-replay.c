@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Replay the DFL enumeration of a card from its enumeration snapshot
+ *
+ * Usage: dfl-replay [-v] SNAPSHOT
+ *
+ * SNAPSHOT is a copy of the dfl_snapshot attribute of the FPGA region of a
+ * card enumerated with the dfl module parameter snapshot=1. The feature
+ * devices and sub features the DFL framework creates from it are printed,
+ * and the snapshot recorded during the replay is checked against the
+ * original one.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dfl_harness.h"
+
+static void *read_file(const char *path, size_t *size)
+{
+	size_t len = 0, max = 0;
+	char *buf = NULL, *p;
+	FILE *f;
+	size_t n;
+
+	f = fopen(path, "rb");
+	if (!f)
+		return NULL;
+
+	do {
+		if (len == max) {
+			max = max ? max * 2 : 65536;
+			p = realloc(buf, max);
+			if (!p) {
+				free(buf);
+				buf = NULL;
+				break;
+			}
+			buf = p;
+		}
+		n = fread(buf + len, 1, max - len, f);
+		len += n;
+	} while (n);
+
+	if (buf && ferror(f)) {
+		free(buf);
+		buf = NULL;
+	}
+
+	fclose(f);
+	*size = len;
+
+	return buf;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-v] SNAPSHOT\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	struct dfl_enum_result res;
+	struct dfl_region *dfls;
+	unsigned int nr_dfls;
+	size_t size;
+	void *snap;
+	int ret, c;
+
+	while ((c = getopt(argc, argv, "v")) != -1) {
+		switch (c) {
+		case 'v':
+			dfl_harness_verbose++;
+			break;
+		default:
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	snap = read_file(argv[optind], &size);
+	if (!snap) {
+		fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+		return 1;
+	}
+
+	ret = dfl_harness_init();
+	if (ret)
+		goto out;
+
+	ret = dfl_snapshot_load(snap, size, &dfls, &nr_dfls);
+	if (ret) {
+		fprintf(stderr, "%s: not a valid DFL snapshot\n", argv[optind]);
+		goto exit;
+	}
+
+	ret = dfl_enumerate(dfls, nr_dfls, DFL_ENUM_SNAPSHOT | DFL_ENUM_DESCRIBE,
+			    &res);
+	free(dfls);
+	if (ret) {
+		fprintf(stderr, "enumeration failed: %s\n", strerror(-ret));
+		goto exit;
+	}
+
+	fputs(res.desc, stdout);
+	printf("%u feature devices, %u sub features, %llu MMIO reads in %llu usecs\n",
+	       res.nr_fdevs, res.nr_features, dfl_mmio_reads,
+	       (unsigned long long)res.enum_ns / 1000);
+
+	/* the replay must read exactly what the card enumeration read */
+	if (res.snapshot_size != size || memcmp(res.snapshot, snap, size)) {
+		fprintf(stderr, "replay read different words than the snapshot recorded\n");
+		ret = -EIO;
+	}
+
+	dfl_enum_result_free(&res);
+exit:
+	dfl_harness_exit();
+out:
+	free(snap);
+	return ret ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Synthetic Device Feature Lists
+ *
+ * Lays out one DFL with an FME and a number of ports, each followed by a
+ * chain of private features with DFHv0 or DFHv1 headers, DFHv1 parameter
+ * blocks and interface DFHs, the way the DFL specification allows a card
+ * to, and maps it into the memory-backed MMIO space of the harness.
+ */
+
+#include <linux/kernel.h>
+
+#include "../../../drivers/fpga/dfl.h"
+
+#define GEN_FEATURE_ALIGN	0x1000
+#define GEN_FIU_SIZE		0x1000
+#define GEN_INTERFACE_SIZE	0x40
+#define GEN_AFU_SIZE		0x40000
+
+struct dfl_gen {
+	const struct dfl_gen_params *p;
+	u64 *buf;
+	size_t size;
+	size_t len;
+	u32 rnd;
+	bool has_last;
+	size_t last;
+	size_t last_size;
+};
+
+static u32 gen_rand(struct dfl_gen *g)
+{
+	/* xorshift32, the seed only has to be non zero */
+	g->rnd ^= g->rnd << 13;
+	g->rnd ^= g->rnd >> 17;
+	g->rnd ^= g->rnd << 5;
+
+	return g->rnd;
+}
+
+static u64 gen_rand64(struct dfl_gen *g)
+{
+	return (u64)gen_rand(g) << 32 | gen_rand(g);
+}
+
+/* reserve @len bytes at @align, returns the offset of the block or -ENOMEM */
+static ssize_t gen_alloc(struct dfl_gen *g, size_t len, size_t align)
+{
+	size_t ofst = (g->len + align - 1) & ~(align - 1);
+	size_t size;
+	u64 *buf;
+
+	if (ofst + len > g->size) {
+		size = max(g->size * 2, ofst + len);
+		buf = realloc(g->buf, size);
+		if (!buf)
+			return -ENOMEM;
+
+		memset((char *)buf + g->size, 0, size - g->size);
+		g->buf = buf;
+		g->size = size;
+	}
+
+	g->len = ofst + len;
+
+	return ofst;
+}
+
+static void gen_put(struct dfl_gen *g, size_t ofst, u64 v)
+{
+	g->buf[ofst / sizeof(u64)] = v;
+}
+
+/* chain a new DFH of @size bytes at @ofst to the previous one */
+static void gen_link(struct dfl_gen *g, size_t ofst, size_t size)
+{
+	if (g->has_last)
+		g->buf[g->last / sizeof(u64)] |=
+			FIELD_PREP(DFH_NEXT_HDR_OFST, ofst - g->last);
+
+	g->has_last = true;
+	g->last = ofst;
+	g->last_size = size;
+}
+
+static void gen_guid(struct dfl_gen *g, size_t ofst)
+{
+	gen_put(g, ofst + GUID_L, gen_rand64(g));
+	gen_put(g, ofst + GUID_H, gen_rand64(g));
+}
+
+static ssize_t gen_fiu(struct dfl_gen *g, u16 id)
+{
+	ssize_t ofst = gen_alloc(g, GEN_FIU_SIZE, GEN_FEATURE_ALIGN);
+
+	if (ofst < 0)
+		return ofst;
+
+	gen_put(g, ofst + DFH, FIELD_PREP(DFH_TYPE, DFH_TYPE_FIU) |
+			       FIELD_PREP(DFH_ID, id));
+	gen_guid(g, ofst);
+	gen_link(g, ofst, GEN_FIU_SIZE);
+
+	if (id == DFH_ID_FIU_PORT && g->p->afu)
+		gen_put(g, ofst + PORT_HDR_CAP,
+			FIELD_PREP(PORT_CAP_MMIO_SIZE, GEN_AFU_SIZE >> 10));
+
+	return ofst;
+}
+
+/* irq capability registers of the DFHv0 features which have interrupts */
+static void gen_v0_irqs(struct dfl_gen *g, size_t ofst, u16 fiu, u16 id)
+{
+	u32 nr = 1 + gen_rand(g) % 4;
+	u32 base = gen_rand(g) % (DFL_HARNESS_NR_IRQS - nr + 1);
+
+	if (fiu == DFH_ID_FIU_PORT && id == PORT_FEATURE_ID_UINT)
+		gen_put(g, ofst + PORT_UINT_CAP,
+			FIELD_PREP(PORT_UINT_CAP_FST_VECT, base) |
+			FIELD_PREP(PORT_UINT_CAP_INT_NUM, nr));
+	else if (fiu == DFH_ID_FIU_PORT && id == PORT_FEATURE_ID_ERROR)
+		gen_put(g, ofst + PORT_ERROR_CAP,
+			FIELD_PREP(PORT_ERROR_CAP_INT_VECT, base) |
+			PORT_ERROR_CAP_SUPP_INT);
+	else if (fiu == DFH_ID_FIU_FME && id == FME_FEATURE_ID_GLOBAL_ERR)
+		gen_put(g, ofst + FME_ERROR_CAP,
+			FIELD_PREP(FME_ERROR_CAP_INT_VECT, base) |
+			FME_ERROR_CAP_SUPP_INT);
+}
+
+/* the parameter block of a DFHv1 feature, the first may be an MSI-X one */
+static void gen_v1_params(struct dfl_gen *g, size_t ofst)
+{
+	const struct dfl_gen_params *p = g->p;
+	size_t pos = ofst + DFHv1_PARAM_HDR;
+	u32 nr, base, i, j;
+	u64 hdr;
+
+	for (i = 0; i < p->nr_params; i++) {
+		hdr = FIELD_PREP(DFHv1_PARAM_HDR_NEXT_OFFSET, 1 + p->param_words);
+		if (i == p->nr_params - 1)
+			hdr |= DFHv1_PARAM_HDR_NEXT_EOP;
+
+		if (!i && p->param_words && gen_rand(g) % 2) {
+			nr = 1 + gen_rand(g) % 8;
+			base = gen_rand(g) % (DFL_HARNESS_NR_IRQS - nr + 1);
+			gen_put(g, pos, hdr | FIELD_PREP(DFHv1_PARAM_HDR_ID,
+							 DFHv1_PARAM_ID_MSI_X));
+			gen_put(g, pos + DFHv1_PARAM_DATA,
+				FIELD_PREP(DFHv1_PARAM_MSI_X_STARTV, base) |
+				FIELD_PREP(DFHv1_PARAM_MSI_X_NUMV, nr));
+			j = 1;
+		} else {
+			gen_put(g, pos, hdr | FIELD_PREP(DFHv1_PARAM_HDR_ID,
+							 0x100 + i));
+			j = 0;
+		}
+
+		for (; j < p->param_words; j++)
+			gen_put(g, pos + DFHv1_PARAM_DATA + j * sizeof(u64),
+				gen_rand64(g));
+
+		pos += (1 + p->param_words) * sizeof(u64);
+	}
+}
+
+static int gen_private(struct dfl_gen *g, u16 fiu)
+{
+	static const u16 fme_ids[] = { 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x20 };
+	static const u16 port_ids[] = { 0x10, 0x11, 0x12, 0x13, 0x14, 0x20 };
+	const struct dfl_gen_params *p = g->p;
+	bool v1 = gen_rand(g) % 100 < p->v1_percent;
+	size_t size = GEN_FEATURE_ALIGN, psize;
+	ssize_t ofst;
+	unsigned int i;
+	u16 id;
+	u64 v;
+
+	if (fiu == DFH_ID_FIU_FME)
+		id = fme_ids[gen_rand(g) % ARRAY_SIZE(fme_ids)];
+	else
+		id = port_ids[gen_rand(g) % ARRAY_SIZE(port_ids)];
+
+	if (v1) {
+		psize = p->nr_params * (1 + p->param_words) * sizeof(u64);
+		size = ALIGN(DFHv1_PARAM_HDR + psize + sizeof(u64),
+			     GEN_FEATURE_ALIGN);
+	}
+
+	ofst = gen_alloc(g, size, GEN_FEATURE_ALIGN);
+	if (ofst < 0)
+		return ofst;
+
+	v = FIELD_PREP(DFH_TYPE, DFH_TYPE_PRIVATE) | FIELD_PREP(DFH_ID, id) |
+	    FIELD_PREP(DFH_REVISION, gen_rand(g));
+	if (v1) {
+		v |= FIELD_PREP(DFH_VERSION, 1);
+		gen_guid(g, ofst);
+		/* registers right after the DFH, relative to it */
+		gen_put(g, ofst + DFHv1_CSR_ADDR, 0);
+		gen_put(g, ofst + DFHv1_CSR_SIZE_GRP,
+			FIELD_PREP(DFHv1_CSR_SIZE_GRP_SIZE, size) |
+			FIELD_PREP(DFHv1_CSR_SIZE_GRP_INSTANCE_ID, gen_rand(g)) |
+			(p->nr_params ? DFHv1_CSR_SIZE_GRP_HAS_PARAMS : 0));
+		gen_v1_params(g, ofst);
+	} else {
+		gen_v0_irqs(g, ofst, fiu, id);
+	}
+
+	gen_put(g, ofst + DFH, v);
+	gen_link(g, ofst, size);
+
+	/* interfaces extend the feature they follow */
+	for (i = 0; i < p->nr_interfaces; i++) {
+		ofst = gen_alloc(g, GEN_INTERFACE_SIZE, sizeof(u64));
+		if (ofst < 0)
+			return ofst;
+
+		gen_put(g, ofst + DFH,
+			FIELD_PREP(DFH_TYPE, DFH_TYPE_INTERFACE) |
+			FIELD_PREP(DFH_ID, i));
+		gen_link(g, ofst, GEN_INTERFACE_SIZE);
+	}
+
+	return 0;
+}
+
+static int gen_fiu_features(struct dfl_gen *g, u16 fiu)
+{
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < g->p->nr_features; i++) {
+		ret = gen_private(g, fiu);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int dfl_gen(const struct dfl_gen_params *p, uint64_t start,
+	    struct dfl_region *dfl)
+{
+	struct dfl_gen g = { .p = p, .rnd = p->seed ? p->seed : 1 };
+	ssize_t ports[MAX_DFL_FPGA_PORT_NUM], ofst;
+	unsigned int i;
+	void *mem;
+	int ret;
+
+	if (p->nr_ports > MAX_DFL_FPGA_PORT_NUM)
+		return -EINVAL;
+
+	ofst = gen_fiu(&g, DFH_ID_FIU_FME);
+	ret = ofst < 0 ? ofst : gen_fiu_features(&g, DFH_ID_FIU_FME);
+
+	for (i = 0; i < p->nr_ports && !ret; i++) {
+		ports[i] = gen_fiu(&g, DFH_ID_FIU_PORT);
+		ret = ports[i] < 0 ? ports[i] :
+				     gen_fiu_features(&g, DFH_ID_FIU_PORT);
+	}
+	if (ret)
+		goto out;
+
+	/* the last DFH ends the list */
+	gen_put(&g, g.last, g.buf[g.last / sizeof(u64)] | DFH_EOL |
+		FIELD_PREP(DFH_NEXT_HDR_OFST, g.last_size));
+
+	/* AFUs are outside of the list, behind it */
+	for (i = 0; p->afu && i < p->nr_ports; i++) {
+		ofst = gen_alloc(&g, GEN_AFU_SIZE, GEN_AFU_SIZE);
+		if (ofst < 0) {
+			ret = ofst;
+			goto out;
+		}
+
+		if (ofst - ports[i] > NEXT_AFU_NEXT_DFH_OFST) {
+			ret = -E2BIG;
+			goto out;
+		}
+
+		gen_put(&g, ofst + DFH, FIELD_PREP(DFH_TYPE, DFH_TYPE_AFU));
+		gen_guid(&g, ofst);
+		gen_put(&g, ports[i] + NEXT_AFU,
+			FIELD_PREP(NEXT_AFU_NEXT_DFH_OFST, ofst - ports[i]));
+	}
+
+	mem = dfl_mmio_map(start, g.len);
+	if (!mem) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	memcpy(mem, g.buf, g.len);
+	dfl->start = start;
+	dfl->len = g.len;
+out:
+	free(g.buf);
+	return ret;
+}
@@ -0,0 +1,129 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * User space harness for the DFL enumeration code of drivers/fpga/dfl.c
+ *
+ * The DFL framework is built against a memory-backed MMIO space: ranges of
+ * bus addresses are backed by host memory with dfl_mmio_map(), and the
+ * framework maps and reads them as it would map and read a card's BARs.
+ * The MMIO space can be filled from an enumeration snapshot of a real card
+ * (the dfl_snapshot attribute of its FPGA region) or with synthetic DFLs.
+ */
+
+#ifndef _DFL_HARNESS_H
+#define _DFL_HARNESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* levels of dfl_harness_verbose, messages above the level are dropped */
+#define DFL_LOG_ERR		0
+#define DFL_LOG_WARN		1
+#define DFL_LOG_INFO		2
+#define DFL_LOG_DEBUG		3
+
+extern int dfl_harness_verbose;
+
+/* number of WARN_ON()s hit by the framework */
+extern unsigned long dfl_harness_warnings;
+
+/* 64-bit MMIO reads issued, including the words of bulk copies */
+extern unsigned long long dfl_mmio_reads;
+
+/* Back the bus addresses [start, start + len) with zeroed memory */
+void *dfl_mmio_map(uint64_t start, uint64_t len);
+int dfl_mmio_write(uint64_t addr, uint64_t val);
+void dfl_mmio_reset(void);
+
+struct dfl_region {
+	uint64_t start;
+	uint64_t len;
+};
+
+/* IRQs handed to the framework, as a PCIe card with MSI-X vectors would */
+#define DFL_HARNESS_NR_IRQS	64
+
+/* enumeration flags */
+#define DFL_ENUM_SNAPSHOT	0x1	/* record a snapshot, as snapshot=1 */
+#define DFL_ENUM_DESCRIBE	0x2	/* describe the feature devices */
+
+/**
+ * struct dfl_enum_result - outcome of one enumeration
+ * @nr_fdevs: number of feature devices created.
+ * @nr_features: number of sub features of all feature devices.
+ * @desc: text description of the feature devices and their sub features,
+ *	  with DFL_ENUM_DESCRIBE.
+ * @snapshot: snapshot recorded during enumeration, with DFL_ENUM_SNAPSHOT.
+ * @snapshot_size: size of @snapshot in bytes.
+ * @enum_ns: time spent in dfl_fpga_feature_devs_enumerate().
+ */
+struct dfl_enum_result {
+	unsigned int nr_fdevs;
+	unsigned int nr_features;
+	char *desc;
+	void *snapshot;
+	size_t snapshot_size;
+	uint64_t enum_ns;
+};
+
+/* must be called once before any enumeration */
+int dfl_harness_init(void);
+void dfl_harness_exit(void);
+
+/*
+ * Enumerate the DFLs in @dfls, the same way a card driver hands them to
+ * dfl_fpga_feature_devs_enumerate(), then tear everything down again.
+ * Returns 0 or the negative error code of the enumeration.
+ */
+int dfl_enumerate(const struct dfl_region *dfls, unsigned int nr_dfls,
+		  unsigned int flags, struct dfl_enum_result *res);
+void dfl_enum_result_free(struct dfl_enum_result *res);
+
+/*
+ * Map the DFLs of a snapshot and fill them with its words. The DFL regions
+ * are returned in a malloc'ed array in @dfls. On error the MMIO space may be
+ * partially mapped, see dfl_mmio_reset().
+ */
+int dfl_snapshot_load(const void *buf, size_t size, struct dfl_region **dfls,
+		      unsigned int *nr_dfls);
+
+/**
+ * struct dfl_gen_params - shape of a synthetic card
+ * @seed: seed of the pseudo random choices.
+ * @nr_ports: number of port FIUs following the FME, at most
+ *	      MAX_DFL_FPGA_PORT_NUM (4).
+ * @nr_features: private features chained after each FIU header.
+ * @v1_percent: share of features with a DFHv1 header, in percent.
+ * @nr_params: parameters in the parameter block of each DFHv1 feature.
+ * @param_words: data words of each parameter.
+ * @nr_interfaces: interface DFHs chained after each private feature.
+ * @afu: give each port an AFU through its NEXT_AFU register.
+ */
+struct dfl_gen_params {
+	unsigned int seed;
+	unsigned int nr_ports;
+	unsigned int nr_features;
+	unsigned int v1_percent;
+	unsigned int nr_params;
+	unsigned int param_words;
+	unsigned int nr_interfaces;
+	bool afu;
+};
+
+/*
+ * Build a synthetic DFL at bus address @start into a newly mapped MMIO
+ * range, and return the DFL region in @dfl. Returns -E2BIG if the list is
+ * too long for the NEXT_AFU register of the ports to reach their AFUs.
+ */
+int dfl_gen(const struct dfl_gen_params *p, uint64_t start,
+	    struct dfl_region *dfl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DFL_HARNESS_H */
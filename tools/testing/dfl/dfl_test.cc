@@ -0,0 +1,319 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Tests of the DFL enumeration of drivers/fpga/dfl.c on synthetic cards
+ * and on their enumeration snapshots.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dfl_harness.h"
+
+#define DFL_START	0x90000000ULL
+
+/* layout of the snapshot, see include/uapi/linux/fpga-dfl.h */
+#define SNAP_MAGIC	0x534c4644
+#define SNAP_HDR_SIZE	16
+#define SNAP_DFL_SIZE	16
+#define SNAP_WORD_SIZE	16
+
+struct snap_word {
+	uint64_t addr;
+	uint64_t val;
+};
+
+class DflTest : public ::testing::Test {
+protected:
+	static void SetUpTestSuite()
+	{
+		dfl_harness_verbose = -1;
+		ASSERT_EQ(dfl_harness_init(), 0);
+	}
+
+	static void TearDownTestSuite()
+	{
+		dfl_harness_exit();
+	}
+
+	void SetUp() override
+	{
+		memset(&res_, 0, sizeof(res_));
+		dfl_harness_warnings = 0;
+	}
+
+	void TearDown() override
+	{
+		dfl_enum_result_free(&res_);
+		dfl_mmio_reset();
+		EXPECT_EQ(dfl_harness_warnings, 0UL);
+	}
+
+	int Enumerate(const struct dfl_gen_params &p, unsigned int flags)
+	{
+		struct dfl_region dfl;
+		int ret;
+
+		ret = dfl_gen(&p, DFL_START, &dfl);
+		if (ret)
+			return ret;
+
+		dfl_enum_result_free(&res_);
+		return dfl_enumerate(&dfl, 1, flags, &res_);
+	}
+
+	std::string Desc() const
+	{
+		return res_.desc ? res_.desc : "";
+	}
+
+	std::vector<uint8_t> Snapshot() const
+	{
+		const uint8_t *p = static_cast<const uint8_t *>(res_.snapshot);
+
+		return std::vector<uint8_t>(p, p + res_.snapshot_size);
+	}
+
+	struct dfl_enum_result res_;
+};
+
+TEST_F(DflTest, FmeOnly)
+{
+	struct dfl_gen_params p = {};
+
+	p.seed = 1;
+	p.nr_features = 3;
+
+	ASSERT_EQ(Enumerate(p, DFL_ENUM_DESCRIBE), 0);
+	EXPECT_EQ(res_.nr_fdevs, 1U);
+	/* the FIU header is a sub feature as well */
+	EXPECT_EQ(res_.nr_features, 4U);
+	EXPECT_EQ(Desc().rfind("dfl-fme.", 0), 0U) << Desc();
+}
+
+TEST_F(DflTest, PortsWithAfu)
+{
+	struct dfl_gen_params p = {};
+
+	p.seed = 2;
+	p.nr_ports = 2;
+	p.nr_features = 2;
+	p.afu = true;
+
+	ASSERT_EQ(Enumerate(p, DFL_ENUM_DESCRIBE), 0);
+	EXPECT_EQ(res_.nr_fdevs, 3U);
+	/* FME 1 + 2, each port 1 + 2 + its AFU */
+	EXPECT_EQ(res_.nr_features, 11U);
+	EXPECT_NE(Desc().find("dfl-port."), std::string::npos) << Desc();
+}
+
+TEST_F(DflTest, TooManyPorts)
+{
+	struct dfl_gen_params p = {};
+
+	p.nr_ports = 5;
+
+	EXPECT_EQ(Enumerate(p, 0), -EINVAL);
+}
+
+TEST_F(DflTest, DfhV1Params)
+{
+	struct dfl_gen_params p = {};
+	std::string desc;
+
+	p.seed = 3;
+	p.nr_features = 4;
+	p.v1_percent = 100;
+	p.nr_params = 3;
+	p.param_words = 2;
+
+	ASSERT_EQ(Enumerate(p, DFL_ENUM_DESCRIBE), 0);
+	desc = Desc();
+	EXPECT_EQ(res_.nr_features, 5U);
+	/* three parameters of a header and two data words each */
+	EXPECT_NE(desc.find(" dfh 1 "), std::string::npos) << desc;
+	EXPECT_NE(desc.find(" params 72/"), std::string::npos) << desc;
+	EXPECT_NE(desc.find(" guid "), std::string::npos) << desc;
+}
+
+TEST_F(DflTest, LargeParamBlocks)
+{
+	struct dfl_gen_params p = {};
+
+	p.seed = 4;
+	p.nr_ports = 1;
+	p.nr_features = 8;
+	p.v1_percent = 100;
+	p.nr_params = 64;
+	p.param_words = 32;
+
+	ASSERT_EQ(Enumerate(p, DFL_ENUM_DESCRIBE), 0);
+	EXPECT_EQ(res_.nr_features, 18U);
+	EXPECT_NE(Desc().find(" params 16896/"), std::string::npos) << Desc();
+}
+
+TEST_F(DflTest, DeepChain)
+{
+	struct dfl_gen_params p = {};
+
+	p.seed = 5;
+	p.nr_features = 1000;
+	p.v1_percent = 50;
+	p.nr_params = 1;
+	p.param_words = 1;
+	p.nr_interfaces = 2;
+
+	ASSERT_EQ(Enumerate(p, 0), 0);
+	/* interfaces are folded into the feature they follow */
+	EXPECT_EQ(res_.nr_features, 1001U);
+}
+
+TEST_F(DflTest, TruncatedRegion)
+{
+	struct dfl_gen_params p = {};
+	struct dfl_region dfl;
+
+	p.seed = 6;
+	p.nr_features = 4;
+
+	ASSERT_EQ(dfl_gen(&p, DFL_START, &dfl), 0);
+	/* the region ends before the EOL DFH */
+	dfl.len /= 2;
+	EXPECT_NE(dfl_enumerate(&dfl, 1, 0, &res_), 0);
+}
+
+TEST_F(DflTest, SnapshotLayout)
+{
+	struct dfl_gen_params p = {};
+	std::vector<uint8_t> snap;
+	const struct snap_word *w;
+	uint32_t hdr[4];
+	uint64_t dfl[2];
+	size_t i, nr;
+
+	p.seed = 7;
+	p.nr_ports = 1;
+	p.nr_features = 4;
+	p.v1_percent = 50;
+	p.nr_params = 2;
+	p.param_words = 1;
+	p.afu = true;
+
+	ASSERT_EQ(Enumerate(p, DFL_ENUM_SNAPSHOT), 0);
+	snap = Snapshot();
+	ASSERT_GE(snap.size(), (size_t)SNAP_HDR_SIZE + SNAP_DFL_SIZE);
+
+	memcpy(hdr, snap.data(), sizeof(hdr));
+	EXPECT_EQ(hdr[0], (uint32_t)SNAP_MAGIC);
+	EXPECT_EQ(hdr[1], 1U);
+	ASSERT_EQ(hdr[2], 1U);
+	nr = hdr[3];
+	ASSERT_EQ(snap.size(), SNAP_HDR_SIZE + SNAP_DFL_SIZE + nr * SNAP_WORD_SIZE);
+
+	memcpy(dfl, snap.data() + SNAP_HDR_SIZE, sizeof(dfl));
+	EXPECT_EQ(dfl[0], DFL_START);
+
+	/* every word read once, sorted by bus address */
+	w = reinterpret_cast<const struct snap_word *>(snap.data() +
+						      SNAP_HDR_SIZE +
+						      SNAP_DFL_SIZE);
+	for (i = 1; i < nr; i++)
+		EXPECT_LT(w[i - 1].addr, w[i].addr) << "word " << i;
+}
+
+TEST_F(DflTest, SnapshotReplay)
+{
+	struct dfl_gen_params p = {};
+	struct dfl_region *dfls;
+	std::vector<uint8_t> snap;
+	unsigned int nr_dfls;
+	unsigned long long reads;
+	std::string desc;
+
+	p.seed = 8;
+	p.nr_ports = 2;
+	p.nr_features = 6;
+	p.v1_percent = 50;
+	p.nr_params = 4;
+	p.param_words = 3;
+	p.nr_interfaces = 1;
+	p.afu = true;
+
+	dfl_mmio_reads = 0;
+	ASSERT_EQ(Enumerate(p, DFL_ENUM_SNAPSHOT | DFL_ENUM_DESCRIBE), 0);
+	reads = dfl_mmio_reads;
+	desc = Desc();
+	snap = Snapshot();
+
+	/* only what the enumeration read makes it into the replayed card */
+	dfl_mmio_reset();
+	ASSERT_EQ(dfl_snapshot_load(snap.data(), snap.size(), &dfls, &nr_dfls),
+		  0);
+	ASSERT_EQ(nr_dfls, 1U);
+
+	dfl_enum_result_free(&res_);
+	dfl_mmio_reads = 0;
+	ASSERT_EQ(dfl_enumerate(dfls, nr_dfls,
+				DFL_ENUM_SNAPSHOT | DFL_ENUM_DESCRIBE, &res_), 0);
+	free(dfls);
+
+	EXPECT_EQ(dfl_mmio_reads, reads);
+	EXPECT_EQ(Desc(), desc);
+	EXPECT_EQ(Snapshot(), snap);
+}
+
+TEST_F(DflTest, SnapshotInvalid)
+{
+	struct dfl_gen_params p = {};
+	struct dfl_region *dfls;
+	std::vector<uint8_t> snap;
+	unsigned int nr_dfls;
+
+	p.seed = 9;
+	p.nr_features = 2;
+
+	ASSERT_EQ(Enumerate(p, DFL_ENUM_SNAPSHOT), 0);
+	snap = Snapshot();
+	dfl_mmio_reset();
+
+	EXPECT_EQ(dfl_snapshot_load(snap.data(), snap.size() - 1, &dfls,
+				    &nr_dfls), -EINVAL);
+	EXPECT_EQ(dfl_snapshot_load(snap.data(), SNAP_HDR_SIZE - 1, &dfls,
+				    &nr_dfls), -EINVAL);
+
+	snap[0] ^= 0xff;
+	EXPECT_EQ(dfl_snapshot_load(snap.data(), snap.size(), &dfls, &nr_dfls),
+		  -EINVAL);
+	snap[0] ^= 0xff;
+
+	/* a word outside of the DFLs of the snapshot */
+	snap[snap.size() - SNAP_WORD_SIZE + 7] ^= 0x10;
+	EXPECT_EQ(dfl_snapshot_load(snap.data(), snap.size(), &dfls, &nr_dfls),
+		  -EINVAL);
+}
+
+TEST_F(DflTest, RandomCards)
+{
+	struct dfl_gen_params p = {};
+	unsigned int seed;
+
+	for (seed = 1; seed <= 200; seed++) {
+		p.seed = seed;
+		p.nr_ports = seed % 5;
+		p.nr_features = seed % 17;
+		p.v1_percent = seed * 7 % 101;
+		p.nr_params = seed % 9;
+		p.param_words = seed % 5;
+		p.nr_interfaces = seed % 3;
+		p.afu = seed % 2;
+
+		ASSERT_EQ(Enumerate(p, DFL_ENUM_SNAPSHOT), 0) << "seed " << seed;
+		EXPECT_EQ(res_.nr_fdevs, 1 + p.nr_ports) << "seed " << seed;
+		dfl_mmio_reset();
+	}
+}
@@ -0,0 +1,628 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * User space harness for the DFL enumeration code of drivers/fpga/dfl.c
+ *
+ * The framework itself is built unmodified, in this translation unit, on
+ * top of the shim headers in linux/. This file provides the out of line
+ * parts of the shim (driver model, devres, memory-backed MMIO) and the
+ * harness API of dfl_harness.h.
+ */
+
+#include "../../../drivers/fpga/dfl.c"
+
+int dfl_harness_verbose = DFL_LOG_ERR;
+unsigned long dfl_harness_warnings;
+unsigned long long dfl_mmio_reads;
+unsigned int nr_cpu_ids = 1;
+
+void dfl_harness_warn(const char *file, int line)
+{
+	dfl_harness_warnings++;
+
+	if (dfl_harness_verbose >= DFL_LOG_WARN)
+		fprintf(stderr, "WARNING: at %s:%d\n", file, line);
+}
+
+/* kernel specific conversions like %pa are printed as plain pointers */
+void dfl_harness_dev_printk(int level, const struct device *dev,
+			    const char *fmt, ...)
+{
+	va_list args;
+
+	if (level > dfl_harness_verbose)
+		return;
+
+	fprintf(stderr, "%s: ", dev ? dev_name(dev) : "(NULL device)");
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+}
+
+/* memory-backed MMIO */
+
+struct dfl_mmio_window {
+	u64 start;
+	u64 len;
+	void *mem;
+};
+
+static struct dfl_mmio_window *windows;
+static unsigned int nr_windows;
+
+void *dfl_mmio_map(uint64_t start, uint64_t len)
+{
+	struct dfl_mmio_window *win;
+	unsigned int i;
+	void *mem;
+
+	if (!len || len % sizeof(u64) || start + len < start)
+		return NULL;
+
+	for (i = 0; i < nr_windows; i++)
+		if (start < windows[i].start + windows[i].len &&
+		    windows[i].start < start + len)
+			return NULL;
+
+	win = realloc(windows, (nr_windows + 1) * sizeof(*win));
+	if (!win)
+		return NULL;
+	windows = win;
+
+	mem = calloc(1, len);
+	if (!mem)
+		return NULL;
+
+	win = &windows[nr_windows++];
+	win->start = start;
+	win->len = len;
+	win->mem = mem;
+
+	return mem;
+}
+
+void dfl_mmio_reset(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_windows; i++)
+		free(windows[i].mem);
+
+	free(windows);
+	windows = NULL;
+	nr_windows = 0;
+}
+
+static void __iomem *dfl_mmio_ioremap(u64 start, u64 len)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_windows; i++)
+		if (start >= windows[i].start && len <= windows[i].len &&
+		    start - windows[i].start <= windows[i].len - len)
+			return windows[i].mem + (start - windows[i].start);
+
+	return NULL;
+}
+
+int dfl_mmio_write(uint64_t addr, uint64_t val)
+{
+	u64 *p;
+
+	if (addr % sizeof(u64))
+		return -EINVAL;
+
+	p = dfl_mmio_ioremap(addr, sizeof(u64));
+	if (!p)
+		return -EINVAL;
+
+	*p = val;
+
+	return 0;
+}
+
+static u64 dfl_mmio_bus_addr(const void __iomem *addr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr_windows; i++)
+		if (addr >= windows[i].mem &&
+		    addr < windows[i].mem + windows[i].len)
+			return windows[i].start + (addr - windows[i].mem);
+
+	return ~0ULL;
+}
+
+/* driver model */
+
+struct devres {
+	struct list_head node;
+	max_align_t data[];
+};
+
+void *devm_kmalloc(struct device *dev, size_t size, gfp_t gfp)
+{
+	struct devres *dr;
+
+	dr = malloc(sizeof(*dr) + size);
+	if (!dr)
+		return NULL;
+
+	if (gfp & __GFP_ZERO)
+		memset(dr->data, 0, size);
+
+	list_add_tail(&dr->node, &dev->devres);
+
+	return dr->data;
+}
+
+void devm_kfree(struct device *dev, const void *p)
+{
+	struct devres *dr;
+
+	if (!p)
+		return;
+
+	dr = container_of((void *)p, struct devres, data);
+	list_del(&dr->node);
+	free(dr);
+}
+
+void devres_release_all(struct device *dev)
+{
+	struct devres *dr, *tmp;
+
+	list_for_each_entry_safe(dr, tmp, &dev->devres, node) {
+		list_del(&dr->node);
+		free(dr);
+	}
+}
+
+/* there is no resource tree, requested regions only live in devres */
+struct resource *devm_request_mem_region(struct device *dev,
+					 resource_size_t start,
+					 resource_size_t n, const char *name)
+{
+	struct resource *res;
+
+	res = devm_kzalloc(dev, sizeof(*res), GFP_KERNEL);
+	if (!res)
+		return NULL;
+
+	res->start = start;
+	res->end = start + n - 1;
+	res->name = name;
+	res->flags = IORESOURCE_MEM;
+
+	return res;
+}
+
+void devm_release_mem_region(struct device *dev, resource_size_t start,
+			     resource_size_t n)
+{
+}
+
+void __iomem *devm_ioremap(struct device *dev, resource_size_t offset,
+			   resource_size_t size)
+{
+	return dfl_mmio_ioremap(offset, size);
+}
+
+void devm_iounmap(struct device *dev, void __iomem *addr)
+{
+}
+
+void __iomem *devm_ioremap_resource(struct device *dev,
+				    const struct resource *res)
+{
+	void __iomem *addr = dfl_mmio_ioremap(res->start, resource_size(res));
+
+	return addr ? addr : ERR_PTR(-EBUSY);
+}
+
+int dev_set_name(struct device *dev, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	vsnprintf(dev->name, sizeof(dev->name), fmt, args);
+	va_end(args);
+
+	return 0;
+}
+
+void device_initialize(struct device *dev)
+{
+	dev->refcount = 1;
+	INIT_LIST_HEAD(&dev->children);
+	INIT_LIST_HEAD(&dev->sibling);
+	INIT_LIST_HEAD(&dev->devres);
+}
+
+int device_add(struct device *dev)
+{
+	if (dev->parent)
+		list_add_tail(&dev->sibling, &dev->parent->children);
+	dev->added = true;
+
+	return 0;
+}
+
+void device_del(struct device *dev)
+{
+	if (dev->parent && dev->added)
+		list_del(&dev->sibling);
+	dev->added = false;
+}
+
+struct device *get_device(struct device *dev)
+{
+	if (dev)
+		dev->refcount++;
+
+	return dev;
+}
+
+void put_device(struct device *dev)
+{
+	if (!dev || --dev->refcount)
+		return;
+
+	devres_release_all(dev);
+	if (dev->release)
+		dev->release(dev);
+}
+
+void device_unregister(struct device *dev)
+{
+	device_del(dev);
+	put_device(dev);
+}
+
+int device_for_each_child(struct device *parent, void *data,
+			  int (*fn)(struct device *dev, void *data))
+{
+	struct device *dev, *tmp;
+	int ret;
+
+	list_for_each_entry_safe(dev, tmp, &parent->children, sibling) {
+		ret = fn(dev, data);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static void platform_device_release(struct device *dev)
+{
+	struct platform_device *pdev = to_platform_device(dev);
+
+	free(pdev->dev.platform_data);
+	free(pdev->resource);
+	free(pdev);
+}
+
+struct platform_device *platform_device_alloc(const char *name, int id)
+{
+	struct platform_device *pdev;
+
+	pdev = calloc(1, sizeof(*pdev));
+	if (!pdev)
+		return NULL;
+
+	pdev->name = name;
+	pdev->id = id;
+	device_initialize(&pdev->dev);
+	pdev->dev.release = platform_device_release;
+
+	return pdev;
+}
+
+int platform_device_add_resources(struct platform_device *pdev,
+				  const struct resource *res,
+				  unsigned int num)
+{
+	struct resource *r = NULL;
+
+	if (res) {
+		r = kmemdup(res, sizeof(*res) * num, GFP_KERNEL);
+		if (!r)
+			return -ENOMEM;
+	}
+
+	free(pdev->resource);
+	pdev->resource = r;
+	pdev->num_resources = num;
+
+	return 0;
+}
+
+int platform_device_add_data(struct platform_device *pdev, const void *data,
+			     size_t size)
+{
+	void *d = NULL;
+
+	if (data) {
+		d = kmemdup(data, size, GFP_KERNEL);
+		if (!d)
+			return -ENOMEM;
+	}
+
+	free(pdev->dev.platform_data);
+	pdev->dev.platform_data = d;
+
+	return 0;
+}
+
+int platform_device_add(struct platform_device *pdev)
+{
+	dev_set_name(&pdev->dev, "%s.%d", pdev->name, pdev->id);
+
+	return device_add(&pdev->dev);
+}
+
+void platform_device_put(struct platform_device *pdev)
+{
+	if (pdev)
+		put_device(&pdev->dev);
+}
+
+void platform_device_unregister(struct platform_device *pdev)
+{
+	device_unregister(&pdev->dev);
+}
+
+void __iomem *devm_platform_ioremap_resource(struct platform_device *pdev,
+					     unsigned int index)
+{
+	if (index >= pdev->num_resources)
+		return ERR_PTR(-EINVAL);
+
+	return devm_ioremap_resource(&pdev->dev, &pdev->resource[index]);
+}
+
+int alloc_chrdev_region(dev_t *dev, unsigned int baseminor,
+			unsigned int count, const char *name)
+{
+	static unsigned int major = 240;
+
+	*dev = MKDEV(major++, baseminor);
+
+	return 0;
+}
+
+static void fpga_region_dev_release(struct device *dev)
+{
+	free(to_fpga_region(dev));
+}
+
+struct fpga_region *
+fpga_region_register(struct device *parent, struct fpga_manager *mgr,
+		     int (*get_bridges)(struct fpga_region *))
+{
+	static int region_id;
+	struct fpga_region *region;
+
+	region = calloc(1, sizeof(*region));
+	if (!region)
+		return ERR_PTR(-ENOMEM);
+
+	device_initialize(&region->dev);
+	region->dev.parent = parent;
+	region->dev.release = fpga_region_dev_release;
+	region->get_bridges = get_bridges;
+	dev_set_name(&region->dev, "region%d", region_id++);
+	device_add(&region->dev);
+
+	return region;
+}
+
+void fpga_region_unregister(struct fpga_region *region)
+{
+	device_unregister(&region->dev);
+}
+
+/* harness */
+
+/* the device a card driver would hand its DFLs from, e.g. a PCI function */
+static struct device dfl_card;
+
+int dfl_harness_init(void)
+{
+	device_initialize(&dfl_card);
+	dev_set_name(&dfl_card, "dfl-card");
+
+	return dfl_module_init();
+}
+
+void dfl_harness_exit(void)
+{
+	dfl_module_exit();
+	dfl_mmio_reset();
+}
+
+static void dfl_describe_guid(FILE *f, const guid_t *guid)
+{
+	const u8 *b = guid->b;
+
+	fprintf(f, " guid %02X%02X%02X%02X-%02X%02X-%02X%02X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+		b[3], b[2], b[1], b[0], b[5], b[4], b[7], b[6],
+		b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15]);
+}
+
+static void dfl_describe_fdev(FILE *f, struct dfl_feature_dev_data *fdata)
+{
+	struct dfl_feature *feature;
+	struct resource *res;
+
+	fprintf(f, "%s\n", dev_name(&fdata->dev->dev));
+
+	dfl_fpga_dev_for_each_feature(fdata, feature) {
+		fprintf(f, "  0x%03x rev %u dfh %u", feature->id,
+			feature->revision, feature->dfh_version);
+
+		if (feature->resource_index < 0) {
+			fprintf(f, " hdr 0x%llx", dfl_mmio_bus_addr(feature->ioaddr));
+		} else {
+			res = &fdata->resources[feature->resource_index];
+			fprintf(f, " mmio 0x%llx-0x%llx", res->start, res->end);
+		}
+
+		if (feature->param_size)
+			fprintf(f, " params %u/%08x", feature->param_size,
+				jhash(feature->params, feature->param_size, 0));
+
+		if (feature->nr_irqs)
+			fprintf(f, " irqs %d+%u", feature->irq_ctx[0].irq,
+				feature->nr_irqs);
+
+		if (feature->dfh_version == 1)
+			dfl_describe_guid(f, &feature->guid);
+
+		fputc('\n', f);
+	}
+}
+
+static int dfl_enum_result_fill(struct dfl_fpga_cdev *cdev,
+				unsigned int flags,
+				struct dfl_enum_result *res)
+{
+	struct dfl_feature_dev_data *fdata;
+	FILE *f = NULL;
+	size_t size;
+	struct device *dev;
+
+	if (flags & DFL_ENUM_DESCRIBE) {
+		f = open_memstream(&res->desc, &size);
+		if (!f)
+			return -ENOMEM;
+	}
+
+	/* feature devs are the children of the region, in enumeration order */
+	list_for_each_entry(dev, &cdev->region->dev.children, sibling) {
+		fdata = to_dfl_feature_dev_data(dev);
+		res->nr_fdevs++;
+		res->nr_features += fdata->num;
+		if (f)
+			dfl_describe_fdev(f, fdata);
+	}
+
+	if (f && fclose(f))
+		return -ENOMEM;
+
+	if (cdev->snapshot) {
+		res->snapshot = kmemdup(cdev->snapshot, cdev->snapshot_size,
+					GFP_KERNEL);
+		if (!res->snapshot)
+			return -ENOMEM;
+		res->snapshot_size = cdev->snapshot_size;
+	}
+
+	return 0;
+}
+
+int dfl_enumerate(const struct dfl_region *dfls, unsigned int nr_dfls,
+		  unsigned int flags, struct dfl_enum_result *res)
+{
+	int irq_table[DFL_HARNESS_NR_IRQS];
+	struct dfl_fpga_enum_info *info;
+	struct dfl_fpga_cdev *cdev;
+	unsigned int i;
+	int ret = 0;
+
+	memset(res, 0, sizeof(*res));
+
+	info = dfl_fpga_enum_info_alloc(&dfl_card);
+	if (!info)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_dfls && !ret; i++)
+		ret = dfl_fpga_enum_info_add_dfl(info, dfls[i].start,
+						 dfls[i].len);
+
+	for (i = 0; i < DFL_HARNESS_NR_IRQS; i++)
+		irq_table[i] = 32 + i;
+
+	if (!ret)
+		ret = dfl_fpga_enum_info_add_irq(info, DFL_HARNESS_NR_IRQS,
+						 irq_table);
+	if (ret)
+		goto free_info;
+
+	snapshot = flags & DFL_ENUM_SNAPSHOT;
+
+	res->enum_ns = ktime_get_ns();
+	cdev = dfl_fpga_feature_devs_enumerate(info);
+	res->enum_ns = ktime_get_ns() - res->enum_ns;
+	if (IS_ERR(cdev)) {
+		ret = PTR_ERR(cdev);
+		goto free_info;
+	}
+
+	ret = dfl_enum_result_fill(cdev, flags, res);
+
+	dfl_fpga_feature_devs_remove(cdev);
+free_info:
+	dfl_fpga_enum_info_free(info);
+	/* what the devres of the card would release on driver unbind */
+	devres_release_all(&dfl_card);
+
+	if (ret)
+		dfl_enum_result_free(res);
+
+	return ret;
+}
+
+void dfl_enum_result_free(struct dfl_enum_result *res)
+{
+	free(res->desc);
+	res->desc = NULL;
+	free(res->snapshot);
+	res->snapshot = NULL;
+	res->snapshot_size = 0;
+}
+
+int dfl_snapshot_load(const void *buf, size_t size, struct dfl_region **dfls,
+		      unsigned int *nr_dfls)
+{
+	const struct dfl_snapshot_header *hdr = buf;
+	const struct dfl_snapshot_word *words;
+	const struct dfl_snapshot_dfl *sdfl;
+	struct dfl_region *regions;
+	unsigned int i;
+
+	if (size < sizeof(*hdr) || hdr->magic != DFL_SNAPSHOT_MAGIC ||
+	    hdr->version != DFL_SNAPSHOT_VERSION || !hdr->nr_dfls)
+		return -EINVAL;
+
+	if (size != sizeof(*hdr) + (u64)hdr->nr_dfls * sizeof(*sdfl) +
+		    (u64)hdr->nr_words * sizeof(*words))
+		return -EINVAL;
+
+	sdfl = (const void *)(hdr + 1);
+	words = (const void *)(sdfl + hdr->nr_dfls);
+
+	regions = calloc(hdr->nr_dfls, sizeof(*regions));
+	if (!regions)
+		return -ENOMEM;
+
+	for (i = 0; i < hdr->nr_dfls; i++) {
+		if (!dfl_mmio_map(sdfl[i].start, sdfl[i].len))
+			goto err;
+		regions[i].start = sdfl[i].start;
+		regions[i].len = sdfl[i].len;
+	}
+
+	for (i = 0; i < hdr->nr_words; i++)
+		if (dfl_mmio_write(words[i].addr, words[i].val))
+			goto err;
+
+	*dfls = regions;
+	*nr_dfls = hdr->nr_dfls;
+
+	return 0;
+
+err:
+	free(regions);
+	return -EINVAL;
+}
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _DFL_SHIM_CDEV_H
+#define _DFL_SHIM_CDEV_H
+
+#include <linux/device.h>
+
+#define MINORBITS		20
+#define MINORMASK		((1U << MINORBITS) - 1)
+#define MAJOR(dev)		((unsigned int)((dev) >> MINORBITS))
+#define MKDEV(ma, mi)		(((dev_t)(ma) << MINORBITS) | (mi))
+
+struct file_operations {
+	struct module *owner;
+};
+
+struct cdev {
+	struct kobject kobj;
+	struct module *owner;
+	const struct file_operations *ops;
+};
+
+struct inode {
+	struct cdev *i_cdev;
+};
+
+static inline void cdev_init(struct cdev *cdev,
+			     const struct file_operations *fops)
+{
+	memset(cdev, 0, sizeof(*cdev));
+	cdev->ops = fops;
+}
+
+#define cdev_add(cdev, dev, count)	0
+
+static inline void cdev_del(struct cdev *cdev)
+{
+}
+
+int alloc_chrdev_region(dev_t *dev, unsigned int baseminor,
+			unsigned int count, const char *name);
+#define unregister_chrdev_region(dev, count)	do { } while (0)
+
+#endif /* _DFL_SHIM_CDEV_H */
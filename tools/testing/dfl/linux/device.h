@@ -0,0 +1,197 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * User space shim of the driver model used by drivers/fpga/dfl.c
+ *
+ * Devices are reference counted and keep a list of their children and of
+ * their devm allocations, which are freed when the last reference is gone
+ * or by devres_release_all(). There is no bus matching, so no driver is
+ * ever bound to the devices created by the DFL framework.
+ */
+
+#ifndef _DFL_SHIM_DEVICE_H
+#define _DFL_SHIM_DEVICE_H
+
+#include <linux/kernel.h>
+
+struct device;
+struct device_driver;
+struct file;
+
+struct kobject {
+	struct kobject *parent;
+};
+
+struct kobj_uevent_env;
+
+struct attribute {
+	const char *name;
+	umode_t mode;
+};
+
+struct attribute_group {
+	struct attribute **attrs;
+};
+
+struct bin_attribute {
+	struct attribute attr;
+	size_t size;
+	void *private;
+	ssize_t (*read)(struct file *filp, struct kobject *kobj,
+			struct bin_attribute *attr, char *buf, loff_t off,
+			size_t count);
+};
+
+struct device_attribute {
+	struct attribute attr;
+	ssize_t (*show)(struct device *dev, struct device_attribute *attr,
+			char *buf);
+};
+
+#define DEVICE_ATTR_RO(_name)						\
+	struct device_attribute dev_attr_##_name = {			\
+		.attr = { .name = #_name, .mode = 0444 },		\
+		.show = _name##_show,					\
+	}
+
+#define ATTRIBUTE_GROUPS(_name)						\
+	static const struct attribute_group _name##_group = {		\
+		.attrs = _name##_attrs,					\
+	};								\
+	static const struct attribute_group *_name##_groups[] = {	\
+		&_name##_group,						\
+		NULL,							\
+	}
+
+#define sysfs_bin_attr_init(attr)		do { } while (0)
+#define sysfs_create_bin_file(kobj, attr)	0
+#define sysfs_remove_bin_file(kobj, attr)	do { } while (0)
+
+#define add_uevent_var(env, fmt, ...)		0
+
+struct bus_type {
+	const char *name;
+	const struct attribute_group **dev_groups;
+	int (*match)(struct device *dev, struct device_driver *drv);
+	int (*uevent)(struct device *dev, struct kobj_uevent_env *env);
+	int (*probe)(struct device *dev);
+	void (*remove)(struct device *dev);
+};
+
+enum probe_type {
+	PROBE_DEFAULT_STRATEGY,
+	PROBE_PREFER_ASYNCHRONOUS,
+	PROBE_FORCE_SYNCHRONOUS,
+};
+
+struct device_driver {
+	const char *name;
+	const struct bus_type *bus;
+	struct module *owner;
+	enum probe_type probe_type;
+};
+
+#define bus_register(bus)		0
+#define bus_unregister(bus)		do { } while (0)
+#define driver_register(drv)		0
+#define driver_unregister(drv)		do { } while (0)
+
+struct resource {
+	resource_size_t start;
+	resource_size_t end;
+	const char *name;
+	unsigned long flags;
+	struct resource *parent;
+};
+
+#define IORESOURCE_MEM		0x00000200
+
+static inline resource_size_t resource_size(const struct resource *res)
+{
+	return res->end - res->start + 1;
+}
+
+#define insert_resource(parent, new)	0
+
+static inline int release_resource(struct resource *res)
+{
+	return 0;
+}
+
+struct device {
+	struct device *parent;
+	struct kobject kobj;
+	char name[64];
+	const struct bus_type *bus;
+	struct device_driver *driver;
+	void *platform_data;
+	dev_t devt;
+	void (*release)(struct device *dev);
+
+	int refcount;
+	bool added;
+	struct list_head children;
+	struct list_head sibling;
+	struct list_head devres;
+};
+
+static inline const char *dev_name(const struct device *dev)
+{
+	return dev->name;
+}
+
+static inline void *dev_get_platdata(const struct device *dev)
+{
+	return dev->platform_data;
+}
+
+#define dev_to_node(dev)	NUMA_NO_NODE
+
+int dev_set_name(struct device *dev, const char *fmt, ...);
+void device_initialize(struct device *dev);
+int device_add(struct device *dev);
+void device_del(struct device *dev);
+struct device *get_device(struct device *dev);
+void put_device(struct device *dev);
+void device_unregister(struct device *dev);
+int device_for_each_child(struct device *parent, void *data,
+			  int (*fn)(struct device *dev, void *data));
+
+/* devm allocations, freed with the device or by devres_release_all() */
+void *devm_kmalloc(struct device *dev, size_t size, gfp_t gfp);
+void devm_kfree(struct device *dev, const void *p);
+void devres_release_all(struct device *dev);
+
+static inline void *devm_kzalloc(struct device *dev, size_t size, gfp_t gfp)
+{
+	return devm_kmalloc(dev, size, gfp | __GFP_ZERO);
+}
+
+static inline void *devm_kcalloc(struct device *dev, size_t n, size_t size,
+				 gfp_t gfp)
+{
+	return devm_kmalloc(dev, n * size, gfp | __GFP_ZERO);
+}
+
+static inline void *devm_kmemdup(struct device *dev, const void *src,
+				 size_t len, gfp_t gfp)
+{
+	void *p = devm_kmalloc(dev, len, gfp);
+
+	if (p)
+		memcpy(p, src, len);
+
+	return p;
+}
+
+struct resource *devm_request_mem_region(struct device *dev,
+					 resource_size_t start,
+					 resource_size_t n, const char *name);
+void devm_release_mem_region(struct device *dev, resource_size_t start,
+			     resource_size_t n);
+void __iomem *devm_ioremap(struct device *dev, resource_size_t offset,
+			   resource_size_t size);
+void devm_iounmap(struct device *dev, void __iomem *addr);
+void __iomem *devm_ioremap_resource(struct device *dev,
+				    const struct resource *res);
+
+#endif /* _DFL_SHIM_DEVICE_H */
@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _DFL_SHIM_FPGA_REGION_H
+#define _DFL_SHIM_FPGA_REGION_H
+
+#include <linux/device.h>
+
+struct fpga_manager;
+
+struct fpga_region {
+	struct device dev;
+	void *priv;
+	int (*get_bridges)(struct fpga_region *region);
+};
+
+#define to_fpga_region(d)	container_of(d, struct fpga_region, dev)
+
+struct fpga_region *
+fpga_region_register(struct device *parent, struct fpga_manager *mgr,
+		     int (*get_bridges)(struct fpga_region *));
+void fpga_region_unregister(struct fpga_region *region);
+
+#endif /* _DFL_SHIM_FPGA_REGION_H */
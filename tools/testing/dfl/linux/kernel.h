@@ -0,0 +1,714 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * User space shim of the kernel API used by drivers/fpga/dfl.c
+ *
+ * Only what the DFL framework needs to build and to enumerate is modelled:
+ * MMIO is plain memory (see dfl_mmio_map()), devm allocations are tracked
+ * per device and released with the device, and the parts of the framework
+ * which need real hardware or a process context (irqs, eventfds, mmap,
+ * character devices) are stubs which fail or do nothing.
+ *
+ * Everything runs in a single thread, so locks are no-ops.
+ */
+
+#ifndef _DFL_SHIM_KERNEL_H
+#define _DFL_SHIM_KERNEL_H
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#include "../dfl_harness.h"
+
+typedef __u8 u8;
+typedef __u16 u16;
+typedef __u32 u32;
+typedef unsigned long long u64;
+typedef __s8 s8;
+typedef __s16 s16;
+typedef __s32 s32;
+typedef long long s64;
+
+typedef u64 resource_size_t;
+typedef u64 phys_addr_t;
+typedef unsigned int gfp_t;
+typedef unsigned long kernel_ulong_t;
+typedef s64 ktime_t;
+typedef unsigned short umode_t;
+
+#define __iomem
+#define __user
+#define __init
+#define __exit
+#define __must_check		__attribute__((warn_unused_result))
+
+#define likely(x)		__builtin_expect(!!(x), 1)
+#define unlikely(x)		__builtin_expect(!!(x), 0)
+
+#define ARRAY_SIZE(a)		(sizeof(a) / sizeof((a)[0]))
+
+#define container_of(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+#define offsetofend(TYPE, MEMBER) \
+	(offsetof(TYPE, MEMBER) + sizeof(((TYPE *)0)->MEMBER))
+
+#define struct_size(p, member, count) \
+	(sizeof(*(p)) + (size_t)(count) * sizeof(*(p)->member))
+
+#define array_size(a, b)	((size_t)(a) * (size_t)(b))
+
+#define ALIGN(x, a)		(((x) + (a) - 1) & ~((typeof(x))(a) - 1))
+
+#define min(a, b)		({ typeof(a) __a = (a); typeof(b) __b = (b); \
+				   __a < __b ? __a : __b; })
+#define max(a, b)		({ typeof(a) __a = (a); typeof(b) __b = (b); \
+				   __a > __b ? __a : __b; })
+#define min_t(type, a, b)	min((type)(a), (type)(b))
+#define max_t(type, a, b)	max((type)(a), (type)(b))
+#define max3(a, b, c)		max(max(a, b), c)
+
+#define READ_ONCE(x)		(*(const volatile typeof(x) *)&(x))
+#define WRITE_ONCE(x, val)	(*(volatile typeof(x) *)&(x) = (val))
+#define smp_store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define smp_load_acquire(p)	__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_mb()		__sync_synchronize()
+
+/* bits, bitfields and hashes */
+
+#define BITS_PER_LONG		64
+#define BIT(nr)			(1UL << (nr))
+#define BIT_ULL(nr)		(1ULL << (nr))
+#define BITS_TO_LONGS(nr)	(((nr) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define GENMASK(h, l) \
+	(((~0UL) - (1UL << (l)) + 1) & (~0UL >> (BITS_PER_LONG - 1 - (h))))
+#define GENMASK_ULL(h, l) \
+	(((~0ULL) - (1ULL << (l)) + 1) & (~0ULL >> (63 - (h))))
+
+#define FIELD_GET(mask, reg) \
+	((typeof(mask))(((reg) & (mask)) >> __builtin_ctzll(mask)))
+#define FIELD_PREP(mask, val) \
+	(((typeof(mask))(val) << __builtin_ctzll(mask)) & (mask))
+
+static inline int ilog2(unsigned long n)
+{
+	return BITS_PER_LONG - 1 - __builtin_clzl(n);
+}
+
+#define order_base_2(n)		((n) > 1 ? ilog2((n) - 1) + 1 : 0)
+#define is_power_of_2(n)	((n) != 0 && (((n) & ((n) - 1)) == 0))
+
+#define GOLDEN_RATIO_32		0x61C88647
+
+static inline u32 hash_32(u32 val, unsigned int bits)
+{
+	return (val * GOLDEN_RATIO_32) >> (32 - bits);
+}
+
+#define hash_min(val, bits)	hash_32(val, bits)
+
+/* any decent hash will do, only the distribution of the buckets matters */
+static inline u32 jhash(const void *key, u32 length, u32 initval)
+{
+	const u8 *k = key;
+	u32 h = 2166136261u ^ initval;
+
+	while (length--)
+		h = (h ^ *k++) * 16777619u;
+
+	return h;
+}
+
+static inline void __set_bit(unsigned long nr, unsigned long *addr)
+{
+	addr[nr / BITS_PER_LONG] |= BIT(nr % BITS_PER_LONG);
+}
+
+static inline unsigned long find_next_bit(const unsigned long *addr,
+					  unsigned long size,
+					  unsigned long offset)
+{
+	for (; offset < size; offset++)
+		if (addr[offset / BITS_PER_LONG] & BIT(offset % BITS_PER_LONG))
+			break;
+
+	return offset;
+}
+
+#define for_each_set_bit(bit, addr, size)				\
+	for ((bit) = find_next_bit((addr), (size), 0);			\
+	     (bit) < (size);						\
+	     (bit) = find_next_bit((addr), (size), (bit) + 1))
+
+/* errors and warnings */
+
+#define MAX_ERRNO		4095
+#define ENOTSUPP		524
+
+static inline void *ERR_PTR(long error)
+{
+	return (void *)error;
+}
+
+static inline long PTR_ERR(const void *ptr)
+{
+	return (long)ptr;
+}
+
+static inline bool IS_ERR(const void *ptr)
+{
+	return (unsigned long)ptr >= (unsigned long)-MAX_ERRNO;
+}
+
+#define WARN_ON(condition) ({						\
+	int __ret_warn_on = !!(condition);				\
+	if (unlikely(__ret_warn_on))					\
+		dfl_harness_warn(__FILE__, __LINE__);			\
+	unlikely(__ret_warn_on);					\
+})
+#define WARN_ON_ONCE(condition)	WARN_ON(condition)
+
+void dfl_harness_warn(const char *file, int line);
+
+/* logging */
+
+struct device;
+
+void dfl_harness_dev_printk(int level, const struct device *dev,
+			    const char *fmt, ...);
+
+#define dev_err(dev, fmt, ...) \
+	dfl_harness_dev_printk(DFL_LOG_ERR, dev, fmt, ##__VA_ARGS__)
+#define dev_warn(dev, fmt, ...) \
+	dfl_harness_dev_printk(DFL_LOG_WARN, dev, fmt, ##__VA_ARGS__)
+#define dev_info(dev, fmt, ...) \
+	dfl_harness_dev_printk(DFL_LOG_INFO, dev, fmt, ##__VA_ARGS__)
+#define dev_dbg(dev, fmt, ...) \
+	dfl_harness_dev_printk(DFL_LOG_DEBUG, dev, fmt, ##__VA_ARGS__)
+
+#define scnprintf(buf, size, fmt, ...) ({				\
+	int __len = snprintf(buf, size, fmt, ##__VA_ARGS__);		\
+	__len >= (int)(size) ? (int)(size) - 1 : __len;			\
+})
+#define sysfs_emit(buf, fmt, ...)	sprintf(buf, fmt, ##__VA_ARGS__)
+
+/* memory */
+
+#define GFP_KERNEL		0U
+#define __GFP_ZERO		0x100U
+
+#define PAGE_SIZE		4096UL
+#define PAGE_ALIGN(x)		(((x) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+
+static inline void *kmalloc(size_t size, gfp_t gfp)
+{
+	return gfp & __GFP_ZERO ? calloc(1, size) : malloc(size);
+}
+
+static inline void *kzalloc(size_t size, gfp_t gfp)
+{
+	return calloc(1, size);
+}
+
+static inline void *kcalloc(size_t n, size_t size, gfp_t gfp)
+{
+	return calloc(n, size);
+}
+
+static inline void *krealloc(void *p, size_t size, gfp_t gfp)
+{
+	return realloc(p, size);
+}
+
+static inline void *kmemdup(const void *src, size_t len, gfp_t gfp)
+{
+	void *p = malloc(len);
+
+	if (p)
+		memcpy(p, src, len);
+
+	return p;
+}
+
+#define kfree(p)		free((void *)(p))
+#define kvzalloc(size, gfp)	kzalloc(size, gfp)
+#define kvfree(p)		free(p)
+#define vmalloc_user(size)	calloc(1, size)
+#define vfree(p)		free(p)
+
+static inline char *kasprintf(gfp_t gfp, const char *fmt, ...)
+{
+	va_list args;
+	char *p;
+
+	va_start(args, fmt);
+	if (vasprintf(&p, fmt, args) < 0)
+		p = NULL;
+	va_end(args);
+
+	return p;
+}
+
+static inline unsigned long *bitmap_zalloc(unsigned int nbits, gfp_t gfp)
+{
+	return calloc(BITS_TO_LONGS(nbits), sizeof(unsigned long));
+}
+
+#define bitmap_free(p)		free(p)
+
+struct page;
+
+#define alloc_page(gfp)		((struct page *)calloc(1, PAGE_SIZE))
+#define __free_page(page)	free(page)
+#define page_address(page)	((void *)(page))
+
+static inline void sort(void *base, size_t num, size_t size,
+			int (*cmp)(const void *, const void *),
+			void (*swap)(void *, void *, int))
+{
+	qsort(base, num, size, cmp);
+}
+
+static inline ssize_t memory_read_from_buffer(void *to, size_t count,
+					      loff_t *ppos, const void *from,
+					      size_t available)
+{
+	loff_t pos = *ppos;
+
+	if (pos < 0)
+		return -EINVAL;
+	if (pos >= (loff_t)available || !count)
+		return 0;
+	if (count > available - pos)
+		count = available - pos;
+
+	memcpy(to, (const char *)from + pos, count);
+	*ppos = pos + count;
+
+	return count;
+}
+
+/* user copies, the "user" buffers are ordinary memory */
+
+#define put_user(x, ptr)	({ *(ptr) = (x); 0; })
+#define copy_from_user(to, from, n)	(memcpy(to, from, n), 0UL)
+#define copy_to_user(to, from, n)	(memcpy(to, from, n), 0UL)
+
+static inline void *memdup_user(const void *src, size_t len)
+{
+	void *p = kmemdup(src, len, GFP_KERNEL);
+
+	return p ? p : ERR_PTR(-ENOMEM);
+}
+
+/* lists */
+
+struct list_head {
+	struct list_head *next, *prev;
+};
+
+struct hlist_head {
+	struct hlist_node *first;
+};
+
+struct hlist_node {
+	struct hlist_node *next, **pprev;
+};
+
+#define LIST_HEAD_INIT(name)	{ &(name), &(name) }
+#define LIST_HEAD(name)		struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void __list_add(struct list_head *new, struct list_head *prev,
+			      struct list_head *next)
+{
+	next->prev = new;
+	new->next = next;
+	new->prev = prev;
+	prev->next = new;
+}
+
+static inline void list_add(struct list_head *new, struct list_head *head)
+{
+	__list_add(new, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *new, struct list_head *head)
+{
+	__list_add(new, head->prev, head);
+}
+
+static inline void list_del(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	entry->next = NULL;
+	entry->prev = NULL;
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+#define list_entry(ptr, type, member)	container_of(ptr, type, member)
+
+#define list_for_each_entry(pos, head, member)				\
+	for (pos = list_entry((head)->next, typeof(*pos), member);	\
+	     &pos->member != (head);					\
+	     pos = list_entry(pos->member.next, typeof(*pos), member))
+
+#define list_for_each_entry_reverse(pos, head, member)			\
+	for (pos = list_entry((head)->prev, typeof(*pos), member);	\
+	     &pos->member != (head);					\
+	     pos = list_entry(pos->member.prev, typeof(*pos), member))
+
+#define list_for_each_entry_safe(pos, n, head, member)			\
+	for (pos = list_entry((head)->next, typeof(*pos), member),	\
+	     n = list_entry(pos->member.next, typeof(*pos), member);	\
+	     &pos->member != (head);					\
+	     pos = n, n = list_entry(n->member.next, typeof(*n), member))
+
+static inline void hlist_add_head(struct hlist_node *n, struct hlist_head *h)
+{
+	n->next = h->first;
+	if (h->first)
+		h->first->pprev = &n->next;
+	h->first = n;
+	n->pprev = &h->first;
+}
+
+#define hlist_entry_safe(ptr, type, member) \
+	({ typeof(ptr) ____ptr = (ptr); \
+	   ____ptr ? container_of(____ptr, type, member) : NULL; })
+
+#define hlist_for_each_entry(pos, head, member)				\
+	for (pos = hlist_entry_safe((head)->first, typeof(*(pos)), member); \
+	     pos;							\
+	     pos = hlist_entry_safe((pos)->member.next, typeof(*(pos)), member))
+
+/* locking and atomics, everything runs in one thread */
+
+struct mutex {
+	int locked;
+};
+
+struct lock_class_key {
+	int dummy;
+};
+
+typedef struct {
+	int locked;
+} spinlock_t;
+
+#define DEFINE_MUTEX(name)	struct mutex name = { 0 }
+#define mutex_init(m)		((m)->locked = 0)
+#define mutex_lock(m)		((m)->locked++)
+#define mutex_unlock(m)		((m)->locked--)
+#define lockdep_set_class_and_name(lock, key, name) \
+	do { (void)(key); (void)(name); } while (0)
+
+#define spin_lock_init(l)	((l)->locked = 0)
+#define spin_lock_irqsave(l, flags)	((flags) = 0, (l)->locked++)
+#define spin_unlock_irqrestore(l, flags)	((void)(flags), (l)->locked--)
+
+typedef struct {
+	int counter;
+} atomic_t;
+
+typedef struct {
+	s64 counter;
+} atomic64_t;
+
+#define atomic_set(v, i)	((v)->counter = (i))
+#define atomic_xchg(v, i)	__atomic_exchange_n(&(v)->counter, i, \
+						    __ATOMIC_SEQ_CST)
+#define atomic_inc_return(v)	__atomic_add_fetch(&(v)->counter, 1, \
+						   __ATOMIC_SEQ_CST)
+#define atomic64_inc(v)		__atomic_add_fetch(&(v)->counter, 1, \
+						   __ATOMIC_SEQ_CST)
+
+struct kref {
+	int refcount;
+};
+
+#define kref_init(k)		((k)->refcount = 1)
+#define kref_get(k)		((k)->refcount++)
+
+static inline int kref_put(struct kref *kref,
+			   void (*release)(struct kref *kref))
+{
+	if (--kref->refcount)
+		return 0;
+
+	release(kref);
+	return 1;
+}
+
+/* ids */
+
+struct idr {
+	void **ptrs;
+	int size;
+};
+
+struct ida {
+	struct idr idr;
+};
+
+#define DEFINE_IDA(name)	struct ida name = { { NULL, 0 } }
+
+static inline void idr_init(struct idr *idr)
+{
+	idr->ptrs = NULL;
+	idr->size = 0;
+}
+
+static inline void idr_destroy(struct idr *idr)
+{
+	free(idr->ptrs);
+	idr_init(idr);
+}
+
+/* lowest free id, ptr must not be NULL */
+static inline int idr_alloc(struct idr *idr, void *ptr, int start, int end,
+			    gfp_t gfp)
+{
+	void **ptrs;
+	int id, size;
+
+	for (id = start; id < idr->size; id++)
+		if (!idr->ptrs[id])
+			goto found;
+
+	size = max(idr->size * 2, max(start + 1, 16));
+	ptrs = realloc(idr->ptrs, size * sizeof(*ptrs));
+	if (!ptrs)
+		return -ENOMEM;
+
+	memset(ptrs + idr->size, 0, (size - idr->size) * sizeof(*ptrs));
+	id = max(idr->size, start);
+	idr->ptrs = ptrs;
+	idr->size = size;
+found:
+	if (end > 0 && id >= end)
+		return -ENOSPC;
+
+	idr->ptrs[id] = ptr;
+	return id;
+}
+
+static inline void idr_remove(struct idr *idr, int id)
+{
+	if (id >= 0 && id < idr->size)
+		idr->ptrs[id] = NULL;
+}
+
+#define ida_alloc(ida, gfp)	idr_alloc(&(ida)->idr, (ida), 0, 0, gfp)
+#define ida_free(ida, id)	idr_remove(&(ida)->idr, id)
+
+/* time */
+
+#define NSEC_PER_USEC		1000L
+#define USEC_PER_SEC		1000000L
+
+static inline u64 ktime_get_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#define ktime_get()		((ktime_t)ktime_get_ns())
+#define ns_to_ktime(ns)		((ktime_t)(ns))
+#define ktime_us_delta(a, b)	(((a) - (b)) / NSEC_PER_USEC)
+
+enum hrtimer_restart {
+	HRTIMER_NORESTART,
+	HRTIMER_RESTART,
+};
+
+enum hrtimer_mode {
+	HRTIMER_MODE_REL = 1,
+};
+
+struct hrtimer {
+	enum hrtimer_restart (*function)(struct hrtimer *timer);
+};
+
+#define hrtimer_init(t, clock, mode)	((t)->function = NULL)
+#define hrtimer_start(t, time, mode)	do { } while (0)
+
+static inline int hrtimer_cancel(struct hrtimer *timer)
+{
+	return 0;
+}
+
+static inline int hrtimer_try_to_cancel(struct hrtimer *timer)
+{
+	return 0;
+}
+
+/* irqs and eventfds are not available */
+
+#define NR_IRQS			1024
+#define IRQF_ONESHOT		0x2000
+#define NUMA_NO_NODE		(-1)
+
+typedef enum irqreturn {
+	IRQ_NONE,
+	IRQ_HANDLED,
+	IRQ_WAKE_THREAD,
+} irqreturn_t;
+
+typedef irqreturn_t (*irq_handler_t)(int irq, void *arg);
+
+struct cpumask;
+struct eventfd_ctx;
+
+extern unsigned int nr_cpu_ids;
+
+#define cpu_online(cpu)			((cpu) == 0)
+#define cpumask_of(cpu)			((const struct cpumask *)NULL)
+#define cpumask_of_node(node)		((const struct cpumask *)NULL)
+#define synchronize_irq(irq)		do { } while (0)
+
+static inline int irq_set_affinity_hint(unsigned int irq,
+					const struct cpumask *m)
+{
+	return 0;
+}
+
+static inline const void *free_irq(unsigned int irq, void *arg)
+{
+	return NULL;
+}
+
+static inline int request_threaded_irq(unsigned int irq, irq_handler_t handler,
+				       irq_handler_t thread_fn,
+				       unsigned long flags, const char *name,
+				       void *arg)
+{
+	return -ENOSYS;
+}
+
+#define eventfd_ctx_fdget(fd)		((struct eventfd_ctx *)ERR_PTR(-EBADF))
+#define eventfd_ctx_put(ctx)		do { } while (0)
+#define eventfd_signal(ctx, n)		do { } while (0)
+
+/* mmap is not available */
+
+#define VM_WRITE		0x00000002UL
+#define VM_MAYWRITE		0x00000020UL
+
+struct vm_area_struct;
+
+struct vm_operations_struct {
+	void (*open)(struct vm_area_struct *vma);
+	void (*close)(struct vm_area_struct *vma);
+};
+
+struct vm_area_struct {
+	unsigned long vm_start;
+	unsigned long vm_end;
+	unsigned long vm_flags;
+	const struct vm_operations_struct *vm_ops;
+	void *vm_private_data;
+};
+
+#define vm_flags_clear(vma, flags)	((vma)->vm_flags &= ~(flags))
+#define remap_vmalloc_range(vma, addr, pgoff)	(-ENOSYS)
+#define vm_insert_page(vma, addr, page)		(-ENOSYS)
+
+/* memory-backed MMIO, see dfl_mmio_map() */
+
+static inline u64 readq(const volatile void __iomem *addr)
+{
+	dfl_mmio_reads++;
+
+	return *(const volatile u64 *)addr;
+}
+
+static inline void writeq(u64 val, volatile void __iomem *addr)
+{
+	*(volatile u64 *)addr = val;
+}
+
+/* as on x86, where memcpy_fromio() copies with 32-bit reads */
+static inline void memcpy_fromio(void *to, const volatile void __iomem *from,
+				 size_t count)
+{
+	dfl_mmio_reads += (count + sizeof(u32) - 1) / sizeof(u32);
+	memcpy(to, (const void *)from, count);
+}
+
+/* guid */
+
+typedef struct {
+	__u8 b[16];
+} guid_t;
+
+#define GUID_INIT(a, _b, c, d0, d1, d2, d3, d4, d5, d6, d7)		\
+((guid_t)								\
+{{ (a) & 0xff, ((a) >> 8) & 0xff, ((a) >> 16) & 0xff, ((a) >> 24) & 0xff, \
+   (_b) & 0xff, ((_b) >> 8) & 0xff,					\
+   (c) & 0xff, ((c) >> 8) & 0xff,					\
+   (d0), (d1), (d2), (d3), (d4), (d5), (d6), (d7) }})
+
+static inline void guid_copy(guid_t *dst, const guid_t *src)
+{
+	memcpy(dst, src, sizeof(guid_t));
+}
+
+static inline bool guid_equal(const guid_t *u1, const guid_t *u2)
+{
+	return memcmp(u1, u2, sizeof(guid_t)) == 0;
+}
+
+static inline bool guid_is_null(const guid_t *guid)
+{
+	static const guid_t guid_null;
+
+	return guid_equal(guid, &guid_null);
+}
+
+/* modules */
+
+struct module;
+
+#define THIS_MODULE		((struct module *)NULL)
+#define try_module_get(m)	true
+#define module_put(m)		do { } while (0)
+
+#define module_param(name, type, perm)
+#define MODULE_PARM_DESC(name, desc)
+#define MODULE_DESCRIPTION(desc)
+#define MODULE_AUTHOR(author)
+#define MODULE_LICENSE(license)
+#define EXPORT_SYMBOL(sym)
+#define EXPORT_SYMBOL_GPL(sym)
+
+/* the harness calls these in place of loading and unloading the module */
+#define module_init(fn)		int dfl_module_init(void) { return fn(); }
+#define module_exit(fn)		void dfl_module_exit(void) { fn(); }
+
+#include <linux/device.h>
+
+#endif /* _DFL_SHIM_KERNEL_H */
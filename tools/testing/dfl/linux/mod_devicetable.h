@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _DFL_SHIM_MOD_DEVICETABLE_H
+#define _DFL_SHIM_MOD_DEVICETABLE_H
+
+#include <linux/kernel.h>
+
+struct dfl_device_id {
+	__u16 type;
+	__u16 feature_id;
+	guid_t guid;
+	kernel_ulong_t driver_data;
+};
+
+#endif /* _DFL_SHIM_MOD_DEVICETABLE_H */
@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _DFL_SHIM_PLATFORM_DEVICE_H
+#define _DFL_SHIM_PLATFORM_DEVICE_H
+
+#include <linux/device.h>
+
+struct platform_device {
+	const char *name;
+	int id;
+	struct device dev;
+	u32 num_resources;
+	struct resource *resource;
+};
+
+#define to_platform_device(x)	container_of((x), struct platform_device, dev)
+
+struct platform_device *platform_device_alloc(const char *name, int id);
+int platform_device_add_resources(struct platform_device *pdev,
+				  const struct resource *res,
+				  unsigned int num);
+int platform_device_add_data(struct platform_device *pdev, const void *data,
+			     size_t size);
+int platform_device_add(struct platform_device *pdev);
+void platform_device_put(struct platform_device *pdev);
+void platform_device_unregister(struct platform_device *pdev);
+void __iomem *devm_platform_ioremap_resource(struct platform_device *pdev,
+					     unsigned int index);
+
+#endif /* _DFL_SHIM_PLATFORM_DEVICE_H */